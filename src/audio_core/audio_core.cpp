@@ -13,6 +13,7 @@
 #include "core/core_timing.h"
 #include "core/hle/kernel/vm_manager.h"
 #include "core/hle/service/dsp_dsp.h"
+#include "core/settings.h"
 
 namespace AudioCore {
 
@@ -33,7 +34,7 @@ static void AudioTickCallback(u64 /*userdata*/, int cycles_late) {
 }
 
 void Init() {
-    DSP::HLE::Init();
+    DSP::HLE::Init(Settings::values.use_audio_thread);
 
     tick_event = CoreTiming::RegisterEvent("AudioCore::tick_event", AudioTickCallback);
     CoreTiming::ScheduleEvent(audio_frame_ticks, tick_event);
@@ -13,8 +13,8 @@
 
 namespace Codec {
 
-StereoBuffer16 DecodeADPCM(const u8* const data, const size_t sample_count,
-                           const std::array<s16, 16>& adpcm_coeff, ADPCMState& state) {
+void DecodeADPCM(const u8* const data, const size_t sample_count,
+                 const std::array<s16, 16>& adpcm_coeff, ADPCMState& state, StereoBuffer16& ret) {
     // GC-ADPCM with scale factor and variable coefficients.
     // Frames are 8 bytes long containing 14 samples each.
     // Samples are 4 bits (one nibble) long.
@@ -26,7 +26,7 @@ StereoBuffer16 DecodeADPCM(const u8* const data, const size_t sample_count,
 
     const size_t ret_size =
         sample_count % 2 == 0 ? sample_count : sample_count + 1; // Ensure multiple of two.
-    StereoBuffer16 ret(ret_size);
+    ret.resize(ret_size);
 
     int yn1 = state.yn1, yn2 = state.yn2;
 
@@ -74,8 +74,6 @@ StereoBuffer16 DecodeADPCM(const u8* const data, const size_t sample_count,
 
     state.yn1 = yn1;
     state.yn2 = yn2;
-
-    return ret;
 }
 
 static s16 SignExtendS8(u8 x) {
@@ -84,11 +82,11 @@ static s16 SignExtendS8(u8 x) {
     return static_cast<s16>(static_cast<s8>(x));
 }
 
-StereoBuffer16 DecodePCM8(const unsigned num_channels, const u8* const data,
-                          const size_t sample_count) {
+void DecodePCM8(const unsigned num_channels, const u8* const data, const size_t sample_count,
+                StereoBuffer16& ret) {
     ASSERT(num_channels == 1 || num_channels == 2);
 
-    StereoBuffer16 ret(sample_count);
+    ret.resize(sample_count);
 
     if (num_channels == 1) {
         for (size_t i = 0; i < sample_count; i++) {
@@ -100,15 +98,13 @@ StereoBuffer16 DecodePCM8(const unsigned num_channels, const u8* const data,
             ret[i][1] = SignExtendS8(data[i * 2 + 1]);
         }
     }
-
-    return ret;
 }
 
-StereoBuffer16 DecodePCM16(const unsigned num_channels, const u8* const data,
-                           const size_t sample_count) {
+void DecodePCM16(const unsigned num_channels, const u8* const data, const size_t sample_count,
+                 StereoBuffer16& ret) {
     ASSERT(num_channels == 1 || num_channels == 2);
 
-    StereoBuffer16 ret(sample_count);
+    ret.resize(sample_count);
 
     if (num_channels == 1) {
         for (size_t i = 0; i < sample_count; i++) {
@@ -119,7 +115,5 @@ StereoBuffer16 DecodePCM16(const unsigned num_channels, const u8* const data,
     } else {
         std::memcpy(ret.data(), data, sample_count * 2 * sizeof(u16));
     }
-
-    return ret;
 }
 };
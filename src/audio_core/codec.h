@@ -21,31 +21,35 @@ struct ADPCMState {
     s16 yn2; ///< y[n-2]
 };
 
+// The decoders write into an existing buffer, which is resized to fit the decoded data. Reusing
+// the same buffer for every call avoids heap allocations once it has grown large enough.
+
 /**
  * @param data Pointer to buffer that contains ADPCM data to decode
  * @param sample_count Length of buffer in terms of number of samples
  * @param adpcm_coeff ADPCM coefficients
  * @param state ADPCM state, this is updated with new state
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded stereo signed PCM16 data, sample_count rounded up to a
+ * multiple of two in length
  */
-StereoBuffer16 DecodeADPCM(const u8* const data, const size_t sample_count,
-                           const std::array<s16, 16>& adpcm_coeff, ADPCMState& state);
+void DecodeADPCM(const u8* const data, const size_t sample_count,
+                 const std::array<s16, 16>& adpcm_coeff, ADPCMState& state, StereoBuffer16& output);
 
 /**
  * @param num_channels Number of channels
  * @param data Pointer to buffer that contains PCM8 data to decode
  * @param sample_count Length of buffer in terms of number of samples
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded stereo signed PCM16 data, sample_count in length
  */
-StereoBuffer16 DecodePCM8(const unsigned num_channels, const u8* const data,
-                          const size_t sample_count);
+void DecodePCM8(const unsigned num_channels, const u8* const data, const size_t sample_count,
+                StereoBuffer16& output);
 
 /**
  * @param num_channels Number of channels
  * @param data Pointer to buffer that contains PCM16 data to decode
  * @param sample_count Length of buffer in terms of number of samples
- * @return Decoded stereo signed PCM16 data, sample_count in length
+ * @param output Receives the decoded stereo signed PCM16 data, sample_count in length
  */
-StereoBuffer16 DecodePCM16(const unsigned num_channels, const u8* const data,
-                           const size_t sample_count);
+void DecodePCM16(const unsigned num_channels, const u8* const data, const size_t sample_count,
+                 StereoBuffer16& output);
 };
@@ -3,13 +3,18 @@
 // Refer to the license.txt file included.
 
 #include <array>
+#include <atomic>
+#include <cstring>
 #include <memory>
+#include <thread>
 #include "audio_core/hle/dsp.h"
 #include "audio_core/hle/mixers.h"
 #include "audio_core/hle/pipe.h"
 #include "audio_core/hle/source.h"
 #include "audio_core/sink.h"
 #include "audio_core/time_stretch.h"
+#include "common/microprofile.h"
+#include "common/thread.h"
 
 namespace DSP {
 namespace HLE {
@@ -52,10 +57,7 @@ static std::array<Source, num_sources> sources = {
 };
 static Mixers mixers;
 
-static StereoFrame16 GenerateCurrentFrame() {
-    SharedMemory& read = ReadRegion();
-    SharedMemory& write = WriteRegion();
-
+static StereoFrame16 GenerateFrame(SharedMemory& read, SharedMemory& write) {
     std::array<QuadFrame32, 3> intermediate_mixes = {};
 
     // Generate intermediate mixes
@@ -116,10 +118,111 @@ static void OutputCurrentFrame(const StereoFrame16& frame) {
     }
 }
 
+// Audio thread
+//
+// When enabled, frames are generated on a dedicated thread one tick behind the emulated CPU. At
+// every tick the CPU thread publishes the results of the previous frame to shared memory, then
+// hands a snapshot of the current configuration to the audio thread and carries on.
+
+static std::thread audio_thread;
+static std::atomic<bool> audio_thread_running;
+/// Wakes up the audio thread when a frame has been requested
+static Common::Event frame_requested;
+/// Signalled by the audio thread when it has finished a frame
+static Common::Event frame_finished;
+/// Set while the audio thread is working on a frame
+static std::atomic<bool> frame_in_flight;
+/// Whether the results of the last frame still have to be published, only used on the CPU thread
+static bool frame_unpublished = false;
+
+/// Copy of the region the frame being generated reads from
+static SharedMemory frame_read_region;
+/// The frame being generated writes its results here, they are published by the next tick
+static SharedMemory frame_write_region;
+/// Index of the region the results of the frame being generated go to
+static size_t frame_write_region_index;
+
+static void AudioThreadLoop() {
+    Common::SetCurrentThreadName("Audio");
+    MicroProfileOnThreadCreate("Audio");
+
+    while (true) {
+        frame_requested.Wait();
+        if (!audio_thread_running)
+            return;
+
+        OutputCurrentFrame(GenerateFrame(frame_read_region, frame_write_region));
+
+        frame_in_flight = false;
+        frame_finished.Set();
+    }
+}
+
+/// Blocks until the audio thread has finished the frame it's working on, if any
+static void WaitForAudioThread() {
+    while (frame_in_flight) {
+        frame_finished.Wait();
+    }
+}
+
+/// Copies the parts of shared memory written by the DSP during a frame
+static void CopyFrameOutput(SharedMemory& dest, const SharedMemory& source) {
+    std::memcpy(&dest.source_statuses, &source.source_statuses, sizeof(source.source_statuses));
+    std::memcpy(&dest.dsp_status, &source.dsp_status, sizeof(source.dsp_status));
+    std::memcpy(&dest.intermediate_mix_samples, &source.intermediate_mix_samples,
+                sizeof(source.intermediate_mix_samples));
+    std::memcpy(&dest.final_samples, &source.final_samples, sizeof(source.final_samples));
+}
+
+/// Copies the configuration for the next frame and consumes its dirty flags, as GenerateFrame does
+static void SnapshotFrameInput() {
+    SharedMemory& read = ReadRegion();
+    std::memcpy(&frame_read_region, &read, sizeof(SharedMemory));
+    frame_write_region_index = 1 - CurrentRegionIndex();
+
+    // Acknowledge the configuration the frame consumes in the same way Source::ParseConfig and
+    // Mixers::ParseConfig do on the snapshot
+    for (auto& config : read.source_configurations.config) {
+        if (!config.dirty_raw)
+            continue;
+        if (config.buffer_queue_dirty)
+            config.buffers_dirty = 0;
+        config.dirty_raw = 0;
+    }
+    read.dsp_configuration.dirty_raw = 0;
+
+    // Fields the frame doesn't write keep the values they have in the destination region
+    CopyFrameOutput(frame_write_region, g_regions[frame_write_region_index]);
+}
+
+/// Copies the results of the last frame to the region it was generated for
+static void PublishFrameOutput() {
+    CopyFrameOutput(g_regions[frame_write_region_index], frame_write_region);
+}
+
+static void StartAudioThread() {
+    frame_in_flight = false;
+    frame_unpublished = false;
+    audio_thread_running = true;
+    audio_thread = std::thread(AudioThreadLoop);
+}
+
+static void StopAudioThread() {
+    if (!audio_thread.joinable())
+        return;
+
+    WaitForAudioThread();
+    audio_thread_running = false;
+    frame_requested.Set();
+    audio_thread.join();
+}
+
 void EnableStretching(bool enable) {
     if (perform_time_stretching == enable)
         return;
 
+    WaitForAudioThread();
+
     if (!enable) {
         FlushResidualStretcherAudio();
     }
@@ -128,7 +231,7 @@ void EnableStretching(bool enable) {
 
 // Public Interface
 
-void Init() {
+void Init(bool use_audio_thread) {
     DSP::HLE::ResetPipes();
 
     for (auto& source : sources) {
@@ -141,27 +244,46 @@ void Init() {
     if (sink) {
         time_stretcher.SetOutputSampleRate(sink->GetNativeSampleRate());
     }
+
+    if (use_audio_thread)
+        StartAudioThread();
 }
 
 void Shutdown() {
+    StopAudioThread();
+
     if (perform_time_stretching) {
         FlushResidualStretcherAudio();
     }
 }
 
 bool Tick() {
-    StereoFrame16 current_frame = {};
-
     // TODO: Check dsp::DSP semaphore (which indicates emulated application has finished writing to
     // shared memory region)
-    current_frame = GenerateCurrentFrame();
 
-    OutputCurrentFrame(current_frame);
+    if (!audio_thread.joinable()) {
+        OutputCurrentFrame(GenerateFrame(ReadRegion(), WriteRegion()));
+        return true;
+    }
+
+    // The interrupt for a frame is raised once its results are visible to the application
+    const bool frame_completed = frame_unpublished;
+    if (frame_unpublished) {
+        WaitForAudioThread();
+        PublishFrameOutput();
+        frame_unpublished = false;
+    }
+
+    SnapshotFrameInput();
+    frame_in_flight = true;
+    frame_unpublished = true;
+    frame_requested.Set();
 
-    return true;
+    return frame_completed;
 }
 
 void SetSink(std::unique_ptr<AudioCore::Sink> sink_) {
+    WaitForAudioThread();
     sink = std::move(sink_);
     time_stretcher.SetOutputSampleRate(sink->GetNativeSampleRate());
 }
@@ -549,8 +549,11 @@ static_assert(offsetof(SharedMemory, unknown14) % 2 == 0,
 #undef INSERT_PADDING_DSPWORDS
 #undef ASSERT_DSP_STRUCT
 
-/// Initialize DSP hardware
-void Init();
+/**
+ * Initialize DSP hardware
+ * @param use_audio_thread Generate audio frames on a dedicated thread instead of in Tick
+ */
+void Init(bool use_audio_thread = false);
 
 /// Shutdown DSP hardware
 void Shutdown();
@@ -558,6 +561,8 @@ void Shutdown();
 /**
  * Perform processing and updates state of current shared memory buffer.
  * This function is called every audio tick before triggering the audio interrupt.
+ * With the audio thread enabled, this publishes the previous frame and starts generating the
+ * current one in the background instead.
  * @return Whether an audio interrupt should be triggered this frame.
  */
 bool Tick();
@@ -43,6 +43,7 @@ void Source::MixInto(QuadFrame32& dest, size_t intermediate_mix_id) const {
 void Source::Reset() {
     current_frame.fill({});
     state = {};
+    current_buffer.clear();
 }
 
 void Source::ParseConfig(SourceConfiguration::Configuration& config,
@@ -210,7 +211,7 @@ void Source::ParseConfig(SourceConfiguration::Configuration& config,
 void Source::GenerateFrame() {
     current_frame.fill({});
 
-    if (state.current_buffer.empty() && !DequeueBuffer()) {
+    if (CurrentBufferEmpty() && !DequeueBuffer()) {
         state.enabled = false;
         state.buffer_update = true;
         state.current_buffer_id = 0;
@@ -221,17 +222,17 @@ void Source::GenerateFrame() {
 
     state.current_sample_number = state.next_sample_number;
     while (frame_position < current_frame.size()) {
-        if (state.current_buffer.empty() && !DequeueBuffer()) {
+        if (CurrentBufferEmpty() && !DequeueBuffer()) {
             break;
         }
 
         const size_t size_to_copy =
-            std::min(state.current_buffer.size(), current_frame.size() - frame_position);
+            std::min(current_buffer.size() - state.current_buffer_position,
+                     current_frame.size() - frame_position);
 
-        std::copy(state.current_buffer.begin(), state.current_buffer.begin() + size_to_copy,
-                  current_frame.begin() + frame_position);
-        state.current_buffer.erase(state.current_buffer.begin(),
-                                   state.current_buffer.begin() + size_to_copy);
+        const auto first = current_buffer.begin() + state.current_buffer_position;
+        std::copy(first, first + size_to_copy, current_frame.begin() + frame_position);
+        state.current_buffer_position += size_to_copy;
 
         frame_position += size_to_copy;
         state.next_sample_number += static_cast<u32>(size_to_copy);
@@ -241,8 +242,7 @@ void Source::GenerateFrame() {
 }
 
 bool Source::DequeueBuffer() {
-    ASSERT_MSG(state.current_buffer.empty(),
-               "Shouldn't dequeue; we still have data in current_buffer");
+    ASSERT_MSG(CurrentBufferEmpty(), "Shouldn't dequeue; we still have data in current_buffer");
 
     if (state.input_queue.empty())
         return false;
@@ -264,47 +264,51 @@ bool Source::DequeueBuffer() {
         const unsigned num_channels = buf.mono_or_stereo == MonoOrStereo::Stereo ? 2 : 1;
         switch (buf.format) {
         case Format::PCM8:
-            state.current_buffer = Codec::DecodePCM8(num_channels, memory, buf.length);
+            Codec::DecodePCM8(num_channels, memory, buf.length, decode_buffer);
             break;
         case Format::PCM16:
-            state.current_buffer = Codec::DecodePCM16(num_channels, memory, buf.length);
+            Codec::DecodePCM16(num_channels, memory, buf.length, decode_buffer);
             break;
         case Format::ADPCM:
             DEBUG_ASSERT(num_channels == 1);
-            state.current_buffer =
-                Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state);
+            Codec::DecodeADPCM(memory, buf.length, state.adpcm_coeffs, state.adpcm_state,
+                               decode_buffer);
             break;
         default:
             UNIMPLEMENTED();
+            decode_buffer.clear();
             break;
         }
     } else {
         LOG_WARNING(Audio_DSP,
                     "source_id=%zu buffer_id=%hu length=%u: Invalid physical address 0x%08X",
                     source_id, buf.buffer_id, buf.length, buf.physical_address);
-        state.current_buffer.clear();
+        current_buffer.clear();
+        state.current_buffer_position = 0;
         return true;
     }
 
     switch (state.interpolation_mode) {
     case InterpolationMode::None:
-        state.current_buffer =
-            AudioInterp::None(state.interp_state, state.current_buffer, state.rate_multiplier);
+        AudioInterp::None(state.interp_state, decode_buffer, state.rate_multiplier,
+                          current_buffer);
         break;
     case InterpolationMode::Linear:
-        state.current_buffer =
-            AudioInterp::Linear(state.interp_state, state.current_buffer, state.rate_multiplier);
+        AudioInterp::Linear(state.interp_state, decode_buffer, state.rate_multiplier,
+                            current_buffer);
         break;
     case InterpolationMode::Polyphase:
         // TODO(merry): Implement polyphase interpolation
-        state.current_buffer =
-            AudioInterp::Linear(state.interp_state, state.current_buffer, state.rate_multiplier);
+        AudioInterp::Linear(state.interp_state, decode_buffer, state.rate_multiplier,
+                            current_buffer);
         break;
     default:
         UNIMPLEMENTED();
+        current_buffer.clear();
         break;
     }
 
+    state.current_buffer_position = 0;
     state.current_sample_number = 0;
     state.next_sample_number = 0;
     state.current_buffer_id = buf.buffer_id;
@@ -312,7 +316,7 @@ bool Source::DequeueBuffer() {
 
     LOG_TRACE(Audio_DSP, "source_id=%zu buffer_id=%hu from_queue=%s current_buffer.size()=%zu",
               source_id, buf.buffer_id, buf.from_queue ? "true" : "false",
-              state.current_buffer.size());
+              current_buffer.size());
     return true;
 }
 
@@ -106,7 +106,8 @@ private:
 
         u32 current_sample_number = 0;
         u32 next_sample_number = 0;
-        std::vector<std::array<s16, 2>> current_buffer;
+        /// Number of samples of current_buffer that have already been played
+        size_t current_buffer_position = 0;
 
         // buffer_id state
 
@@ -130,6 +131,14 @@ private:
 
     } state;
 
+    // Sample buffers live outside of state so that Reset keeps their storage; once they have grown
+    // to the largest buffer the application uses, decoding and resampling don't allocate anymore.
+
+    /// Samples of the current buffer after decoding, before resampling
+    Codec::StereoBuffer16 decode_buffer;
+    /// Samples of the current buffer after resampling, played from current_buffer_position on
+    Codec::StereoBuffer16 current_buffer;
+
     // Internal functions
 
     /// INTERNAL: Update our internal state based on the current config.
@@ -139,6 +148,10 @@ private:
     /// INTERNAL: Dequeues a buffer and does preprocessing on it (decoding, resampling). Puts it
     /// into current_buffer.
     bool DequeueBuffer();
+    /// INTERNAL: Returns whether all samples of current_buffer have been played.
+    bool CurrentBufferEmpty() const {
+        return state.current_buffer_position >= current_buffer.size();
+    }
     /// INTERNAL: Generates a SourceStatus::Status based on our internal state.
     SourceStatus::Status GetCurrentStatus();
 };
@@ -16,15 +16,18 @@ constexpr u64 scale_mask = scale_factor - 1;
 /// Here we step over the input in steps of rate_multiplier, until we consume all of the input.
 /// Three adjacent samples are passed to fn each step.
 template <typename Function>
-static StereoBuffer16 StepOverSamples(State& state, const StereoBuffer16& input,
-                                      float rate_multiplier, Function fn) {
+static void StepOverSamples(State& state, const StereoBuffer16& input, float rate_multiplier,
+                            StereoBuffer16& output, Function fn) {
     ASSERT(rate_multiplier > 0);
+    ASSERT(&input != &output);
+
+    // Keeps the capacity of output, so steady state resampling doesn't allocate
+    output.clear();
 
     if (input.size() < 2)
-        return {};
+        return;
 
-    StereoBuffer16 output;
-    output.reserve(static_cast<size_t>(input.size() / rate_multiplier));
+    output.reserve(static_cast<size_t>(input.size() / rate_multiplier) + 1);
 
     u64 step_size = static_cast<u64>(rate_multiplier * scale_factor);
 
@@ -58,29 +61,29 @@ static StereoBuffer16 StepOverSamples(State& state, const StereoBuffer16& input,
 
     state.xn2 = input[input.size() - 2];
     state.xn1 = input[input.size() - 1];
-
-    return output;
 }
 
-StereoBuffer16 None(State& state, const StereoBuffer16& input, float rate_multiplier) {
-    return StepOverSamples(
-        state, input, rate_multiplier,
+void None(State& state, const StereoBuffer16& input, float rate_multiplier,
+          StereoBuffer16& output) {
+    StepOverSamples(
+        state, input, rate_multiplier, output,
         [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) { return x0; });
 }
 
-StereoBuffer16 Linear(State& state, const StereoBuffer16& input, float rate_multiplier) {
+void Linear(State& state, const StereoBuffer16& input, float rate_multiplier,
+            StereoBuffer16& output) {
     // Note on accuracy: Some values that this produces are +/- 1 from the actual firmware.
-    return StepOverSamples(state, input, rate_multiplier,
-                           [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) {
-                               // This is a saturated subtraction. (Verified by black-box fuzzing.)
-                               s64 delta0 = MathUtil::Clamp<s64>(x1[0] - x0[0], -32768, 32767);
-                               s64 delta1 = MathUtil::Clamp<s64>(x1[1] - x0[1], -32768, 32767);
-
-                               return std::array<s16, 2>{
-                                   static_cast<s16>(x0[0] + fraction * delta0 / scale_factor),
-                                   static_cast<s16>(x0[1] + fraction * delta1 / scale_factor),
-                               };
-                           });
+    StepOverSamples(state, input, rate_multiplier, output,
+                    [](u64 fraction, const auto& x0, const auto& x1, const auto& x2) {
+                        // This is a saturated subtraction. (Verified by black-box fuzzing.)
+                        s64 delta0 = MathUtil::Clamp<s64>(x1[0] - x0[0], -32768, 32767);
+                        s64 delta1 = MathUtil::Clamp<s64>(x1[1] - x0[1], -32768, 32767);
+
+                        return std::array<s16, 2>{
+                            static_cast<s16>(x0[0] + fraction * delta0 / scale_factor),
+                            static_cast<s16>(x0[1] + fraction * delta1 / scale_factor),
+                        };
+                    });
 }
 
 } // namespace AudioInterp
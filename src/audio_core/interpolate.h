@@ -25,9 +25,11 @@ struct State {
  * @param rate_multiplier Stretch factor. Must be a positive non-zero value.
  *                        rate_multiplier > 1.0 performs decimation and rate_multipler < 1.0
  *                        performs upsampling.
- * @return The resampled audio buffer.
+ * @param output Receives the resampled audio. Its storage is reused, so passing the same buffer
+ *               every time avoids heap allocations. Must not be the input buffer.
  */
-StereoBuffer16 None(State& state, const StereoBuffer16& input, float rate_multiplier);
+void None(State& state, const StereoBuffer16& input, float rate_multiplier,
+          StereoBuffer16& output);
 
 /**
  * Linear interpolation. This is equivalent to a first-order hold. There is a two-sample predelay.
@@ -35,8 +37,10 @@ StereoBuffer16 None(State& state, const StereoBuffer16& input, float rate_multip
  * @param rate_multiplier Stretch factor. Must be a positive non-zero value.
  *                        rate_multiplier > 1.0 performs decimation and rate_multipler < 1.0
  *                        performs upsampling.
- * @return The resampled audio buffer.
+ * @param output Receives the resampled audio. Its storage is reused, so passing the same buffer
+ *               every time avoids heap allocations. Must not be the input buffer.
  */
-StereoBuffer16 Linear(State& state, const StereoBuffer16& input, float rate_multiplier);
+void Linear(State& state, const StereoBuffer16& input, float rate_multiplier,
+            StereoBuffer16& output);
 
 } // namespace AudioInterp
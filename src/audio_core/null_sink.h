@@ -23,6 +23,14 @@ public:
     size_t SamplesInQueue() const override {
         return 0;
     }
+
+    u64 GetUnderrunCount() const override {
+        return 0;
+    }
+
+    u64 GetOverrunCount() const override {
+        return 0;
+    }
 };
 
 } // namespace AudioCore
@@ -2,14 +2,17 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
-#include <list>
-#include <numeric>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <SDL.h>
 #include "audio_core/audio_core.h"
 #include "audio_core/sdl2_sink.h"
 #include "common/assert.h"
 #include "common/logging/log.h"
+#include "common/ring_buffer.h"
+#include "core/settings.h"
 
 namespace AudioCore {
 
@@ -18,7 +21,24 @@ struct SDL2Sink::Impl {
 
     SDL_AudioDeviceID audio_device_id = 0;
 
-    std::list<std::vector<s16>> queue;
+    /// A stereo PCM16 sample
+    using Frame = std::array<s16, 2>;
+
+    /// Samples waiting to be played, filled by the emulator and drained by the SDL callback
+    std::unique_ptr<Common::RingBuffer<Frame>> queue;
+
+    /// Number of EnqueueSamples calls, used by the callback to tell whether emulation is running
+    std::atomic<u64> enqueue_count{0};
+
+    std::atomic<u64> underrun_count{0};
+    std::atomic<u64> overrun_count{0};
+
+    // Only touched by the callback
+    u64 last_enqueue_count = 0;
+    /// Whether the previous callback got all the samples it asked for
+    bool playing = false;
+    /// Whether the previous callback ran out of samples while playing
+    bool pending_underrun = false;
 
     static void Callback(void* impl_, u8* buffer, int buffer_size_in_bytes);
 };
@@ -51,6 +71,12 @@ SDL2Sink::SDL2Sink() : impl(std::make_unique<Impl>()) {
 
     impl->sample_rate = obtained_audiospec.freq;
 
+    // Queue up to the target latency worth of samples, and at least one device buffer
+    const size_t target_samples =
+        static_cast<size_t>(std::max(Settings::values.audio_latency, 0)) * impl->sample_rate / 1000;
+    impl->queue = std::make_unique<Common::RingBuffer<Impl::Frame>>(
+        std::max<size_t>(target_samples, obtained_audiospec.samples));
+
     // SDL2 audio devices start out paused, unpause it:
     SDL_PauseAudioDevice(impl->audio_device_id, 0);
 }
@@ -60,6 +86,12 @@ SDL2Sink::~SDL2Sink() {
         return;
 
     SDL_CloseAudioDevice(impl->audio_device_id);
+
+    if (impl->underrun_count > 0 || impl->overrun_count > 0) {
+        LOG_INFO(Audio_Sink, "%llu buffer underruns, %llu buffer overruns",
+                 static_cast<unsigned long long>(impl->underrun_count),
+                 static_cast<unsigned long long>(impl->overrun_count));
+    }
 }
 
 unsigned int SDL2Sink::GetNativeSampleRate() const {
@@ -73,53 +105,52 @@ void SDL2Sink::EnqueueSamples(const s16* samples, size_t sample_count) {
     if (impl->audio_device_id <= 0)
         return;
 
-    SDL_LockAudioDevice(impl->audio_device_id);
-    impl->queue.emplace_back(samples, samples + sample_count * 2);
-    SDL_UnlockAudioDevice(impl->audio_device_id);
+    ++impl->enqueue_count;
+    const size_t pushed =
+        impl->queue->Push(reinterpret_cast<const Impl::Frame*>(samples), sample_count);
+    if (pushed < sample_count) {
+        // The queue is full, drop the samples that don't fit
+        ++impl->overrun_count;
+    }
 }
 
 size_t SDL2Sink::SamplesInQueue() const {
     if (impl->audio_device_id <= 0)
         return 0;
 
-    SDL_LockAudioDevice(impl->audio_device_id);
-
-    size_t total_size = std::accumulate(impl->queue.begin(), impl->queue.end(),
-                                        static_cast<size_t>(0), [](size_t sum, const auto& buffer) {
-                                            // Division by two because each stereo sample is made of
-                                            // two s16.
-                                            return sum + buffer.size() / 2;
-                                        });
+    return impl->queue->Size();
+}
 
-    SDL_UnlockAudioDevice(impl->audio_device_id);
+u64 SDL2Sink::GetUnderrunCount() const {
+    return impl->underrun_count;
+}
 
-    return total_size;
+u64 SDL2Sink::GetOverrunCount() const {
+    return impl->overrun_count;
 }
 
 void SDL2Sink::Impl::Callback(void* impl_, u8* buffer, int buffer_size_in_bytes) {
     Impl* impl = reinterpret_cast<Impl*>(impl_);
 
-    size_t remaining_size = static_cast<size_t>(buffer_size_in_bytes) /
-                            sizeof(s16); // Keep track of size in 16-bit increments.
-
-    while (remaining_size > 0 && !impl->queue.empty()) {
-        if (impl->queue.front().size() <= remaining_size) {
-            memcpy(buffer, impl->queue.front().data(), impl->queue.front().size() * sizeof(s16));
-            buffer += impl->queue.front().size() * sizeof(s16);
-            remaining_size -= impl->queue.front().size();
-            impl->queue.pop_front();
-        } else {
-            memcpy(buffer, impl->queue.front().data(), remaining_size * sizeof(s16));
-            buffer += remaining_size * sizeof(s16);
-            impl->queue.front().erase(impl->queue.front().begin(),
-                                      impl->queue.front().begin() + remaining_size);
-            remaining_size = 0;
-        }
-    }
+    const size_t frame_count = static_cast<size_t>(buffer_size_in_bytes) / sizeof(Frame);
+    const size_t popped = impl->queue->Pop(reinterpret_cast<Frame*>(buffer), frame_count);
 
-    if (remaining_size > 0) {
-        memset(buffer, 0, remaining_size * sizeof(s16));
+    const bool starved = popped < frame_count;
+    if (starved) {
+        std::memset(buffer + popped * sizeof(Frame), 0, (frame_count - popped) * sizeof(Frame));
     }
+
+    // The queue also runs dry before the first samples arrive and whenever emulation is paused,
+    // which isn't an underrun. So running out only counts once playback has got going, and only
+    // if samples keep being enqueued until the next callback.
+    const u64 enqueue_count = impl->enqueue_count.load();
+    const bool enqueuing = enqueue_count != impl->last_enqueue_count;
+    impl->last_enqueue_count = enqueue_count;
+
+    if (impl->pending_underrun && enqueuing)
+        ++impl->underrun_count;
+    impl->pending_underrun = starved && impl->playing && enqueuing;
+    impl->playing = !starved;
 }
 
 } // namespace AudioCore
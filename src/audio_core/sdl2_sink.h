@@ -21,6 +21,10 @@ public:
 
     size_t SamplesInQueue() const override;
 
+    u64 GetUnderrunCount() const override;
+
+    u64 GetOverrunCount() const override;
+
 private:
     struct Impl;
     std::unique_ptr<Impl> impl;
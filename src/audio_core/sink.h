@@ -31,6 +31,12 @@ public:
 
     /// Samples enqueued that have not been played yet.
     virtual std::size_t SamplesInQueue() const = 0;
+
+    /// Number of times playback ran out of samples while they were still being enqueued.
+    virtual u64 GetUnderrunCount() const = 0;
+
+    /// Number of times samples were dropped because the sink couldn't hold any more.
+    virtual u64 GetOverrunCount() const = 0;
 };
 
 } // namespace
@@ -22,7 +22,9 @@
 #endif
 
 #include "citra/config.h"
+#include "citra/emu_window/emu_window_headless.h"
 #include "citra/emu_window/emu_window_sdl2.h"
+#include "common/file_util.h"
 #include "common/logging/backend.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
@@ -34,13 +36,17 @@
 #include "core/loader/loader.h"
 #include "core/settings.h"
 #include "core/system.h"
+#include "video_core/renderer_base.h"
 #include "video_core/video_core.h"
 
 static void PrintHelp(const char* argv0) {
     std::cout << "Usage: " << argv0
               << " [options] <filename>\n"
+                 "-d, --dump-frames=N   When headless, dump every Nth frame to the dump directory\n"
+                 "-f, --frames=N        When headless, exit after rendering N frames\n"
                  "-g, --gdbport=NUMBER  Enable gdb stub on port NUMBER\n"
                  "-h, --help            Display this help and exit\n"
+                 "-n, --headless        Run without a window, using the software renderer\n"
                  "-v, --version         Output version information and exit\n";
 }
 
@@ -54,6 +60,9 @@ int main(int argc, char** argv) {
     int option_index = 0;
     bool use_gdbstub = Settings::values.use_gdbstub;
     u32 gdb_port = static_cast<u32>(Settings::values.gdbstub_port);
+    bool use_headless = Settings::values.use_headless_renderer;
+    int frame_dump_interval = Settings::values.headless_frame_dump_interval;
+    int frame_limit = Settings::values.headless_frame_limit;
     char* endarg;
 #ifdef _WIN64
     int argc_w;
@@ -67,16 +76,39 @@ int main(int argc, char** argv) {
     std::string boot_filename;
 
     static struct option long_options[] = {
+        {"dump-frames", required_argument, 0, 'd'},
+        {"frames", required_argument, 0, 'f'},
         {"gdbport", required_argument, 0, 'g'},
         {"help", no_argument, 0, 'h'},
+        {"headless", no_argument, 0, 'n'},
         {"version", no_argument, 0, 'v'},
         {0, 0, 0, 0},
     };
 
     while (optind < argc) {
-        char arg = getopt_long(argc, argv, "g:hv", long_options, &option_index);
+        char arg = getopt_long(argc, argv, "d:f:g:hnv", long_options, &option_index);
         if (arg != -1) {
             switch (arg) {
+            case 'd':
+                errno = 0;
+                frame_dump_interval = strtol(optarg, &endarg, 0);
+                if (endarg == optarg || frame_dump_interval < 0)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--dump-frames");
+                    exit(1);
+                }
+                break;
+            case 'f':
+                errno = 0;
+                frame_limit = strtol(optarg, &endarg, 0);
+                if (endarg == optarg || frame_limit < 0)
+                    errno = EINVAL;
+                if (errno != 0) {
+                    perror("--frames");
+                    exit(1);
+                }
+                break;
             case 'g':
                 errno = 0;
                 gdb_port = strtoul(optarg, &endarg, 0);
@@ -91,6 +123,9 @@ int main(int argc, char** argv) {
             case 'h':
                 PrintHelp(argv[0]);
                 return 0;
+            case 'n':
+                use_headless = true;
+                break;
             case 'v':
                 PrintVersion();
                 return 0;
@@ -111,6 +146,7 @@ int main(int argc, char** argv) {
 
     Log::Filter log_filter(Log::Level::Debug);
     Log::SetFilter(&log_filter);
+    SCOPE_EXIT({ Log::StopAsyncLogging(); });
 
     MicroProfileOnThreadCreate("EmuThread");
     SCOPE_EXIT({ MicroProfileShutdown(); });
@@ -121,15 +157,29 @@ int main(int argc, char** argv) {
     }
 
     log_filter.ParseFilterString(Settings::values.log_filter);
+    if (Settings::values.use_async_logging)
+        Log::StartAsyncLogging(FileUtil::GetUserPath(F_MAINLOG_IDX));
 
     // Apply the command line arguments
     Settings::values.gdbstub_port = gdb_port;
     Settings::values.use_gdbstub = use_gdbstub;
+    Settings::values.use_headless_renderer = use_headless;
+    Settings::values.headless_frame_dump_interval = frame_dump_interval;
+    Settings::values.headless_frame_limit = frame_limit;
     Settings::Apply();
 
-    std::unique_ptr<EmuWindow_SDL2> emu_window = std::make_unique<EmuWindow_SDL2>();
+    std::unique_ptr<EmuWindow_Headless> headless_window;
+    std::unique_ptr<EmuWindow_SDL2> sdl_window;
+    EmuWindow* emu_window;
+    if (use_headless) {
+        headless_window = std::make_unique<EmuWindow_Headless>();
+        emu_window = headless_window.get();
+    } else {
+        sdl_window = std::make_unique<EmuWindow_SDL2>();
+        emu_window = sdl_window.get();
+    }
 
-    System::Init(emu_window.get());
+    System::Init(emu_window);
     SCOPE_EXIT({ System::Shutdown(); });
 
     std::unique_ptr<Loader::AppLoader> loader = Loader::GetLoader(boot_filename);
@@ -144,8 +194,15 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    while (emu_window->IsOpen()) {
+    // The headless window can't be closed, it runs until the frame limit is reached, if any
+    while (sdl_window == nullptr || sdl_window->IsOpen()) {
         Core::RunLoop();
+
+        if (use_headless && frame_limit > 0 &&
+            VideoCore::g_renderer->GetCurrentFrame() >= frame_limit) {
+            LOG_INFO(Frontend, "Rendered %d frames, exiting", frame_limit);
+            break;
+        }
     }
 
     return 0;
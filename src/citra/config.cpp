@@ -68,6 +68,17 @@ void Config::ReadValues() {
     Settings::values.use_scaled_resolution =
         sdl2_config->GetBoolean("Renderer", "use_scaled_resolution", false);
     Settings::values.use_vsync = sdl2_config->GetBoolean("Renderer", "use_vsync", false);
+    Settings::values.sw_rasterizer_threads =
+        sdl2_config->GetInteger("Renderer", "sw_rasterizer_threads", 0);
+    Settings::values.vertex_shader_threads =
+        sdl2_config->GetInteger("Renderer", "vertex_shader_threads", 1);
+    Settings::values.use_async_gpu = sdl2_config->GetBoolean("Renderer", "use_async_gpu", false);
+    Settings::values.use_headless_renderer =
+        sdl2_config->GetBoolean("Renderer", "use_headless_renderer", false);
+    Settings::values.headless_frame_dump_interval =
+        sdl2_config->GetInteger("Renderer", "headless_frame_dump_interval", 0);
+    Settings::values.headless_frame_limit =
+        sdl2_config->GetInteger("Renderer", "headless_frame_limit", 0);
 
     Settings::values.bg_red = (float)sdl2_config->GetReal("Renderer", "bg_red", 1.0);
     Settings::values.bg_green = (float)sdl2_config->GetReal("Renderer", "bg_green", 1.0);
@@ -81,6 +92,8 @@ void Config::ReadValues() {
     Settings::values.sink_id = sdl2_config->Get("Audio", "output_engine", "auto");
     Settings::values.enable_audio_stretching =
         sdl2_config->GetBoolean("Audio", "enable_audio_stretching", true);
+    Settings::values.use_audio_thread = sdl2_config->GetBoolean("Audio", "use_audio_thread", false);
+    Settings::values.audio_latency = sdl2_config->GetInteger("Audio", "audio_latency", 250);
 
     // Data Storage
     Settings::values.use_virtual_sd =
@@ -92,6 +105,8 @@ void Config::ReadValues() {
 
     // Miscellaneous
     Settings::values.log_filter = sdl2_config->Get("Miscellaneous", "log_filter", "*:Info");
+    Settings::values.use_async_logging =
+        sdl2_config->GetBoolean("Miscellaneous", "use_async_logging", false);
 
     // Debugging
     Settings::values.use_gdbstub = sdl2_config->GetBoolean("Debugging", "use_gdbstub", false);
@@ -63,6 +63,35 @@ use_scaled_resolution =
 # 0 (default): Off, 1: On
 use_vsync =
 
+# Number of threads used by the software renderer to shade screen tiles in parallel.
+# 0 (default): One per host CPU core, 1: Single-threaded, 2 or more: That many threads, up to one
+# per host CPU core
+sw_rasterizer_threads =
+
+# Number of threads used to run the vertex shader of large draw calls in parallel.
+# Each thread starts from its own copy of the shader registers, so temporary registers that a
+# shader reads before writing them no longer carry over from the previous vertex.
+# 0: One per host CPU core, 1 (default): Single-threaded, 2 or more: That many threads, up to one
+# per host CPU core
+vertex_shader_threads =
+
+# Whether to process GPU commands on a separate thread, overlapping them with CPU emulation.
+# Only takes effect with the software renderer and takes effect on the next boot.
+# 0 (default): Off, 1: On
+use_async_gpu =
+
+# Whether to run without a window or GPU, rendering with the software renderer into memory only.
+# 0 (default): Off, 1: On
+use_headless_renderer =
+
+# When running headless, writes every Nth frame to the frame dump directory as a PPM image.
+# 0 (default): Never, N: Every Nth frame
+headless_frame_dump_interval =
+
+# When running headless, exits after rendering this many frames.
+# 0 (default): Run until the process is terminated, N: Exit after N frames
+headless_frame_limit =
+
 [Layout]
 # Layout for the screen inside the render window.
 # 0 (default): Default Top Bottom Screen, 1: Single Screen Only, 2: Large Screen Small Screen
@@ -90,6 +119,16 @@ output_engine =
 # 0: No, 1 (default): Yes
 enable_audio_stretching =
 
+# Whether to generate audio frames on a separate thread.
+# This takes work off the emulated CPU thread, at the cost of one audio frame of latency.
+# 0 (default): No, 1: Yes
+use_audio_thread =
+
+# The maximum amount of audio, in milliseconds, queued for output. Samples beyond it are dropped.
+# Lower values reduce latency but make audio more likely to crackle.
+# Must be at least 250 (default) for audio stretching to work well.
+audio_latency =
+
 [Data Storage]
 # Whether to create a virtual SD card.
 # 1 (default): Yes, 0: No
@@ -109,6 +148,11 @@ region_value =
 # Examples: *:Debug Kernel.SVC:Trace Service.*:Critical
 log_filter = *:Info
 
+# Whether to write log messages from a background thread, and to the log file in the user directory
+# If the queue of messages fills up, messages are dropped instead of slowing down emulation
+# 0 (default): Write messages from the thread logging them, 1: Write them from a background thread
+use_async_logging =
+
 [Debugging]
 # Port for listening to GDB connections.
 use_gdbstub=false
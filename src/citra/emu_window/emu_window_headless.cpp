@@ -0,0 +1,22 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "citra/emu_window/emu_window_headless.h"
+#include "common/logging/log.h"
+#include "video_core/renderer_headless/renderer_headless.h"
+
+EmuWindow_Headless::EmuWindow_Headless() {
+    UpdateCurrentFramebufferLayout(RendererHeadless::kImageWidth, RendererHeadless::kImageHeight);
+    LOG_INFO(Frontend, "Running headless");
+}
+
+EmuWindow_Headless::~EmuWindow_Headless() {}
+
+void EmuWindow_Headless::SwapBuffers() {}
+
+void EmuWindow_Headless::PollEvents() {}
+
+void EmuWindow_Headless::MakeCurrent() {}
+
+void EmuWindow_Headless::DoneCurrent() {}
@@ -0,0 +1,30 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/emu_window.h"
+
+/**
+ * Window for running without a display, to be used with the headless renderer. It has no graphics
+ * context and receives no input. It stays open until the process is terminated, or until the
+ * frame limit given on the command line is reached.
+ */
+class EmuWindow_Headless : public EmuWindow {
+public:
+    EmuWindow_Headless();
+    ~EmuWindow_Headless();
+
+    /// Swap buffers to display the next frame
+    void SwapBuffers() override;
+
+    /// Polls window events
+    void PollEvents() override;
+
+    /// Makes the graphics context current for the caller thread
+    void MakeCurrent() override;
+
+    /// Releases the GL context from the caller thread
+    void DoneCurrent() override;
+};
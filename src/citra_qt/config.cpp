@@ -51,6 +51,9 @@ void Config::ReadValues() {
     Settings::values.use_scaled_resolution =
         qt_config->value("use_scaled_resolution", false).toBool();
     Settings::values.use_vsync = qt_config->value("use_vsync", false).toBool();
+    Settings::values.sw_rasterizer_threads = qt_config->value("sw_rasterizer_threads", 0).toInt();
+    Settings::values.vertex_shader_threads = qt_config->value("vertex_shader_threads", 1).toInt();
+    Settings::values.use_async_gpu = qt_config->value("use_async_gpu", false).toBool();
 
     Settings::values.bg_red = qt_config->value("bg_red", 1.0).toFloat();
     Settings::values.bg_green = qt_config->value("bg_green", 1.0).toFloat();
@@ -66,6 +69,8 @@ void Config::ReadValues() {
     Settings::values.sink_id = qt_config->value("output_engine", "auto").toString().toStdString();
     Settings::values.enable_audio_stretching =
         qt_config->value("enable_audio_stretching", true).toBool();
+    Settings::values.use_audio_thread = qt_config->value("use_audio_thread", false).toBool();
+    Settings::values.audio_latency = qt_config->value("audio_latency", 250).toInt();
     qt_config->endGroup();
 
     qt_config->beginGroup("Data Storage");
@@ -79,6 +84,7 @@ void Config::ReadValues() {
 
     qt_config->beginGroup("Miscellaneous");
     Settings::values.log_filter = qt_config->value("log_filter", "*:Info").toString().toStdString();
+    Settings::values.use_async_logging = qt_config->value("use_async_logging", false).toBool();
     qt_config->endGroup();
 
     qt_config->beginGroup("Debugging");
@@ -160,6 +166,9 @@ void Config::SaveValues() {
     qt_config->setValue("use_shader_jit", Settings::values.use_shader_jit);
     qt_config->setValue("use_scaled_resolution", Settings::values.use_scaled_resolution);
     qt_config->setValue("use_vsync", Settings::values.use_vsync);
+    qt_config->setValue("sw_rasterizer_threads", Settings::values.sw_rasterizer_threads);
+    qt_config->setValue("vertex_shader_threads", Settings::values.vertex_shader_threads);
+    qt_config->setValue("use_async_gpu", Settings::values.use_async_gpu);
 
     // Cast to double because Qt's written float values are not human-readable
     qt_config->setValue("bg_red", (double)Settings::values.bg_red);
@@ -175,6 +184,8 @@ void Config::SaveValues() {
     qt_config->beginGroup("Audio");
     qt_config->setValue("output_engine", QString::fromStdString(Settings::values.sink_id));
     qt_config->setValue("enable_audio_stretching", Settings::values.enable_audio_stretching);
+    qt_config->setValue("use_audio_thread", Settings::values.use_audio_thread);
+    qt_config->setValue("audio_latency", Settings::values.audio_latency);
     qt_config->endGroup();
 
     qt_config->beginGroup("Data Storage");
@@ -188,6 +199,7 @@ void Config::SaveValues() {
 
     qt_config->beginGroup("Miscellaneous");
     qt_config->setValue("log_filter", QString::fromStdString(Settings::values.log_filter));
+    qt_config->setValue("use_async_logging", Settings::values.use_async_logging);
     qt_config->endGroup();
 
     qt_config->beginGroup("Debugging");
@@ -32,6 +32,7 @@
 #include "citra_qt/main.h"
 #include "citra_qt/stereoscopic_controller.h"
 #include "citra_qt/ui_settings.h"
+#include "common/file_util.h"
 #include "common/logging/backend.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
@@ -643,6 +644,7 @@ void GMainWindow::closeEvent(QCloseEvent* event) {
 int main(int argc, char* argv[]) {
     Log::Filter log_filter(Log::Level::Info);
     Log::SetFilter(&log_filter);
+    SCOPE_EXIT({ Log::StopAsyncLogging(); });
 
     MicroProfileOnThreadCreate("Frontend");
     SCOPE_EXIT({ MicroProfileShutdown(); });
@@ -660,8 +662,10 @@ int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "C");
 
     GMainWindow main_window;
-    // After settings have been loaded by GMainWindow, apply the filter
+    // After settings have been loaded by GMainWindow, apply the filter and logging mode
     log_filter.ParseFilterString(Settings::values.log_filter);
+    if (Settings::values.use_async_logging)
+        Log::StartAsyncLogging(FileUtil::GetUserPath(F_MAINLOG_IDX));
 
     main_window.show();
     return app.exec();
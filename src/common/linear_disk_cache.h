@@ -4,11 +4,11 @@
 
 #pragma once
 
+#include <cstring>
 #include <fstream>
 #include "common/common_types.h"
-
-// defined in Version.cpp
-extern const char* scm_rev_git_str;
+#include "common/file_util.h"
+#include "common/scm_rev.h"
 
 // On disk format:
 // header{
@@ -138,7 +138,7 @@ private:
         char file_header[sizeof(Header)];
 
         return (Read(file_header, sizeof(Header)) &&
-                !memcmp((const char*)&m_header, file_header, sizeof(Header)));
+                !std::memcmp((const char*)&m_header, file_header, sizeof(Header)));
     }
 
     template <typename D>
@@ -153,7 +153,8 @@ private:
 
     struct Header {
         Header() : id(*(u32*)"DCAC"), key_t_size(sizeof(K)), value_t_size(sizeof(V)) {
-            memcpy(ver, scm_rev_git_str, 40);
+            std::memset(ver, 0, sizeof(ver));
+            std::strncpy(ver, Common::g_scm_rev, sizeof(ver));
         }
 
         const u32 id;
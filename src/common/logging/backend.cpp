@@ -4,13 +4,21 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
 #include "common/assert.h"
 #include "common/common_funcs.h" // snprintf compatibility define
+#include "common/file_util.h"
 #include "common/logging/backend.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
 #include "common/logging/text_formatter.h"
+#include "common/thread.h"
 
 namespace Log {
 
@@ -105,17 +113,21 @@ const char* GetLevelName(Level log_level) {
 #undef LVL
 }
 
-Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
-                  const char* function, const char* format, va_list args) {
+/// Time elapsed since the first message was logged
+static std::chrono::microseconds GetTimestamp() {
     using std::chrono::steady_clock;
     using std::chrono::duration_cast;
 
     static steady_clock::time_point time_origin = steady_clock::now();
+    return duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
+}
 
+Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
+                  const char* function, const char* format, va_list args) {
     std::array<char, 4 * 1024> formatting_buffer;
 
     Entry entry;
-    entry.timestamp = duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
+    entry.timestamp = GetTimestamp();
     entry.log_class = log_class;
     entry.log_level = log_level;
 
@@ -135,6 +147,269 @@ void SetFilter(Filter* new_filter) {
     filter = new_filter;
 }
 
+// Asynchronous logging
+//
+// Messages are formatted on the thread that logs them into fixed-size entries of a bounded
+// multi-producer/single-consumer queue (after Dmitry Vyukov's bounded MPMC queue), so logging
+// never takes a lock or allocates. A background thread turns them into Entries and writes them out.
+
+/// Messages longer than this are truncated when logging asynchronously
+static constexpr size_t MAX_QUEUED_MESSAGE_SIZE = 512;
+/// Number of entries in the queue, must be a power of two
+static constexpr size_t QUEUE_SIZE = 1024;
+/// How long the logging thread sleeps when there are no messages
+static constexpr std::chrono::milliseconds LOGGING_THREAD_IDLE_TIME(10);
+
+struct QueuedEntry {
+    std::chrono::microseconds timestamp;
+    Class log_class;
+    Level log_level;
+    const char* filename;
+    const char* function;
+    unsigned int line_nr;
+    std::array<char, MAX_QUEUED_MESSAGE_SIZE> message;
+};
+
+struct QueueCell {
+    /// Tells producers and the consumer whose turn it is to use the cell
+    std::atomic<size_t> sequence;
+    QueuedEntry entry;
+};
+
+static std::array<QueueCell, QUEUE_SIZE> queue;
+static std::atomic<size_t> enqueue_position{0};
+/// Only touched by the logging thread
+static size_t dequeue_position = 0;
+/// Number of entries the logging thread has written out
+static std::atomic<size_t> written_count{0};
+static std::atomic<u64> dropped_count{0};
+
+static std::atomic<bool> async_logging_enabled{false};
+/// Number of LogMessage calls that may be enqueueing, which StopAsyncLogging waits for
+static std::atomic<int> active_producers{0};
+static std::atomic<bool> logging_thread_running{false};
+static std::thread logging_thread;
+static Common::Event messages_available;
+static Common::Event messages_written;
+
+/**
+ * Held while writing to the log file. Besides the logging thread, messages logged synchronously
+ * while the file is open write to it directly. Recursive, because rotating the file logs through
+ * FileUtil.
+ */
+static std::recursive_mutex log_file_mutex;
+static FileUtil::IOFile log_file;
+static std::string log_file_path;
+static u64 max_log_file_size;
+
+/**
+ * Formats a message into a free queue entry. Safe to call from any thread.
+ * @returns false if the queue was full, in which case the message is dropped
+ */
+static bool EnqueueMessage(Class log_class, Level log_level, const char* filename,
+                           unsigned int line_nr, const char* function, const char* format,
+                           va_list args) {
+    QueueCell* cell;
+    size_t position = enqueue_position.load(std::memory_order_relaxed);
+    while (true) {
+        cell = &queue[position & (QUEUE_SIZE - 1)];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const auto difference =
+            static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+        if (difference == 0) {
+            if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                       std::memory_order_relaxed))
+                break;
+        } else if (difference < 0) {
+            // The consumer hasn't freed this cell yet: the queue is full
+            return false;
+        } else {
+            position = enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+
+    QueuedEntry& entry = cell->entry;
+    entry.timestamp = GetTimestamp();
+    entry.log_class = log_class;
+    entry.log_level = log_level;
+    entry.filename = filename;
+    entry.function = function;
+    entry.line_nr = line_nr;
+    vsnprintf(entry.message.data(), entry.message.size(), format, args);
+
+    cell->sequence.store(position + 1, std::memory_order_release);
+
+    // Don't wait for the logging thread to wake up by itself if messages come in quickly
+    if ((position & (QUEUE_SIZE / 4 - 1)) == 0)
+        messages_available.Set();
+    return true;
+}
+
+/// Pops the oldest queued entry, if it has been fully written. Logging thread only.
+static const QueuedEntry* PeekQueuedEntry() {
+    const QueueCell& cell = queue[dequeue_position & (QUEUE_SIZE - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+        return nullptr;
+    return &cell.entry;
+}
+
+/// Releases the entry returned by PeekQueuedEntry to the producers. Logging thread only.
+static void PopQueuedEntry() {
+    queue[dequeue_position & (QUEUE_SIZE - 1)].sequence.store(dequeue_position + QUEUE_SIZE,
+                                                              std::memory_order_release);
+    ++dequeue_position;
+}
+
+static void WriteToLogFile(const Entry& entry) {
+    std::lock_guard<std::recursive_mutex> lock(log_file_mutex);
+    if (!log_file.IsOpen())
+        return;
+
+    std::array<char, 4 * 1024> format_buffer;
+    FormatLogMessage(entry, format_buffer.data(), format_buffer.size());
+    const size_t length = std::strlen(format_buffer.data());
+    format_buffer[length] = '\n';
+
+    if (log_file.Tell() + length + 1 > max_log_file_size) {
+        // Keep the previous file around and start a new one. Renaming doesn't replace an existing
+        // file everywhere, so the one from the last rotation is removed first.
+        log_file.Close();
+        const std::string old_log_file_path = log_file_path + ".old";
+        if (!FileUtil::Delete(old_log_file_path) ||
+            !FileUtil::Rename(log_file_path, old_log_file_path)) {
+            LOG_ERROR(Log, "Failed to move %s out of the way, starting it over",
+                      log_file_path.c_str());
+        }
+        log_file.Open(log_file_path, "w");
+    }
+    log_file.WriteBytes(format_buffer.data(), length + 1);
+}
+
+static void WriteEntry(const Entry& entry) {
+    PrintColoredMessage(entry);
+    WriteToLogFile(entry);
+}
+
+/**
+ * Writes out all complete entries in the queue. Logging thread only.
+ * @param entry Scratch entry, reused so that its strings don't need to be reallocated
+ * @param reported_dropped_count Number of dropped messages that have already been reported
+ */
+static void WriteQueuedEntries(Entry& entry, u64& reported_dropped_count) {
+    std::array<char, 1024> location_buffer;
+    bool wrote_any = false;
+
+    while (const QueuedEntry* queued = PeekQueuedEntry()) {
+        entry.timestamp = queued->timestamp;
+        entry.log_class = queued->log_class;
+        entry.log_level = queued->log_level;
+        snprintf(location_buffer.data(), location_buffer.size(), "%s:%s:%u", queued->filename,
+                 queued->function, queued->line_nr);
+        entry.location.assign(location_buffer.data());
+        entry.message.assign(queued->message.data());
+        PopQueuedEntry();
+
+        WriteEntry(entry);
+        written_count.fetch_add(1, std::memory_order_release);
+        wrote_any = true;
+    }
+
+    const u64 dropped = dropped_count.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped_count) {
+        entry.timestamp = GetTimestamp();
+        entry.log_class = Class::Log;
+        entry.log_level = Level::Warning;
+        entry.location = __FILE__ ":" + std::string(__func__) + ":" + std::to_string(__LINE__);
+        entry.message = std::to_string(dropped - reported_dropped_count) +
+                        " log messages were dropped because the queue was full";
+        WriteEntry(entry);
+        reported_dropped_count = dropped;
+    }
+
+    if (wrote_any) {
+        std::lock_guard<std::recursive_mutex> lock(log_file_mutex);
+        log_file.Flush();
+        messages_written.Set();
+    }
+}
+
+static void LoggingThreadLoop() {
+    Common::SetCurrentThreadName("Logging");
+
+    Entry entry;
+    u64 reported_dropped_count = dropped_count;
+
+    while (logging_thread_running) {
+        messages_available.WaitUntil(std::chrono::steady_clock::now() + LOGGING_THREAD_IDLE_TIME);
+        WriteQueuedEntries(entry, reported_dropped_count);
+    }
+    WriteQueuedEntries(entry, reported_dropped_count);
+}
+
+void StartAsyncLogging(const std::string& log_file_path_, u64 max_log_file_size_) {
+    if (logging_thread.joinable())
+        return;
+
+    for (size_t i = 0; i < QUEUE_SIZE; ++i) {
+        queue[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_position = 0;
+    dequeue_position = 0;
+    written_count = 0;
+
+    log_file_path = log_file_path_;
+    max_log_file_size = max_log_file_size_;
+    if (!log_file_path.empty()) {
+        FileUtil::CreateFullPath(log_file_path);
+        log_file.Open(log_file_path, "w");
+    }
+
+    logging_thread_running = true;
+    logging_thread = std::thread(LoggingThreadLoop);
+    async_logging_enabled = true;
+}
+
+void StopAsyncLogging() {
+    if (!logging_thread.joinable())
+        return;
+
+    // Wait for messages that are still being enqueued, so that the final drain writes them out.
+    // Producers that start later see that asynchronous logging is disabled.
+    async_logging_enabled = false;
+    while (active_producers != 0)
+        std::this_thread::yield();
+
+    logging_thread_running = false;
+    messages_available.Set();
+    logging_thread.join();
+
+    std::lock_guard<std::recursive_mutex> lock(log_file_mutex);
+    log_file.Close();
+}
+
+void FlushLogs() {
+    if (!logging_thread.joinable() || std::this_thread::get_id() == logging_thread.get_id())
+        return;
+
+    const size_t target = enqueue_position.load(std::memory_order_acquire);
+    while (written_count.load(std::memory_order_acquire) < target) {
+        messages_available.Set();
+        messages_written.WaitUntil(std::chrono::steady_clock::now() + LOGGING_THREAD_IDLE_TIME);
+    }
+}
+
+u64 GetDroppedMessageCount() {
+    return dropped_count;
+}
+
+/// Stops the logging thread on exit if the frontend hasn't done so, since it can't outlive main
+static struct AsyncLoggingShutdown {
+    ~AsyncLoggingShutdown() {
+        StopAsyncLogging();
+    }
+} async_logging_shutdown;
+
 void LogMessage(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
                 const char* function, const char* format, ...) {
     if (filter != nullptr && !filter->CheckMessage(log_class, log_level))
@@ -142,9 +417,41 @@ void LogMessage(Class log_class, Level log_level, const char* filename, unsigned
 
     va_list args;
     va_start(args, format);
+
+    // Registering as a producer before checking the flag guarantees that StopAsyncLogging either
+    // waits for this message or that it is written synchronously
+    ++active_producers;
+    if (async_logging_enabled) {
+        if (log_level == Level::Critical) {
+            // Critical messages usually precede a crash, make sure they get out. If the queue
+            // is still full after flushing it once, which is always the case when logging from
+            // the logging thread itself, the message is written directly.
+            bool queued =
+                EnqueueMessage(log_class, log_level, filename, line_nr, function, format, args);
+            if (!queued) {
+                FlushLogs();
+                queued = EnqueueMessage(log_class, log_level, filename, line_nr, function,
+                                        format, args);
+            }
+            if (queued) {
+                FlushLogs();
+            } else {
+                WriteEntry(
+                    CreateEntry(log_class, log_level, filename, line_nr, function, format, args));
+            }
+        } else if (!EnqueueMessage(log_class, log_level, filename, line_nr, function, format,
+                                   args)) {
+            dropped_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        --active_producers;
+        va_end(args);
+        return;
+    }
+    --active_producers;
+
     Entry entry = CreateEntry(log_class, log_level, filename, line_nr, function, format, args);
     va_end(args);
 
-    PrintColoredMessage(entry);
+    WriteEntry(entry);
 }
 }
@@ -8,6 +8,7 @@
 #include <cstdarg>
 #include <string>
 #include <utility>
+#include "common/common_types.h"
 #include "common/logging/log.h"
 
 namespace Log {
@@ -47,4 +48,28 @@ Entry CreateEntry(Class log_class, Level log_level, const char* filename, unsign
                   const char* function, const char* format, va_list args);
 
 void SetFilter(Filter* filter);
+
+/**
+ * Starts writing log messages from a background thread instead of the thread logging them. Messages
+ * are then queued without taking locks or allocating; if the queue is full they are dropped and
+ * counted rather than blocking the caller. Critical messages still wait until they are written, and
+ * are written directly if the queue stays full.
+ * @param log_file_path If not empty, messages are also written to this file
+ * @param max_log_file_size Once the log file would grow past this size in bytes, it is moved to
+ *                          `<log_file_path>.old` and a new one is started
+ */
+void StartAsyncLogging(const std::string& log_file_path = "",
+                       u64 max_log_file_size = 32 * 1024 * 1024);
+
+/**
+ * Writes out all queued messages and goes back to logging synchronously. Messages that other
+ * threads log while this runs are either written out before it returns or logged synchronously.
+ */
+void StopAsyncLogging();
+
+/// Blocks until all messages queued so far have been written.
+void FlushLogs();
+
+/// Returns the number of messages dropped because the asynchronous logging queue was full.
+u64 GetDroppedMessageCount();
 }
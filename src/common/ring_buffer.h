@@ -0,0 +1,91 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace Common {
+
+/**
+ * Fixed-capacity ring buffer for passing values from exactly one producer thread to exactly one
+ * consumer thread. Push and Pop never take locks, block or allocate; only the producer may call
+ * Push and only the consumer may call Pop. Size may be called from either thread.
+ */
+template <typename T>
+class RingBuffer {
+public:
+    /// Creates a buffer holding at least the given number of values
+    explicit RingBuffer(size_t min_capacity) {
+        size_t capacity = 1;
+        while (capacity < min_capacity)
+            capacity <<= 1;
+        storage.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    /**
+     * Appends as many of the given values as fit. Producer only.
+     * @returns the number of values appended, the rest are left out
+     */
+    size_t Push(const T* values, size_t count) {
+        const size_t write = write_index.load(std::memory_order_relaxed);
+        const size_t read = read_index.load(std::memory_order_acquire);
+        count = std::min(count, storage.size() - (write - read));
+
+        const size_t start = write & mask;
+        const size_t first = std::min(count, storage.size() - start);
+        std::copy_n(values, first, storage.begin() + start);
+        std::copy_n(values + first, count - first, storage.begin());
+
+        write_index.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * Removes up to max_count of the oldest values. Consumer only.
+     * @returns the number of values written to the output
+     */
+    size_t Pop(T* output, size_t max_count) {
+        const size_t read = read_index.load(std::memory_order_relaxed);
+        const size_t write = write_index.load(std::memory_order_acquire);
+        const size_t count = std::min(max_count, write - read);
+
+        const size_t start = read & mask;
+        const size_t first = std::min(count, storage.size() - start);
+        std::copy_n(storage.begin() + start, first, output);
+        std::copy_n(storage.begin(), count - first, output + first);
+
+        read_index.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    /// Number of values currently in the buffer
+    size_t Size() const {
+        // Load the read index first so that it can never be ahead of the write index
+        const size_t read = read_index.load(std::memory_order_acquire);
+        return write_index.load(std::memory_order_acquire) - read;
+    }
+
+    size_t Capacity() const {
+        return storage.size();
+    }
+
+private:
+    std::vector<T> storage;
+    size_t mask;
+
+    // Both indices increase monotonically and wrap around together, so their difference is
+    // always the number of values in the buffer
+    std::atomic<size_t> read_index{0};  ///< Written by the consumer only
+    std::atomic<size_t> write_index{0}; ///< Written by the producer only
+};
+
+} // namespace Common
@@ -0,0 +1,92 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace Common {
+
+/**
+ * Unbounded queue for passing values from exactly one producer thread to exactly one consumer
+ * thread. Push and Pop never take locks or block; only the producer may call Push and only the
+ * consumer may call Pop. Nodes the consumer is done with are recycled by the producer, so Push
+ * only allocates while the queue is growing past its largest size so far.
+ */
+template <typename T>
+class SPSCQueue {
+public:
+    SPSCQueue() {
+        Node* node = new Node;
+        first = head_copy = tail = node;
+        head.store(node, std::memory_order_relaxed);
+    }
+
+    ~SPSCQueue() {
+        while (first != nullptr) {
+            Node* next = first->next.load(std::memory_order_relaxed);
+            delete first;
+            first = next;
+        }
+    }
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    /// Appends a value to the queue. Producer only.
+    void Push(T value) {
+        // The tail node is always empty: fill it in, then publish a new empty tail after it
+        Node* new_tail = AllocateNode();
+        new_tail->next.store(nullptr, std::memory_order_relaxed);
+        tail->value = std::move(value);
+        tail->next.store(new_tail, std::memory_order_release);
+        tail = new_tail;
+    }
+
+    /**
+     * Removes the oldest value from the queue. Consumer only.
+     * @returns false if the queue was empty, in which case value is left untouched
+     */
+    bool Pop(T& value) {
+        Node* current = head.load(std::memory_order_relaxed);
+        Node* next = current->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+
+        value = std::move(current->value);
+        // Hands the node back to the producer, which may overwrite it from now on
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Node {
+        T value;
+        std::atomic<Node*> next{nullptr};
+    };
+
+    /// Returns a node the consumer has popped, or a new one if there is none. Producer only.
+    Node* AllocateNode() {
+        if (first == head_copy) {
+            head_copy = head.load(std::memory_order_acquire);
+            if (first == head_copy)
+                return new Node;
+        }
+
+        Node* node = first;
+        first = first->next.load(std::memory_order_relaxed);
+        return node;
+    }
+
+    std::atomic<Node*> head; ///< Oldest unpopped node, only advanced by the consumer
+
+    // Producer side. The list runs from first through head to tail; nodes before head have been
+    // popped and are free to reuse.
+    Node* first;     ///< Oldest node, either popped or equal to head_copy
+    Node* head_copy; ///< Value of head the last time the producer looked at it
+    Node* tail;      ///< Empty node that the next value goes into
+};
+
+} // namespace Common
@@ -0,0 +1,93 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <string>
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(size_t num_threads, const char* name)
+    : num_threads(std::max<size_t>(num_threads, 1)), name(name) {}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    work_cv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func,
+                             size_t max_threads) {
+    if (max_threads == 0 || max_threads > num_threads)
+        max_threads = num_threads;
+    const size_t num_workers = std::min(max_threads, count) - (count != 0 ? 1 : 0);
+    if (num_workers == 0) {
+        for (size_t i = 0; i < count; ++i)
+            func(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(submit_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (workers.size() < num_workers) {
+            const size_t index = workers.size();
+            workers.emplace_back(&ThreadPool::WorkerLoop, this, name + std::to_string(index + 1),
+                                 index);
+        }
+
+        job = &func;
+        job_count = count;
+        job_workers = num_workers;
+        next_index = 0;
+        busy_workers = num_workers;
+        ++job_id;
+    }
+    work_cv.notify_all();
+
+    RunJob();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return busy_workers == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::RunJob() {
+    size_t index;
+    while ((index = next_index.fetch_add(1)) < job_count) {
+        (*job)(index);
+    }
+}
+
+void ThreadPool::WorkerLoop(std::string name, size_t index) {
+    SetCurrentThreadName(name.c_str());
+
+    u64 last_job_id = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cv.wait(lock, [&] { return stop || job_id != last_job_id; });
+        if (stop)
+            return;
+        last_job_id = job_id;
+
+        // Workers beyond the number requested by the job sit it out
+        if (index >= job_workers)
+            continue;
+
+        lock.unlock();
+        RunJob();
+        lock.lock();
+
+        if (--busy_workers == 0)
+            done_cv.notify_one();
+    }
+}
+
+} // namespace Common
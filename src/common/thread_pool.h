@@ -0,0 +1,77 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/common_types.h"
+
+namespace Common {
+
+/**
+ * Pool of worker threads for data-parallel loops. The thread calling ParallelFor takes part in the
+ * work, so a pool created with num_threads == 1 spawns no workers at all and simply runs
+ * everything inline. Workers are only started once a loop needs them, so a pool that is shared by
+ * several users costs nothing until they actually run in parallel.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param num_threads Maximum number of threads doing work, including the calling thread
+     * @param name Name given to the worker threads
+     */
+    explicit ThreadPool(size_t num_threads, const char* name = "ThreadPool");
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Returns the maximum number of threads doing work, including the calling thread
+    size_t GetNumThreads() const {
+        return num_threads;
+    }
+
+    /**
+     * Runs func(i) for every i in [0, count), spread over the workers and the calling thread.
+     * Returns once all invocations have completed. Invocations may run in any order. Calls from
+     * several threads are serialized, and func must not call ParallelFor on the same pool.
+     * @param max_threads Maximum number of threads to use, including the calling thread, or 0 to
+     *                    use all of them
+     */
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func,
+                     size_t max_threads = 0);
+
+private:
+    void WorkerLoop(std::string name, size_t index);
+    void RunJob();
+
+    const size_t num_threads;
+    const std::string name;
+    std::vector<std::thread> workers;
+
+    /// Held for the whole duration of a ParallelFor call
+    std::mutex submit_mutex;
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+
+    const std::function<void(size_t)>* job = nullptr;
+    size_t job_count = 0;
+    size_t job_workers = 0; ///< Number of workers taking part in the current job
+    u64 job_id = 0;
+    size_t busy_workers = 0;
+    bool stop = false;
+
+    std::atomic<size_t> next_index{0};
+};
+
+} // namespace Common
@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <cstring>
 #include "core/aes/aes.h"
+#ifdef ARCHITECTURE_x86_64
+#include "core/aes/aes_ni.h"
+#endif
 
 namespace AES {
 static int wrap_index(int i) {
@@ -92,16 +97,61 @@ void AddCtr(std::array<u8, 16>& ctr, u32 carry) {
     }
 }
 
+void AesCtrKeystream(u8* out, size_t num_blocks, const std::array<u8, 16>& key,
+                     const std::array<u8, 16>& ctr) {
+    // Treat the counter as a 128-bit big-endian integer, matching AddCtr
+    u64 high = 0, low = 0;
+    for (int i = 0; i < 8; ++i) {
+        high = (high << 8) | ctr[i];
+        low = (low << 8) | ctr[i + 8];
+    }
+
+    for (size_t block = 0; block < num_blocks; ++block) {
+        u8* dest = out + block * 16;
+        for (int i = 0; i < 8; ++i) {
+            dest[i] = static_cast<u8>(high >> (56 - i * 8));
+            dest[i + 8] = static_cast<u8>(low >> (56 - i * 8));
+        }
+        if (++low == 0)
+            ++high;
+    }
+
+#ifdef ARCHITECTURE_x86_64
+    static const bool aes_ni = AesNiSupported();
+    if (aes_ni) {
+        AesNiEncryptBlocks(out, num_blocks, key);
+        return;
+    }
+#endif
+    AesEncryptBlocks(out, num_blocks, key);
+}
+
 void AesCtrDecrypt(void* data, u64 length, const std::array<u8, 16>& key,
                    const std::array<u8, 16>& ctr) {
+    // Number of keystream blocks generated per batch
+    constexpr size_t batch_blocks = 256;
+
     u8* p = reinterpret_cast<u8*>(data);
-    std::array<u8, 16> c(ctr), xorpad;
+    std::array<u8, 16> c(ctr);
+    std::array<u8, batch_blocks * 16> xorpad;
     while (length > 0) {
-        xorpad = AesCipher(c, key);
-        AddCtr(c, 1);
-        u64 l = length > 16 ? 16 : length;
-        for (u64 j = 0; j < l; ++j)
-            *(p++) ^= xorpad[j];
+        size_t blocks = static_cast<size_t>(std::min<u64>((length + 15) / 16, batch_blocks));
+        AesCtrKeystream(xorpad.data(), blocks, key, c);
+        AddCtr(c, static_cast<u32>(blocks));
+
+        size_t l = static_cast<size_t>(std::min<u64>(length, blocks * 16));
+        size_t j = 0;
+        for (; j + 8 <= l; j += 8) {
+            u64 a, b;
+            std::memcpy(&a, p + j, 8);
+            std::memcpy(&b, xorpad.data() + j, 8);
+            a ^= b;
+            std::memcpy(p + j, &a, 8);
+        }
+        for (; j < l; ++j)
+            p[j] ^= xorpad[j];
+
+        p += l;
         length -= l;
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
 #include "common/common_types.h"
 
@@ -15,6 +16,24 @@ extern const std::array<u8, 16> ZERO_KEY;
 std::array<u8, 16> MakeKey(int slot, const std::array<u8, 16>& y);
 void AddCtr(std::array<u8, 16>& ctr, u32 carry);
 std::array<u8, 16> AesCipher(const std::array<u8, 16>& input, const std::array<u8, 16>& key);
+
+/**
+ * Encrypts contiguous 16-byte blocks in place with AES-128, expanding the key only once.
+ * This is the portable implementation, used when no hardware acceleration is available.
+ */
+void AesEncryptBlocks(u8* data, size_t num_blocks, const std::array<u8, 16>& key);
+
+/**
+ * Generates the AES-CTR keystream for a run of consecutive counter values, using AES-NI when the
+ * host supports it.
+ * @param out Output buffer, at least num_blocks * 16 bytes
+ * @param num_blocks Number of 16-byte keystream blocks to generate
+ * @param key AES-128 key
+ * @param ctr Counter value of the first block
+ */
+void AesCtrKeystream(u8* out, size_t num_blocks, const std::array<u8, 16>& key,
+                     const std::array<u8, 16>& ctr);
+
 void AesCtrDecrypt(void* data, u64 length, const std::array<u8, 16>& key,
                    const std::array<u8, 16>& ctr);
 
@@ -248,4 +248,13 @@ std::array<u8, 16> AesCipher(const std::array<u8, 16>& input, const std::array<u
     Cipher();
     return output;
 }
+
+void AesEncryptBlocks(u8* data, size_t num_blocks, const std::array<u8, 16>& key) {
+    Key = key.data();
+    KeyExpansion();
+    for (size_t i = 0; i < num_blocks; ++i) {
+        state = (state_t*)(data + i * 16);
+        Cipher();
+    }
+}
 }
@@ -0,0 +1,75 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#include "common/x64/cpu_detect.h"
+#include "core/aes/aes_ni.h"
+
+#ifdef _MSC_VER
+#define AESNI_TARGET
+#else
+#define AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+namespace AES {
+
+template <int rcon>
+AESNI_TARGET static __m128i ExpandKeyStep(__m128i key) {
+    __m128i assist = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(key, rcon), 0xFF);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+AESNI_TARGET static void ExpandKey(const std::array<u8, 16>& key, __m128i (&round_keys)[11]) {
+    round_keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.data()));
+    round_keys[1] = ExpandKeyStep<0x01>(round_keys[0]);
+    round_keys[2] = ExpandKeyStep<0x02>(round_keys[1]);
+    round_keys[3] = ExpandKeyStep<0x04>(round_keys[2]);
+    round_keys[4] = ExpandKeyStep<0x08>(round_keys[3]);
+    round_keys[5] = ExpandKeyStep<0x10>(round_keys[4]);
+    round_keys[6] = ExpandKeyStep<0x20>(round_keys[5]);
+    round_keys[7] = ExpandKeyStep<0x40>(round_keys[6]);
+    round_keys[8] = ExpandKeyStep<0x80>(round_keys[7]);
+    round_keys[9] = ExpandKeyStep<0x1B>(round_keys[8]);
+    round_keys[10] = ExpandKeyStep<0x36>(round_keys[9]);
+}
+
+bool AesNiSupported() {
+    return Common::GetCPUCaps().aes;
+}
+
+AESNI_TARGET void AesNiEncryptBlocks(u8* data, size_t num_blocks,
+                                     const std::array<u8, 16>& key) {
+    __m128i round_keys[11];
+    ExpandKey(key, round_keys);
+
+    __m128i* blocks = reinterpret_cast<__m128i*>(data);
+
+    // Encrypt four blocks per iteration to keep the AESENC pipeline busy
+    constexpr size_t interleave = 4;
+    size_t i = 0;
+    for (; i + interleave <= num_blocks; i += interleave) {
+        __m128i b[interleave];
+        for (size_t j = 0; j < interleave; ++j)
+            b[j] = _mm_xor_si128(_mm_loadu_si128(blocks + i + j), round_keys[0]);
+        for (int round = 1; round < 10; ++round) {
+            for (size_t j = 0; j < interleave; ++j)
+                b[j] = _mm_aesenc_si128(b[j], round_keys[round]);
+        }
+        for (size_t j = 0; j < interleave; ++j)
+            _mm_storeu_si128(blocks + i + j, _mm_aesenclast_si128(b[j], round_keys[10]));
+    }
+
+    for (; i < num_blocks; ++i) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(blocks + i), round_keys[0]);
+        for (int round = 1; round < 10; ++round)
+            b = _mm_aesenc_si128(b, round_keys[round]);
+        _mm_storeu_si128(blocks + i, _mm_aesenclast_si128(b, round_keys[10]));
+    }
+}
+
+} // namespace AES
@@ -0,0 +1,25 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include "common/common_types.h"
+
+namespace AES {
+
+/// Returns whether the host CPU supports the AES-NI instruction set extension
+bool AesNiSupported();
+
+/**
+ * Encrypts a number of contiguous 16-byte blocks in place with AES-128 using AES-NI.
+ * Must only be called if AesNiSupported() returns true.
+ * @param data Pointer to the blocks to encrypt
+ * @param num_blocks Number of 16-byte blocks
+ * @param key AES-128 key
+ */
+void AesNiEncryptBlocks(u8* data, size_t num_blocks, const std::array<u8, 16>& key);
+
+} // namespace AES
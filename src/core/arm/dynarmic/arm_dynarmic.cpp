@@ -38,6 +38,20 @@ static bool IsReadOnlyMemory(u32 vaddr) {
     return false;
 }
 
+/**
+ * Lets the JIT access regular memory inline, only calling the memory callbacks for other pages.
+ * Dynarmic revisions without UserCallbacks::page_table pick the overload below instead.
+ */
+template <typename Callbacks>
+static auto SetPageTable(Callbacks& user_callbacks, int)
+    -> decltype(void(user_callbacks.page_table = Memory::GetCurrentPageTablePointers())) {
+    user_callbacks.page_table = Memory::GetCurrentPageTablePointers();
+}
+
+/// Fallback for Dynarmic revisions that only access memory through the callbacks
+template <typename Callbacks>
+static void SetPageTable(Callbacks& user_callbacks, long) {}
+
 static Dynarmic::UserCallbacks GetUserCallbacks(ARMul_State* interpeter_state) {
     Dynarmic::UserCallbacks user_callbacks{};
     user_callbacks.InterpreterFallback = &InterpreterFallback;
@@ -52,6 +66,7 @@ static Dynarmic::UserCallbacks GetUserCallbacks(ARMul_State* interpeter_state) {
     user_callbacks.MemoryWrite16 = &Memory::Write16;
     user_callbacks.MemoryWrite32 = &Memory::Write32;
     user_callbacks.MemoryWrite64 = &Memory::Write64;
+    SetPageTable(user_callbacks, 0);
     return user_callbacks;
 }
 
@@ -21,7 +21,7 @@ ARM_DynCom::ARM_DynCom(PrivilegeMode initial_mode) {
 ARM_DynCom::~ARM_DynCom() {}
 
 void ARM_DynCom::ClearInstructionCache() {
-    state->instruction_cache.clear();
+    state->instruction_cache.Clear();
     trans_cache_buf_top = 0;
 }
 
@@ -859,15 +859,18 @@ static int InterpreterTranslateBlock(ARMul_State* cpu, int& bb_start, u32 addr)
 
         size++;
 
+        // End the block with the instruction that reaches the end of the page, so that blocks only
+        // contain instructions starting in the page the block starts in
+        const u32 inst_page = phys_addr >> 12;
         phys_addr += inst_size;
 
-        if ((phys_addr & 0xfff) == 0) {
+        if ((phys_addr >> 12) != inst_page) {
             inst_base->br = TransExtData::END_OF_PAGE;
         }
         ret = inst_base->br;
     };
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    cpu->instruction_cache.Insert(pc_start, bb_start);
 
     return KEEP_GOING;
 }
@@ -887,7 +890,7 @@ static int InterpreterTranslateSingle(ARMul_State* cpu, int& bb_start, u32 addr)
         inst_base->br = TransExtData::SINGLE_STEP;
     }
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    cpu->instruction_cache.Insert(pc_start, bb_start);
 
     return KEEP_GOING;
 }
@@ -1622,6 +1625,7 @@ unsigned InterpreterMainLoop(ARMul_State* cpu) {
     unsigned int num_instrs = 0;
 
     int ptr;
+    TranslatedBlockTable::Entry* prev_block = nullptr;
 
     LOAD_NZCVT;
 DISPATCH : {
@@ -1636,17 +1640,40 @@ DISPATCH : {
     else
         cpu->Reg[15] &= 0xfffffffc;
 
-    // Find the cached instruction cream, otherwise translate it...
-    auto itr = cpu->instruction_cache.find(cpu->Reg[15]);
-    if (itr != cpu->instruction_cache.end()) {
-        ptr = itr->second;
-    } else if (cpu->NumInstrsToExecute != 1) {
-        if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-            goto END;
+    // Follow the direct link from the previous block if it leads here, otherwise find the
+    // cached instruction cream, otherwise translate it...
+    TranslatedBlockTable::Entry* block;
+    if (prev_block != nullptr && prev_block->link != nullptr &&
+        prev_block->link_pc == cpu->Reg[15] && prev_block->link->ptr >= 0) {
+        block = prev_block->link;
     } else {
-        if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-            goto END;
+        block = cpu->instruction_cache.Find(cpu->Reg[15]);
+        if (block == nullptr) {
+            // Start over with an empty cache rather than running out of space within a block
+            if (trans_cache_buf_top + TRANS_CACHE_BLOCK_RESERVE > TRANS_CACHE_SIZE) {
+                LOG_DEBUG(Core_ARM11, "Translation cache is full, flushing it");
+                cpu->instruction_cache.Clear();
+                trans_cache_buf_top = 0;
+                prev_block = nullptr;
+            }
+
+            if (cpu->NumInstrsToExecute != 1) {
+                if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+                    goto END;
+            } else {
+                if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+                    goto END;
+            }
+            block = cpu->instruction_cache.Find(cpu->Reg[15]);
+        }
+
+        if (prev_block != nullptr) {
+            prev_block->link_pc = cpu->Reg[15];
+            prev_block->link = block;
+        }
     }
+    ptr = block->ptr;
+    prev_block = block;
 
     // Find breakpoint if one exists within the block
     if (GDBStub::g_server_enabled && GDBStub::IsConnected()) {
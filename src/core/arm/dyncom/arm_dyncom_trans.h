@@ -488,5 +488,10 @@ extern const transop_fp_t arm_instruction_trans[];
 extern const size_t arm_instruction_trans_len;
 
 #define TRANS_CACHE_SIZE (64 * 1024 * 2000)
+// Space that must be free before translating a block. Blocks end with the instruction that reaches
+// the end of their page, so they contain at most 2048 (Thumb) instructions, each taking far less
+// than 512 bytes. Thumb BL/BLX pairs are translated as two 16-bit instructions, so a pair starting
+// at offset 0xffe is split between the blocks of both pages rather than extending the first one.
+#define TRANS_CACHE_BLOCK_RESERVE (2048 * 512)
 extern char trans_cache_buf[TRANS_CACHE_SIZE];
 extern size_t trans_cache_buf_top;
@@ -10,6 +10,24 @@
 #include "core/gdbstub/gdbstub.h"
 #include "core/memory.h"
 
+TranslatedBlockTable::Entry& TranslatedBlockTable::Insert(u32 addr, int ptr) {
+    std::unique_ptr<Page>& page = pages[addr >> PAGE_BITS];
+    if (page == nullptr) {
+        page = std::make_unique<Page>();
+        allocated_pages.push_back(addr >> PAGE_BITS);
+    }
+
+    Entry& entry = (*page)[(addr & PAGE_MASK) >> 1];
+    entry.ptr = ptr;
+    return entry;
+}
+
+void TranslatedBlockTable::Clear() {
+    for (u32 page : allocated_pages) {
+        pages[page]->fill(Entry{});
+    }
+}
+
 ARMul_State::ARMul_State(PrivilegeMode initial_mode) {
     Reset();
     ChangePrivilegeMode(initial_mode);
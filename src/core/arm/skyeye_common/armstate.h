@@ -18,7 +18,8 @@
 #pragma once
 
 #include <array>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 #include "common/common_types.h"
 #include "core/arm/skyeye_common/arm_regformat.h"
 
@@ -136,6 +137,51 @@ enum {
     RUN = 3         // Continuous execution
 };
 
+/**
+ * Maps guest addresses to basic blocks translated by the interpreter. Like the memory page table,
+ * a first-level array indexed by page points to second-level arrays indexed by the (halfword
+ * aligned) offset within the page, which are only allocated for pages containing code.
+ */
+class TranslatedBlockTable final {
+public:
+    struct Entry {
+        /// Offset of the translated block in trans_cache_buf, or -1 if there is none
+        int ptr = -1;
+        /// Address of the block that was last dispatched to after this one
+        u32 link_pc = 0;
+        /// Entry of that successor block, to skip the table lookup when it runs again
+        Entry* link = nullptr;
+    };
+
+    /// Returns the entry of the block translated at addr, or nullptr if there is none
+    Entry* Find(u32 addr) const {
+        Page* page = pages[addr >> PAGE_BITS].get();
+        if (page == nullptr)
+            return nullptr;
+        Entry& entry = (*page)[(addr & PAGE_MASK) >> 1];
+        return entry.ptr >= 0 ? &entry : nullptr;
+    }
+
+    /// Records a block translated at addr, returning its entry
+    Entry& Insert(u32 addr, int ptr);
+
+    /**
+     * Forgets all translated blocks. Pages stay allocated, so pointers to entries remain valid
+     * (they may be cleared while the interpreter is running, e.g. from a service call).
+     */
+    void Clear();
+
+private:
+    static const int PAGE_BITS = 12;
+    static const u32 PAGE_MASK = (1 << PAGE_BITS) - 1;
+    static const size_t NUM_PAGES = 1 << (32 - PAGE_BITS);
+
+    using Page = std::array<Entry, (1 << PAGE_BITS) / 2>;
+
+    std::array<std::unique_ptr<Page>, NUM_PAGES> pages;
+    std::vector<u32> allocated_pages;
+};
+
 struct ARMul_State final {
 public:
     explicit ARMul_State(PrivilegeMode initial_mode);
@@ -230,7 +276,7 @@ public:
 
     // TODO(bunnei): Move this cache to a better place - it should be per codeset (likely per
     // process for our purposes), not per ARMul_State (which tracks CPU core state).
-    std::unordered_map<u32, int> instruction_cache;
+    TranslatedBlockTable instruction_cache;
 
 private:
     void ResetMPCoreCP15Registers();
@@ -2,11 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
-#include <mutex>
+#include <functional>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
-#include "common/chunk_file.h"
 #include "common/logging/log.h"
 #include "common/string_util.h"
 #include "core/arm/arm_interface.h"
@@ -31,24 +34,50 @@ struct EventType {
 
 static std::vector<EventType> event_types;
 
-struct BaseEvent {
+struct Event {
     s64 time;
+    u64 fifo_order;
     u64 userdata;
     int type;
+    /// Position of this event in event_queue, kept up to date as the heap is reordered
+    size_t heap_index;
 };
 
-typedef LinkedListItem<BaseEvent> Event;
+struct EventKey {
+    int type;
+    u64 userdata;
+
+    bool operator==(const EventKey& other) const {
+        return type == other.type && userdata == other.userdata;
+    }
+};
 
-static Event* first;
-static Event* ts_first;
-static Event* ts_last;
+struct EventKeyHash {
+    size_t operator()(const EventKey& key) const {
+        return std::hash<u64>()(key.userdata ^ (static_cast<u64>(key.type) << 48));
+    }
+};
+
+// Scheduled events live in slots with stable indices. event_queue is a binary min-heap of slot
+// indices ordered by (time, fifo_order), so events due at the same time fire in the order they
+// were scheduled. event_index maps (type, userdata) to slots for O(log n) unscheduling.
+static std::vector<Event> event_slots;
+static std::vector<u32> free_event_slots;
+static std::vector<u32> event_queue;
+static std::unordered_multimap<EventKey, u32, EventKeyHash> event_index;
+static u64 event_fifo_id;
+
+/// Event scheduled from another thread, waiting to be moved into the main queue
+struct ThreadsafeEvent {
+    s64 time;
+    u64 userdata;
+    int type;
+    ThreadsafeEvent* next;
+};
 
-// event pools
-static Event* event_pool = nullptr;
-static Event* event_ts_pool = nullptr;
-static int allocated_ts_events = 0;
-// Optimization to skip MoveEvents when possible.
-static std::atomic<bool> has_ts_events(false);
+// Lock-free inbox for events scheduled from other threads. Producers push onto the head; the CPU
+// thread takes the whole list at once, so nodes are never popped concurrently.
+static std::atomic<ThreadsafeEvent*> ts_inbox(nullptr);
 
 int g_slice_length;
 
@@ -57,8 +86,6 @@ static s64 idled_cycles;
 static s64 last_global_time_ticks;
 static s64 last_global_time_us;
 
-static std::recursive_mutex external_event_section;
-
 // Warning: not included in save state.
 using AdvanceCallback = void(int cycles_executed);
 static AdvanceCallback* advance_callback = nullptr;
@@ -92,35 +119,93 @@ u64 GetGlobalTimeUs() {
     return last_global_time_us + us_since_last;
 }
 
-static Event* GetNewEvent() {
-    if (!event_pool)
-        return new Event;
+static bool EventBefore(u32 slot_a, u32 slot_b) {
+    const Event& a = event_slots[slot_a];
+    const Event& b = event_slots[slot_b];
+    return std::tie(a.time, a.fifo_order) < std::tie(b.time, b.fifo_order);
+}
 
-    Event* event = event_pool;
-    event_pool = event->next;
-    return event;
+static void SetHeapEntry(size_t index, u32 slot) {
+    event_queue[index] = slot;
+    event_slots[slot].heap_index = index;
 }
 
-static Event* GetNewTsEvent() {
-    allocated_ts_events++;
+static void SiftUp(size_t index) {
+    const u32 slot = event_queue[index];
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (!EventBefore(slot, event_queue[parent]))
+            break;
+        SetHeapEntry(index, event_queue[parent]);
+        index = parent;
+    }
+    SetHeapEntry(index, slot);
+}
 
-    if (!event_ts_pool)
-        return new Event;
+static void SiftDown(size_t index) {
+    const u32 slot = event_queue[index];
+    const size_t size = event_queue.size();
+    for (;;) {
+        size_t child = 2 * index + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && EventBefore(event_queue[child + 1], event_queue[child]))
+            ++child;
+        if (!EventBefore(event_queue[child], slot))
+            break;
+        SetHeapEntry(index, event_queue[child]);
+        index = child;
+    }
+    SetHeapEntry(index, slot);
+}
 
-    Event* event = event_ts_pool;
-    event_ts_pool = event->next;
-    return event;
+static void AddEventToQueue(s64 time, int event_type, u64 userdata) {
+    u32 slot;
+    if (free_event_slots.empty()) {
+        slot = static_cast<u32>(event_slots.size());
+        event_slots.emplace_back();
+    } else {
+        slot = free_event_slots.back();
+        free_event_slots.pop_back();
+    }
+
+    Event& event = event_slots[slot];
+    event.time = time;
+    event.fifo_order = event_fifo_id++;
+    event.userdata = userdata;
+    event.type = event_type;
+
+    event_queue.push_back(slot);
+    SiftUp(event_queue.size() - 1);
+    event_index.emplace(EventKey{event_type, userdata}, slot);
 }
 
-static void FreeEvent(Event* event) {
-    event->next = event_pool;
-    event_pool = event;
+static void RemoveEventFromQueue(u32 slot) {
+    const Event& event = event_slots[slot];
+
+    auto range = event_index.equal_range(EventKey{event.type, event.userdata});
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == slot) {
+            event_index.erase(it);
+            break;
+        }
+    }
+
+    const size_t index = event.heap_index;
+    const u32 last = event_queue.back();
+    event_queue.pop_back();
+    if (index < event_queue.size()) {
+        SetHeapEntry(index, last);
+        SiftUp(index);
+        SiftDown(event_slots[last].heap_index);
+    }
+
+    free_event_slots.push_back(slot);
 }
 
-static void FreeTsEvent(Event* event) {
-    event->next = event_ts_pool;
-    event_ts_pool = event;
-    allocated_ts_events--;
+/// Returns the event that is due first. The queue must not be empty.
+static const Event& GetFirstEvent() {
+    return event_slots[event_queue.front()];
 }
 
 int RegisterEvent(const char* name, TimedCallback callback) {
@@ -141,7 +226,7 @@ void RestoreRegisterEvent(int event_type, const char* name, TimedCallback callba
 }
 
 void UnregisterAllEvents() {
-    if (first)
+    if (!event_queue.empty())
         LOG_ERROR(Core_Timing, "Cannot unregister events with events pending");
     event_types.clear();
 }
@@ -153,16 +238,13 @@ void Init() {
     idled_cycles = 0;
     last_global_time_ticks = 0;
     last_global_time_us = 0;
-    has_ts_events = 0;
     mhz_change_callbacks.clear();
 
-    first = nullptr;
-    ts_first = nullptr;
-    ts_last = nullptr;
-
-    event_pool = nullptr;
-    event_ts_pool = nullptr;
-    allocated_ts_events = 0;
+    event_slots.clear();
+    free_event_slots.clear();
+    event_queue.clear();
+    event_index.clear();
+    event_fifo_id = 0;
 
     advance_callback = nullptr;
 }
@@ -171,19 +253,6 @@ void Shutdown() {
     MoveEvents();
     ClearPendingEvents();
     UnregisterAllEvents();
-
-    while (event_pool) {
-        Event* event = event_pool;
-        event_pool = event->next;
-        delete event;
-    }
-
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    while (event_ts_pool) {
-        Event* event = event_ts_pool;
-        event_ts_pool = event->next;
-        delete event;
-    }
 }
 
 u64 GetTicks() {
@@ -197,19 +266,14 @@ u64 GetIdleTicks() {
 // This is to be called when outside threads, such as the graphics thread, wants to
 // schedule things to be executed on the main thread.
 void ScheduleEvent_Threadsafe(s64 cycles_into_future, int event_type, u64 userdata) {
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    Event* new_event = GetNewTsEvent();
+    ThreadsafeEvent* new_event = new ThreadsafeEvent;
     new_event->time = GetTicks() + cycles_into_future;
     new_event->type = event_type;
-    new_event->next = nullptr;
     new_event->userdata = userdata;
-    if (!ts_first)
-        ts_first = new_event;
-    if (ts_last)
-        ts_last->next = new_event;
-    ts_last = new_event;
-
-    has_ts_events = true;
+    new_event->next = ts_inbox.load(std::memory_order_relaxed);
+    while (!ts_inbox.compare_exchange_weak(new_event->next, new_event, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
 }
 
 // Same as ScheduleEvent_Threadsafe(0, ...) EXCEPT if we are already on the CPU thread
@@ -217,121 +281,45 @@ void ScheduleEvent_Threadsafe(s64 cycles_into_future, int event_type, u64 userda
 void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata) {
     if (false) // Core::IsCPUThread())
     {
-        std::lock_guard<std::recursive_mutex> lock(external_event_section);
         event_types[event_type].callback(userdata, 0);
     } else
         ScheduleEvent_Threadsafe(0, event_type, userdata);
 }
 
 void ClearPendingEvents() {
-    while (first) {
-        Event* event = first->next;
-        FreeEvent(first);
-        first = event;
-    }
-}
-
-static void AddEventToQueue(Event* new_event) {
-    Event* prev_event = nullptr;
-    Event** next_event = &first;
-    for (;;) {
-        Event*& next = *next_event;
-        if (!next || new_event->time < next->time) {
-            new_event->next = next;
-            next = new_event;
-            break;
-        }
-        prev_event = next;
-        next_event = &prev_event->next;
-    }
+    event_slots.clear();
+    free_event_slots.clear();
+    event_queue.clear();
+    event_index.clear();
 }
 
 void ScheduleEvent(s64 cycles_into_future, int event_type, u64 userdata) {
-    Event* new_event = GetNewEvent();
-    new_event->userdata = userdata;
-    new_event->type = event_type;
-    new_event->time = GetTicks() + cycles_into_future;
-    AddEventToQueue(new_event);
+    AddEventToQueue(GetTicks() + cycles_into_future, event_type, userdata);
 }
 
 s64 UnscheduleEvent(int event_type, u64 userdata) {
-    s64 result = 0;
-    if (!first)
-        return result;
-    while (first) {
-        if (first->type == event_type && first->userdata == userdata) {
-            result = first->time - GetTicks();
-
-            Event* next = first->next;
-            FreeEvent(first);
-            first = next;
-        } else {
-            break;
-        }
+    auto range = event_index.equal_range(EventKey{event_type, userdata});
+    if (range.first == range.second)
+        return 0;
+
+    std::vector<u32> slots;
+    s64 latest_time = std::numeric_limits<s64>::min();
+    for (auto it = range.first; it != range.second; ++it) {
+        slots.push_back(it->second);
+        latest_time = std::max(latest_time, event_slots[it->second].time);
     }
-    if (!first)
-        return result;
-
-    Event* prev_event = first;
-    Event* ptr = prev_event->next;
-
-    while (ptr) {
-        if (ptr->type == event_type && ptr->userdata == userdata) {
-            result = ptr->time - GetTicks();
-
-            prev_event->next = ptr->next;
-            FreeEvent(ptr);
-            ptr = prev_event->next;
-        } else {
-            prev_event = ptr;
-            ptr = ptr->next;
-        }
+    for (u32 slot : slots) {
+        RemoveEventFromQueue(slot);
     }
 
-    return result;
+    return latest_time - GetTicks();
 }
 
+// Must be called from the CPU thread. Pending threadsafe events are moved into the main queue
+// first, so this also unschedules matching events that were scheduled from the CPU thread.
 s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata) {
-    s64 result = 0;
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    if (!ts_first)
-        return result;
-
-    while (ts_first) {
-        if (ts_first->type == event_type && ts_first->userdata == userdata) {
-            result = ts_first->time - GetTicks();
-
-            Event* next = ts_first->next;
-            FreeTsEvent(ts_first);
-            ts_first = next;
-        } else {
-            break;
-        }
-    }
-
-    if (!ts_first) {
-        ts_last = nullptr;
-        return result;
-    }
-
-    Event* prev_event = ts_first;
-    Event* next = prev_event->next;
-    while (next) {
-        if (next->type == event_type && next->userdata == userdata) {
-            result = next->time - GetTicks();
-
-            prev_event->next = next->next;
-            if (next == ts_last)
-                ts_last = prev_event;
-            FreeTsEvent(next);
-            next = prev_event->next;
-        } else {
-            prev_event = next;
-            next = next->next;
-        }
-    }
-
-    return result;
+    MoveEvents();
+    return UnscheduleEvent(event_type, userdata);
 }
 
 // Warning: not included in save state.
@@ -344,119 +332,57 @@ void RegisterMHzChangeCallback(MHzChangeCallback callback) {
 }
 
 bool IsScheduled(int event_type) {
-    if (!first)
-        return false;
-    Event* event = first;
-    while (event) {
-        if (event->type == event_type)
-            return true;
-        event = event->next;
-    }
-    return false;
+    return std::any_of(event_queue.begin(), event_queue.end(),
+                       [event_type](u32 slot) { return event_slots[slot].type == event_type; });
 }
 
 void RemoveEvent(int event_type) {
-    if (!first)
-        return;
-    while (first) {
-        if (first->type == event_type) {
-            Event* next = first->next;
-            FreeEvent(first);
-            first = next;
-        } else {
-            break;
-        }
+    std::vector<u32> slots;
+    for (u32 slot : event_queue) {
+        if (event_slots[slot].type == event_type)
+            slots.push_back(slot);
     }
-    if (!first)
-        return;
-    Event* prev = first;
-    Event* next = prev->next;
-    while (next) {
-        if (next->type == event_type) {
-            prev->next = next->next;
-            FreeEvent(next);
-            next = prev->next;
-        } else {
-            prev = next;
-            next = next->next;
-        }
+    for (u32 slot : slots) {
+        RemoveEventFromQueue(slot);
     }
 }
 
+// Must be called from the CPU thread, see UnscheduleThreadsafeEvent.
 void RemoveThreadsafeEvent(int event_type) {
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    if (!ts_first)
-        return;
-
-    while (ts_first) {
-        if (ts_first->type == event_type) {
-            Event* next = ts_first->next;
-            FreeTsEvent(ts_first);
-            ts_first = next;
-        } else {
-            break;
-        }
-    }
-
-    if (!ts_first) {
-        ts_last = nullptr;
-        return;
-    }
-
-    Event* prev = ts_first;
-    Event* next = prev->next;
-    while (next) {
-        if (next->type == event_type) {
-            prev->next = next->next;
-            if (next == ts_last)
-                ts_last = prev;
-            FreeTsEvent(next);
-            next = prev->next;
-        } else {
-            prev = next;
-            next = next->next;
-        }
-    }
+    MoveEvents();
+    RemoveEvent(event_type);
 }
 
 void RemoveAllEvents(int event_type) {
     RemoveThreadsafeEvent(event_type);
-    RemoveEvent(event_type);
 }
 
 // This raise only the events required while the fifo is processing data
 void ProcessFifoWaitEvents() {
-    while (first) {
-        if (first->time <= (s64)GetTicks()) {
-            Event* evt = first;
-            first = first->next;
-            event_types[evt->type].callback(evt->userdata, (int)(GetTicks() - evt->time));
-            FreeEvent(evt);
-        } else {
-            break;
-        }
+    while (!event_queue.empty() && GetFirstEvent().time <= (s64)GetTicks()) {
+        const Event evt = GetFirstEvent();
+        RemoveEventFromQueue(event_queue.front());
+        event_types[evt.type].callback(evt.userdata, (int)(GetTicks() - evt.time));
     }
 }
 
 void MoveEvents() {
-    has_ts_events = false;
-
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    // Move events from async queue into main queue
-    while (ts_first) {
-        Event* next = ts_first->next;
-        AddEventToQueue(ts_first);
-        ts_first = next;
+    // Take all pending events at once. They were pushed onto the front of the list, so reverse
+    // it to add them to the main queue in the order they were scheduled.
+    ThreadsafeEvent* event = ts_inbox.exchange(nullptr, std::memory_order_acquire);
+    ThreadsafeEvent* reversed = nullptr;
+    while (event) {
+        ThreadsafeEvent* next = event->next;
+        event->next = reversed;
+        reversed = event;
+        event = next;
     }
-    ts_last = nullptr;
-
-    // Move free events to threadsafe pool
-    while (allocated_ts_events > 0 && event_pool) {
-        Event* event = event_pool;
-        event_pool = event->next;
-        event->next = event_ts_pool;
-        event_ts_pool = event;
-        allocated_ts_events--;
+
+    while (reversed) {
+        ThreadsafeEvent* next = reversed->next;
+        AddEventToQueue(reversed->time, reversed->type, reversed->userdata);
+        delete reversed;
+        reversed = next;
     }
 }
 
@@ -474,18 +400,18 @@ void Advance() {
     global_timer += cycles_executed;
     Core::g_app_core->down_count = g_slice_length;
 
-    if (has_ts_events)
+    if (ts_inbox.load(std::memory_order_relaxed) != nullptr)
         MoveEvents();
     ProcessFifoWaitEvents();
 
-    if (!first) {
+    if (event_queue.empty()) {
         if (g_slice_length < 10000) {
             g_slice_length += 10000;
             Core::g_app_core->down_count += g_slice_length;
         }
     } else {
         // Note that events can eat cycles as well.
-        int target = (int)(first->time - global_timer);
+        int target = (int)(GetFirstEvent().time - global_timer);
         if (target > MAX_SLICE_LENGTH)
             target = MAX_SLICE_LENGTH;
 
@@ -498,11 +424,10 @@ void Advance() {
 }
 
 void LogPendingEvents() {
-    Event* event = first;
-    while (event) {
-        // LOG_TRACE(Core_Timing, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer,
-        // next->time, next->type);
-        event = event->next;
+    for (size_t i = 0; i < event_queue.size(); ++i) {
+        LOG_TRACE(Core_Timing, "PENDING: Now: %" PRId64 " Pending: %" PRId64 " Type: %d",
+                  global_timer, event_slots[event_queue[i]].time,
+                  event_slots[event_queue[i]].type);
     }
 }
 
@@ -511,9 +436,9 @@ void Idle(int max_idle) {
     if (max_idle != 0 && cycles_down > max_idle)
         cycles_down = max_idle;
 
-    if (first && cycles_down > 0) {
+    if (!event_queue.empty() && cycles_down > 0) {
         s64 cycles_executed = g_slice_length - Core::g_app_core->down_count;
-        s64 cycles_next_event = first->time - global_timer;
+        s64 cycles_next_event = GetFirstEvent().time - global_timer;
 
         if (cycles_next_event < cycles_executed + cycles_down) {
             cycles_down = cycles_next_event - cycles_executed;
@@ -533,19 +458,21 @@ void Idle(int max_idle) {
 }
 
 std::string GetScheduledEventsSummary() {
-    Event* event = first;
+    std::vector<u32> slots = event_queue;
+    std::sort(slots.begin(), slots.end(), EventBefore);
+
     std::string text = "Scheduled events\n";
     text.reserve(1000);
-    while (event) {
-        unsigned int t = event->type;
+    for (u32 slot : slots) {
+        const Event& event = event_slots[slot];
+        unsigned int t = event.type;
         if (t >= event_types.size())
             LOG_ERROR(Core_Timing, "Invalid event type"); // %i", t);
-        const char* name = event_types[event->type].name;
+        const char* name = event_types[event.type].name;
         if (!name)
             name = "[unknown]";
-        text += Common::StringFromFormat("%s : %i %08x%08x\n", name, (int)event->time,
-                                         (u32)(event->userdata >> 32), (u32)(event->userdata));
-        event = event->next;
+        text += Common::StringFromFormat("%s : %i %08x%08x\n", name, (int)event.time,
+                                         (u32)(event.userdata >> 32), (u32)(event.userdata));
     }
     return text;
 }
@@ -2,6 +2,7 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include "common/common_types.h"
@@ -85,21 +86,54 @@ u64 IVFCArchive::GetFreeBytes() const {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-u8 IVFCFile::ReadEncryptedByte(u64 offset) const {
-    u64 index = offset / 16;
-    u8 buf_offset = offset % 16;
+const std::array<u8, 16>& IVFCFile::ReadEncryptedBlock(u64 index) const {
     if (!decrypt_buffered || index != buf_index) {
         decrypt_buffered = true;
         buf_index = index;
         std::array<u8, 16> ctr = aes_context.ctr;
-        AES::AddCtr(ctr, index);
-        std::array<u8, 16> xorpad = AES::AesCipher(ctr, aes_context.key);
+        AES::AddCtr(ctr, static_cast<u32>(index));
         romfs_file->Seek(data_offset + index * 16, SEEK_SET);
         romfs_file->ReadBytes(decrypt_buf.data(), 16);
-        for (int i = 0; i < 16; ++i)
-            decrypt_buf[i] ^= xorpad[i];
+        AES::AesCtrDecrypt(decrypt_buf.data(), 16, aes_context.key, ctr);
     }
-    return decrypt_buf[buf_offset];
+    return decrypt_buf;
+}
+
+size_t IVFCFile::ReadEncrypted(u64 offset, size_t length, u8* buffer) const {
+    size_t done = 0;
+
+    // Leading partial block
+    if (offset % 16 != 0) {
+        const auto& block = ReadEncryptedBlock(offset / 16);
+        size_t block_offset = static_cast<size_t>(offset % 16);
+        size_t count = std::min(length, 16 - block_offset);
+        std::memcpy(buffer, block.data() + block_offset, count);
+        done += count;
+    }
+
+    // Whole blocks are read straight into the destination with a single I/O call and decrypted
+    // in place
+    size_t aligned_length = (length - done) & ~static_cast<size_t>(15);
+    if (aligned_length != 0) {
+        u64 index = (offset + done) / 16;
+        std::array<u8, 16> ctr = aes_context.ctr;
+        AES::AddCtr(ctr, static_cast<u32>(index));
+        romfs_file->Seek(data_offset + index * 16, SEEK_SET);
+        size_t read = romfs_file->ReadBytes(buffer + done, aligned_length);
+        AES::AesCtrDecrypt(buffer + done, read, aes_context.key, ctr);
+        done += read;
+        if (read != aligned_length)
+            return done;
+    }
+
+    // Trailing partial block
+    if (done < length) {
+        const auto& block = ReadEncryptedBlock((offset + done) / 16);
+        std::memcpy(buffer + done, block.data(), length - done);
+        done = length;
+    }
+
+    return done;
 }
 
 ResultVal<size_t> IVFCFile::Read(const u64 offset, const size_t length, u8* buffer) const {
@@ -108,10 +142,7 @@ ResultVal<size_t> IVFCFile::Read(const u64 offset, const size_t length, u8* buff
         return MakeResult<size_t>(0);
     size_t read_length = (size_t)std::min((u64)length, data_size - offset);
     if (aes_context.encrypted) {
-        for (size_t i = 0; i < read_length; ++i) {
-            buffer[i] = ReadEncryptedByte(offset + i);
-        }
-        return MakeResult<size_t>(read_length);
+        return MakeResult<size_t>(ReadEncrypted(offset, read_length, buffer));
     } else {
         romfs_file->Seek(data_offset + offset, SEEK_SET);
         return MakeResult<size_t>(romfs_file->ReadBytes(buffer, read_length));
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <memory>
 #include <string>
@@ -69,7 +70,11 @@ public:
     void Flush() const override {}
 
 private:
-    u8 ReadEncryptedByte(u64 offset) const;
+    /// Reads and decrypts the 16-byte block at the given block index, caching the last block
+    const std::array<u8, 16>& ReadEncryptedBlock(u64 index) const;
+    /// Reads and decrypts an arbitrary byte range, returning the number of bytes read
+    size_t ReadEncrypted(u64 offset, size_t length, u8* buffer) const;
+
     std::shared_ptr<FileUtil::IOFile> romfs_file;
     u64 data_offset;
     u64 data_size;
@@ -309,7 +309,8 @@ static void SetBufferSwap(Service::Interface* self) {
 /**
  * GSP_GPU::FlushDataCache service function
  *
- * This Function is a no-op, We aren't emulating the CPU cache any time soon.
+ * The CPU cache isn't emulated, but flushing it tells the rasterizer that the CPU has written to
+ * the region, so that textures decoded from it are dropped.
  *
  *  Inputs:
  *      1 : Address
@@ -325,12 +326,14 @@ static void FlushDataCache(Service::Interface* self) {
     u32 size = cmd_buff[2];
     u32 process = cmd_buff[4];
 
+    Memory::RasterizerFlushAndInvalidateRegion(Memory::VirtualToPhysicalAddress(address), size);
+
     // TODO(purpasmart96): Verify return header on HW
 
     cmd_buff[1] = RESULT_SUCCESS.raw; // No error
 
-    LOG_DEBUG(Service_GSP, "(STUBBED) called address=0x%08X, size=0x%08X, process=0x%08X", address,
-              size, process);
+    LOG_DEBUG(Service_GSP, "called address=0x%08X, size=0x%08X, process=0x%08X", address, size,
+              process);
 }
 
 /**
@@ -409,6 +412,12 @@ static void UnregisterInterruptRelayQueue(Service::Interface* self) {
  * @todo This probably does not belong in the GSP module, instead move to video_core
  */
 void SignalInterrupt(InterruptId interrupt_id) {
+    // The shared memory and kernel objects below belong to the emulated CPU's thread
+    if (GPU::IsGPUThread()) {
+        GPU::RelayInterrupt(interrupt_id);
+        return;
+    }
+
     if (!gpu_right_acquired) {
         return;
     }
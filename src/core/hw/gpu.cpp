@@ -2,13 +2,21 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
+#include <memory>
 #include <numeric>
+#include <thread>
 #include <type_traits>
 #include "common/color.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/spsc_queue.h"
+#include "common/thread.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/core_timing.h"
 #include "core/hle/service/gsp_gpu.h"
@@ -20,6 +28,7 @@
 #include "core/tracer/recorder.h"
 #include "video_core/command_processor.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/morton.h"
 #include "video_core/rasterizer_interface.h"
 #include "video_core/renderer_base.h"
 #include "video_core/utils.h"
@@ -39,6 +48,46 @@ static int vblank_event;
 static u64 frame_count;
 /// True if the last frame was skipped
 static bool last_skip_frame;
+/// Event id for CoreTiming, used to relay interrupts raised on the GPU thread
+static int interrupt_event;
+
+/// Work handed to the GPU thread, executed in submission order
+struct GPUCommand {
+    enum class Type { CommandList, MemoryFill, DisplayTransfer };
+
+    Type type;
+    const u32* command_list;
+    u32 command_list_size;
+    bool is_second_filler;
+    /// Copy of the registers of the memory fill or display transfer, taken when it was triggered
+    std::array<u32, std::max(sizeof(Regs::MemoryFillConfig), sizeof(Regs::DisplayTransferConfig)) /
+                        sizeof(u32)>
+        config;
+
+    template <typename Config>
+    void SetConfig(const Config& regs) {
+        static_assert(sizeof(Config) <= sizeof(config), "Config doesn't fit");
+        std::memcpy(config.data(), &regs, sizeof(Config));
+    }
+
+    template <typename Config>
+    const Config& GetConfig() const {
+        return *reinterpret_cast<const Config*>(config.data());
+    }
+};
+
+static std::thread gpu_thread;
+static std::thread::id gpu_thread_id;
+static std::atomic<bool> gpu_thread_running;
+static Common::SPSCQueue<GPUCommand> gpu_queue;
+/// Number of commands pushed to the queue, only written by the emulated CPU's thread
+static std::atomic<u64> commands_submitted;
+/// Number of commands executed, only written by the GPU thread
+static std::atomic<u64> commands_completed;
+/// Wakes up the GPU thread when there is new work
+static Common::Event work_available;
+/// Wakes up threads waiting for the GPU thread to finish its work
+static Common::Event work_completed;
 
 template <typename T>
 inline void Read(T& var, const u32 raw_addr) {
@@ -51,32 +100,213 @@ inline void Read(T& var, const u32 raw_addr) {
         return;
     }
 
+    WaitForIdle();
     var = g_regs[addr / 4];
 }
 
-static Math::Vec4<u8> DecodePixel(Regs::PixelFormat input_format, const u8* src_pixel) {
-    switch (input_format) {
-    case Regs::PixelFormat::RGBA8:
-        return Color::DecodeRGBA8(src_pixel);
+/// Compile-time description of a framebuffer format, used by the DisplayTransfer converters
+template <Regs::PixelFormat format>
+struct PixelFormatTraits;
 
-    case Regs::PixelFormat::RGB8:
-        return Color::DecodeRGB8(src_pixel);
+template <>
+struct PixelFormatTraits<Regs::PixelFormat::RGBA8> {
+    static constexpr u32 bytes_per_pixel = 4;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGBA8(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGBA8(color, bytes);
+    }
+};
 
-    case Regs::PixelFormat::RGB565:
-        return Color::DecodeRGB565(src_pixel);
+template <>
+struct PixelFormatTraits<Regs::PixelFormat::RGB8> {
+    static constexpr u32 bytes_per_pixel = 3;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGB8(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGB8(color, bytes);
+    }
+};
 
-    case Regs::PixelFormat::RGB5A1:
-        return Color::DecodeRGB5A1(src_pixel);
+template <>
+struct PixelFormatTraits<Regs::PixelFormat::RGB565> {
+    static constexpr u32 bytes_per_pixel = 2;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGB565(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGB565(color, bytes);
+    }
+};
+
+template <>
+struct PixelFormatTraits<Regs::PixelFormat::RGB5A1> {
+    static constexpr u32 bytes_per_pixel = 2;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGB5A1(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGB5A1(color, bytes);
+    }
+};
+
+template <>
+struct PixelFormatTraits<Regs::PixelFormat::RGBA4> {
+    static constexpr u32 bytes_per_pixel = 2;
+    static Math::Vec4<u8> Decode(const u8* bytes) {
+        return Color::DecodeRGBA4(bytes);
+    }
+    static void Encode(const Math::Vec4<u8>& color, u8* bytes) {
+        Color::EncodeRGBA4(color, bytes);
+    }
+};
+
+// Pixel offsets contributed by the x and y coordinates inside an 8x8 tile, see MortonInterleave
+static constexpr u32 morton_x_offsets[8] = {0, 1, 4, 5, 16, 17, 20, 21};
+static constexpr u32 morton_y_offsets[8] = {0, 2, 8, 10, 32, 34, 40, 42};
+
+/// Offset in pixels of the start of row y in a tiled image of the given width
+static inline u32 TiledRowOffset(u32 y, u32 width) {
+    return (y & ~7) * width + morton_y_offsets[y & 7];
+}
+
+/// Offset in pixels of column x relative to the start of its row in a tiled image
+static inline u32 TiledColumnOffset(u32 x) {
+    return (x & ~7) * 8 + morton_x_offsets[x & 7];
+}
+
+struct TransferParams {
+    const u8* src;
+    u8* dst;
+    u32 input_width;
+    u32 output_width; ///< Width after scaling
+    u32 output_height;
+    bool flip_vertically;
+};
+
+using TransferRowsFunc = void (*)(const TransferParams& params, u32 first_row, u32 end_row);
+
+/// Converts output rows [first_row, end_row) of a display transfer
+template <Regs::PixelFormat input_format, Regs::PixelFormat output_format, bool input_tiled,
+          bool output_tiled, Regs::DisplayTransferConfig::ScalingMode scaling>
+static void TransferRows(const TransferParams& params, u32 first_row, u32 end_row) {
+    using Config = Regs::DisplayTransferConfig;
+    using In = PixelFormatTraits<input_format>;
+    using Out = PixelFormatTraits<output_format>;
+
+    constexpr u32 horizontal_scale = scaling != Config::NoScale ? 1 : 0;
+    constexpr u32 vertical_scale = scaling == Config::ScaleXY ? 1 : 0;
+
+    for (u32 y = first_row; y < end_row; ++y) {
+        const u32 input_y = y << vertical_scale;
+        // Flip the y value of the output data after calculating the position of the input, to
+        // account for the scaling options
+        const u32 output_y = params.flip_vertically ? params.output_height - y - 1 : y;
+
+        const u8* src_row =
+            params.src + (input_tiled ? TiledRowOffset(input_y, params.input_width)
+                                      : input_y * params.input_width) *
+                             In::bytes_per_pixel;
+        u8* dst_row = params.dst + (output_tiled ? TiledRowOffset(output_y, params.output_width)
+                                                 : output_y * params.output_width) *
+                                       Out::bytes_per_pixel;
+
+        for (u32 x = 0; x < params.output_width; ++x) {
+            const u32 input_x = x << horizontal_scale;
+            const u8* src_pixel =
+                src_row + (input_tiled ? TiledColumnOffset(input_x) : input_x) * In::bytes_per_pixel;
+            u8* dst_pixel = dst_row + (output_tiled ? TiledColumnOffset(x) : x) * Out::bytes_per_pixel;
+
+            // Scaling only happens on tiled input, where the pixels to average are adjacent
+            Math::Vec4<u8> color = In::Decode(src_pixel);
+            if (scaling == Config::ScaleX) {
+                const Math::Vec4<u8> pixel = In::Decode(src_pixel + In::bytes_per_pixel);
+                color = ((color + pixel) / 2).template Cast<u8>();
+            } else if (scaling == Config::ScaleXY) {
+                const Math::Vec4<u8> pixel1 = In::Decode(src_pixel + 1 * In::bytes_per_pixel);
+                const Math::Vec4<u8> pixel2 = In::Decode(src_pixel + 2 * In::bytes_per_pixel);
+                const Math::Vec4<u8> pixel3 = In::Decode(src_pixel + 3 * In::bytes_per_pixel);
+                color = (((color + pixel1) + (pixel2 + pixel3)) / 4).template Cast<u8>();
+            }
+            Out::Encode(color, dst_pixel);
+        }
+    }
+}
+
+template <Regs::PixelFormat input_format, Regs::PixelFormat output_format>
+static TransferRowsFunc GetTransferRowsFunc(const Regs::DisplayTransferConfig& config) {
+    using Config = Regs::DisplayTransferConfig;
 
+    // dont_swizzle keeps the layout of the input, otherwise it's converted to the other one
+    if (config.input_linear) {
+        // Scaling is only implemented on tiled input, other modes were rejected by the caller
+        if (config.dont_swizzle)
+            return TransferRows<input_format, output_format, false, false, Config::NoScale>;
+        return TransferRows<input_format, output_format, false, true, Config::NoScale>;
+    }
+
+    switch (config.scaling.Value()) {
+    case Config::NoScale:
+        if (config.dont_swizzle)
+            return TransferRows<input_format, output_format, true, true, Config::NoScale>;
+        return TransferRows<input_format, output_format, true, false, Config::NoScale>;
+    case Config::ScaleX:
+        if (config.dont_swizzle)
+            return TransferRows<input_format, output_format, true, true, Config::ScaleX>;
+        return TransferRows<input_format, output_format, true, false, Config::ScaleX>;
+    case Config::ScaleXY:
+        if (config.dont_swizzle)
+            return TransferRows<input_format, output_format, true, true, Config::ScaleXY>;
+        return TransferRows<input_format, output_format, true, false, Config::ScaleXY>;
+    default:
+        return nullptr;
+    }
+}
+
+template <Regs::PixelFormat input_format>
+static TransferRowsFunc GetTransferRowsFunc(const Regs::DisplayTransferConfig& config) {
+    switch (config.output_format.Value()) {
+    case Regs::PixelFormat::RGBA8:
+        return GetTransferRowsFunc<input_format, Regs::PixelFormat::RGBA8>(config);
+    case Regs::PixelFormat::RGB8:
+        return GetTransferRowsFunc<input_format, Regs::PixelFormat::RGB8>(config);
+    case Regs::PixelFormat::RGB565:
+        return GetTransferRowsFunc<input_format, Regs::PixelFormat::RGB565>(config);
+    case Regs::PixelFormat::RGB5A1:
+        return GetTransferRowsFunc<input_format, Regs::PixelFormat::RGB5A1>(config);
     case Regs::PixelFormat::RGBA4:
-        return Color::DecodeRGBA4(src_pixel);
+        return GetTransferRowsFunc<input_format, Regs::PixelFormat::RGBA4>(config);
+    default:
+        LOG_ERROR(HW_GPU, "Unknown destination framebuffer format %x",
+                  static_cast<u32>(config.output_format.Value()));
+        return nullptr;
+    }
+}
 
+static TransferRowsFunc GetTransferRowsFunc(const Regs::DisplayTransferConfig& config) {
+    switch (config.input_format.Value()) {
+    case Regs::PixelFormat::RGBA8:
+        return GetTransferRowsFunc<Regs::PixelFormat::RGBA8>(config);
+    case Regs::PixelFormat::RGB8:
+        return GetTransferRowsFunc<Regs::PixelFormat::RGB8>(config);
+    case Regs::PixelFormat::RGB565:
+        return GetTransferRowsFunc<Regs::PixelFormat::RGB565>(config);
+    case Regs::PixelFormat::RGB5A1:
+        return GetTransferRowsFunc<Regs::PixelFormat::RGB5A1>(config);
+    case Regs::PixelFormat::RGBA4:
+        return GetTransferRowsFunc<Regs::PixelFormat::RGBA4>(config);
     default:
-        LOG_ERROR(HW_GPU, "Unknown source framebuffer format %x", input_format);
-        return {0, 0, 0, 0};
+        LOG_ERROR(HW_GPU, "Unknown source framebuffer format %x",
+                  static_cast<u32>(config.input_format.Value()));
+        return nullptr;
     }
 }
 
+/// Transfers with at least this many output pixels are split across the video core thread pool
+static constexpr u32 PARALLEL_TRANSFER_MIN_PIXELS = 128 * 128;
+
 MICROPROFILE_DEFINE(GPU_DisplayTransfer, "GPU", "DisplayTransfer", MP_RGB(100, 100, 255));
 MICROPROFILE_DEFINE(GPU_CmdlistProcessing, "GPU", "Cmdlist Processing", MP_RGB(100, 255, 100));
 
@@ -182,6 +412,11 @@ static void DisplayTransfer(const Regs::DisplayTransferConfig& config) {
     u8* src_pointer = Memory::GetPhysicalPointer(src_addr);
     u8* dst_pointer = Memory::GetPhysicalPointer(dst_addr);
 
+    if (src_pointer == nullptr || dst_pointer == nullptr) {
+        LOG_CRITICAL(HW_GPU, "Invalid address %08x -> %08x", src_addr, dst_addr);
+        return;
+    }
+
     if (config.scaling > config.ScaleXY) {
         LOG_CRITICAL(HW_GPU, "Unimplemented display transfer scaling mode %u",
                      config.scaling.Value());
@@ -208,118 +443,58 @@ static void DisplayTransfer(const Regs::DisplayTransferConfig& config) {
     Memory::RasterizerFlushRegion(config.GetPhysicalInputAddress(), input_size);
     Memory::RasterizerFlushAndInvalidateRegion(config.GetPhysicalOutputAddress(), output_size);
 
-    for (u32 y = 0; y < output_height; ++y) {
-        for (u32 x = 0; x < output_width; ++x) {
-            Math::Vec4<u8> src_color;
-
-            // Calculate the [x,y] position of the input image
-            // based on the current output position and the scale
-            u32 input_x = x << horizontal_scale;
-            u32 input_y = y << vertical_scale;
+    // Without scaling or format conversion this is a plain (de)swizzle, done a tile at a time
+    if (config.input_format == config.output_format && config.scaling == config.NoScale &&
+        !config.dont_swizzle && output_width % 8 == 0 && output_height % 8 == 0) {
+        const u32 bytes_per_pixel = GPU::Regs::BytesPerPixel(config.output_format);
+        const s32 input_stride = config.input_width * bytes_per_pixel;
+        const s32 output_stride = output_width * bytes_per_pixel;
 
-            u32 output_y;
+        if (config.input_linear) {
+            u8* linear = src_pointer;
+            s32 linear_stride = input_stride;
             if (config.flip_vertically) {
-                // Flip the y value of the output data,
-                // we do this after calculating the [x,y] position of the input image
-                // to account for the scaling options.
-                output_y = output_height - y - 1;
-            } else {
-                output_y = y;
-            }
-
-            u32 dst_bytes_per_pixel = GPU::Regs::BytesPerPixel(config.output_format);
-            u32 src_bytes_per_pixel = GPU::Regs::BytesPerPixel(config.input_format);
-            u32 src_offset;
-            u32 dst_offset;
-
-            if (config.input_linear) {
-                if (!config.dont_swizzle) {
-                    // Interpret the input as linear and the output as tiled
-                    u32 coarse_y = output_y & ~7;
-                    u32 stride = output_width * dst_bytes_per_pixel;
-
-                    src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
-                    dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
-                                 coarse_y * stride;
-                } else {
-                    // Both input and output are linear
-                    src_offset = (input_x + input_y * config.input_width) * src_bytes_per_pixel;
-                    dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
-                }
-            } else {
-                if (!config.dont_swizzle) {
-                    // Interpret the input as tiled and the output as linear
-                    u32 coarse_y = input_y & ~7;
-                    u32 stride = config.input_width * src_bytes_per_pixel;
-
-                    src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
-                                 coarse_y * stride;
-                    dst_offset = (x + output_y * output_width) * dst_bytes_per_pixel;
-                } else {
-                    // Both input and output are tiled
-                    u32 out_coarse_y = output_y & ~7;
-                    u32 out_stride = output_width * dst_bytes_per_pixel;
-
-                    u32 in_coarse_y = input_y & ~7;
-                    u32 in_stride = config.input_width * src_bytes_per_pixel;
-
-                    src_offset = VideoCore::GetMortonOffset(input_x, input_y, src_bytes_per_pixel) +
-                                 in_coarse_y * in_stride;
-                    dst_offset = VideoCore::GetMortonOffset(x, output_y, dst_bytes_per_pixel) +
-                                 out_coarse_y * out_stride;
-                }
+                linear += (output_height - 1) * input_stride;
+                linear_stride = -input_stride;
             }
-			
-                        if (!dst_pointer) {
-                            LOG_CRITICAL(HW_GPU, "Invalid address %08x", dst_pointer);
-                            break;
-                        }
-						
-            const u8* src_pixel = src_pointer + src_offset;
-            src_color = DecodePixel(config.input_format, src_pixel);
-            if (config.scaling == config.ScaleX) {
-                Math::Vec4<u8> pixel =
-                    DecodePixel(config.input_format, src_pixel + src_bytes_per_pixel);
-                src_color = ((src_color + pixel) / 2).Cast<u8>();
-            } else if (config.scaling == config.ScaleXY) {
-                Math::Vec4<u8> pixel1 =
-                    DecodePixel(config.input_format, src_pixel + 1 * src_bytes_per_pixel);
-                Math::Vec4<u8> pixel2 =
-                    DecodePixel(config.input_format, src_pixel + 2 * src_bytes_per_pixel);
-                Math::Vec4<u8> pixel3 =
-                    DecodePixel(config.input_format, src_pixel + 3 * src_bytes_per_pixel);
-                src_color = (((src_color + pixel1) + (pixel2 + pixel3)) / 4).Cast<u8>();
+            VideoCore::MortonCopySurface(false, bytes_per_pixel, output_width, output_height,
+                                         dst_pointer, output_stride, linear, linear_stride);
+        } else {
+            u8* linear = dst_pointer;
+            s32 linear_stride = output_stride;
+            if (config.flip_vertically) {
+                linear += (output_height - 1) * output_stride;
+                linear_stride = -output_stride;
             }
+            VideoCore::MortonCopySurface(true, bytes_per_pixel, output_width, output_height,
+                                         src_pointer, input_stride, linear, linear_stride);
+        }
+        return;
+    }
 
-            u8* dst_pixel = dst_pointer + dst_offset;
-            switch (config.output_format) {
-            case Regs::PixelFormat::RGBA8:
-                Color::EncodeRGBA8(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB8:
-                Color::EncodeRGB8(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB565:
-                Color::EncodeRGB565(src_color, dst_pixel);
-                break;
-
-            case Regs::PixelFormat::RGB5A1:
-                Color::EncodeRGB5A1(src_color, dst_pixel);
-                break;
+    const TransferRowsFunc transfer_rows = GetTransferRowsFunc(config);
+    if (transfer_rows == nullptr)
+        return;
 
-            case Regs::PixelFormat::RGBA4:
-                Color::EncodeRGBA4(src_color, dst_pixel);
-                break;
+    TransferParams params;
+    params.src = src_pointer;
+    params.dst = dst_pointer;
+    params.input_width = config.input_width;
+    params.output_width = output_width;
+    params.output_height = output_height;
+    params.flip_vertically = config.flip_vertically != 0;
 
-            default:
-                LOG_ERROR(HW_GPU, "Unknown destination framebuffer format %x",
-                          config.output_format.Value());
-                break;
-            }
-        }
+    if (output_width * output_height < PARALLEL_TRANSFER_MIN_PIXELS) {
+        transfer_rows(params, 0, output_height);
+        return;
     }
+
+    // Hand out bands of 8 rows, so that threads don't share tiles of a tiled output
+    const u32 num_bands = (output_height + 7) / 8;
+    VideoCore::GetThreadPool().ParallelFor(num_bands, [&](size_t band) {
+        const u32 first_row = static_cast<u32>(band) * 8;
+        transfer_rows(params, first_row, std::min(first_row + 8, output_height));
+    });
 }
 
 static void TextureCopy(const Regs::DisplayTransferConfig& config) {
@@ -398,6 +573,121 @@ static void TextureCopy(const Regs::DisplayTransferConfig& config) {
     }
 }
 
+static void ExecuteCommand(const GPUCommand& command) {
+    switch (command.type) {
+    case GPUCommand::Type::CommandList: {
+        MICROPROFILE_SCOPE(GPU_CmdlistProcessing);
+        Pica::CommandProcessor::ProcessCommandList(command.command_list, command.command_list_size);
+        break;
+    }
+
+    case GPUCommand::Type::MemoryFill: {
+        const auto& config = command.GetConfig<Regs::MemoryFillConfig>();
+        MemoryFill(config);
+        LOG_TRACE(HW_GPU, "MemoryFill from 0x%08x to 0x%08x", config.GetStartAddress(),
+                  config.GetEndAddress());
+
+        // It seems that it won't signal interrupt if "address_start" is zero.
+        // TODO: hwtest this
+        if (config.GetStartAddress() != 0) {
+            if (!command.is_second_filler) {
+                GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PSC0);
+            } else {
+                GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PSC1);
+            }
+        }
+        break;
+    }
+
+    case GPUCommand::Type::DisplayTransfer: {
+        MICROPROFILE_SCOPE(GPU_DisplayTransfer);
+
+        const auto& config = command.GetConfig<Regs::DisplayTransferConfig>();
+        if (Pica::g_debug_context)
+            Pica::g_debug_context->OnEvent(Pica::DebugContext::Event::IncomingDisplayTransfer,
+                                           nullptr);
+
+        if (config.is_texture_copy) {
+            TextureCopy(config);
+            LOG_TRACE(HW_GPU, "TextureCopy: 0x%X bytes from 0x%08X(%u+%u)-> "
+                              "0x%08X(%u+%u), flags 0x%08X",
+                      config.texture_copy.size, config.GetPhysicalInputAddress(),
+                      config.texture_copy.input_width * 16, config.texture_copy.input_gap * 16,
+                      config.GetPhysicalOutputAddress(), config.texture_copy.output_width * 16,
+                      config.texture_copy.output_gap * 16, config.flags);
+        } else {
+            DisplayTransfer(config);
+            LOG_TRACE(HW_GPU, "DisplayTransfer: 0x%08x(%ux%u)-> "
+                              "0x%08x(%ux%u), dst format %x, flags 0x%08X",
+                      config.GetPhysicalInputAddress(), config.input_width.Value(),
+                      config.input_height.Value(), config.GetPhysicalOutputAddress(),
+                      config.output_width.Value(), config.output_height.Value(),
+                      config.output_format.Value(), config.flags);
+        }
+
+        GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PPF);
+        break;
+    }
+    }
+}
+
+static void GPUThreadLoop() {
+    Common::SetCurrentThreadName("GPU");
+    MicroProfileOnThreadCreate("GPU");
+
+    GPUCommand command;
+    while (true) {
+        while (!gpu_queue.Pop(command)) {
+            if (!gpu_thread_running)
+                return;
+            work_available.Wait();
+        }
+
+        ExecuteCommand(command);
+
+        commands_completed.fetch_add(1, std::memory_order_release);
+        work_completed.Set();
+    }
+}
+
+/**
+ * Executes the command on the GPU thread if it is enabled, otherwise right away. The OpenGL
+ * rasterizer is bound to the emulated CPU's thread, so commands always run there while it's used.
+ */
+static void Submit(const GPUCommand& command) {
+    if (gpu_thread.joinable() && !VideoCore::g_hw_renderer_enabled) {
+        gpu_queue.Push(command);
+        commands_submitted.fetch_add(1, std::memory_order_relaxed);
+        work_available.Set();
+    } else {
+        WaitForIdle();
+        ExecuteCommand(command);
+    }
+}
+
+void WaitForIdle() {
+    if (!gpu_thread.joinable() || std::this_thread::get_id() == gpu_thread_id)
+        return;
+
+    const u64 target = commands_submitted.load(std::memory_order_relaxed);
+    while (commands_completed.load(std::memory_order_acquire) != target) {
+        work_completed.Wait();
+    }
+}
+
+bool IsGPUThread() {
+    return gpu_thread.joinable() && std::this_thread::get_id() == gpu_thread_id;
+}
+
+void RelayInterrupt(GSP_GPU::InterruptId interrupt_id) {
+    CoreTiming::ScheduleEvent_Threadsafe_Immediate(interrupt_event,
+                                                   static_cast<u64>(interrupt_id));
+}
+
+static void InterruptCallback(u64 userdata, int cycles_late) {
+    GSP_GPU::SignalInterrupt(static_cast<GSP_GPU::InterruptId>(userdata));
+}
+
 template <typename T>
 inline void Write(u32 addr, const T data) {
     addr -= HW::VADDR_GPU;
@@ -420,19 +710,10 @@ inline void Write(u32 addr, const T data) {
         auto& config = g_regs.memory_fill_config[is_second_filler];
 
         if (config.trigger) {
-            MemoryFill(config);
-            LOG_TRACE(HW_GPU, "MemoryFill from 0x%08x to 0x%08x", config.GetStartAddress(),
-                      config.GetEndAddress());
-
-            // It seems that it won't signal interrupt if "address_start" is zero.
-            // TODO: hwtest this
-            if (config.GetStartAddress() != 0) {
-                if (!is_second_filler) {
-                    GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PSC0);
-                } else {
-                    GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PSC1);
-                }
-            }
+            GPUCommand command{GPUCommand::Type::MemoryFill};
+            command.is_second_filler = is_second_filler;
+            command.SetConfig(config);
+            Submit(command);
 
             // Reset "trigger" flag and set the "finish" flag
             // NOTE: This was confirmed to happen on hardware even if "address_start" is zero.
@@ -443,35 +724,13 @@ inline void Write(u32 addr, const T data) {
     }
 
     case GPU_REG_INDEX(display_transfer_config.trigger): {
-        MICROPROFILE_SCOPE(GPU_DisplayTransfer);
-
         const auto& config = g_regs.display_transfer_config;
         if (config.trigger & 1) {
-
-            if (Pica::g_debug_context)
-                Pica::g_debug_context->OnEvent(Pica::DebugContext::Event::IncomingDisplayTransfer,
-                                               nullptr);
-
-            if (config.is_texture_copy) {
-                TextureCopy(config);
-                LOG_TRACE(HW_GPU, "TextureCopy: 0x%X bytes from 0x%08X(%u+%u)-> "
-                                  "0x%08X(%u+%u), flags 0x%08X",
-                          config.texture_copy.size, config.GetPhysicalInputAddress(),
-                          config.texture_copy.input_width * 16, config.texture_copy.input_gap * 16,
-                          config.GetPhysicalOutputAddress(), config.texture_copy.output_width * 16,
-                          config.texture_copy.output_gap * 16, config.flags);
-            } else {
-                DisplayTransfer(config);
-                LOG_TRACE(HW_GPU, "DisplayTransfer: 0x%08x(%ux%u)-> "
-                                  "0x%08x(%ux%u), dst format %x, flags 0x%08X",
-                          config.GetPhysicalInputAddress(), config.input_width.Value(),
-                          config.input_height.Value(), config.GetPhysicalOutputAddress(),
-                          config.output_width.Value(), config.output_height.Value(),
-                          config.output_format.Value(), config.flags);
-            }
+            GPUCommand command{GPUCommand::Type::DisplayTransfer};
+            command.SetConfig(config);
+            Submit(command);
 
             g_regs.display_transfer_config.trigger = 0;
-            GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::PPF);
         }
         break;
     }
@@ -480,8 +739,6 @@ inline void Write(u32 addr, const T data) {
     case GPU_REG_INDEX(command_processor_config.trigger): {
         const auto& config = g_regs.command_processor_config;
         if (config.trigger & 1) {
-            MICROPROFILE_SCOPE(GPU_CmdlistProcessing);
-
             u32* buffer = (u32*)Memory::GetPhysicalPointer(config.GetPhysicalAddress());
 
             if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
@@ -489,7 +746,10 @@ inline void Write(u32 addr, const T data) {
                     (u8*)buffer, config.size * sizeof(u32), config.GetPhysicalAddress());
             }
 
-            Pica::CommandProcessor::ProcessCommandList(buffer, config.size);
+            GPUCommand command{GPUCommand::Type::CommandList};
+            command.command_list = buffer;
+            command.command_list_size = config.size;
+            Submit(command);
 
             g_regs.command_processor_config.trigger = 0;
         }
@@ -523,6 +783,9 @@ template void Write<u8>(u32 addr, const u8 data);
 
 /// Update hardware
 static void VBlankCallback(u64 userdata, int cycles_late) {
+    // Everything submitted during the frame must be visible before it's presented
+    WaitForIdle();
+
     frame_count++;
     last_skip_frame = g_skip_frame;
     g_skip_frame = (frame_count & Settings::values.frame_skip) != 0;
@@ -587,12 +850,27 @@ void Init() {
 
     vblank_event = CoreTiming::RegisterEvent("GPU::VBlankCallback", VBlankCallback);
     CoreTiming::ScheduleEvent(frame_ticks, vblank_event);
+    interrupt_event = CoreTiming::RegisterEvent("GPU::InterruptCallback", InterruptCallback);
+
+    if (Settings::values.use_async_gpu) {
+        commands_submitted = 0;
+        commands_completed = 0;
+        gpu_thread_running = true;
+        gpu_thread = std::thread(GPUThreadLoop);
+        gpu_thread_id = gpu_thread.get_id();
+    }
 
     LOG_DEBUG(HW_GPU, "initialized OK");
 }
 
 /// Shutdown hardware
 void Shutdown() {
+    if (gpu_thread.joinable()) {
+        gpu_thread_running = false;
+        work_available.Set();
+        gpu_thread.join();
+    }
+
     LOG_DEBUG(HW_GPU, "shutdown OK");
 }
 
@@ -11,6 +11,10 @@
 #include "common/common_funcs.h"
 #include "common/common_types.h"
 
+namespace GSP_GPU {
+enum class InterruptId : u8;
+}
+
 namespace GPU {
 
 // Returns index corresponding to the Regs member labeled by field_name
@@ -324,6 +328,18 @@ void Read(T& var, const u32 addr);
 template <typename T>
 void Write(u32 addr, const T data);
 
+/**
+ * Blocks until the GPU thread has executed all work submitted so far, making its results visible
+ * to the caller. Does nothing if the GPU thread is disabled or when called from the GPU thread.
+ */
+void WaitForIdle();
+
+/// Returns whether the caller is running on the GPU thread
+bool IsGPUThread();
+
+/// Raises an interrupt on the emulated CPU's thread, for interrupts raised on the GPU thread
+void RelayInterrupt(GSP_GPU::InterruptId interrupt_id);
+
 /// Initialize hardware
 void Init();
 
@@ -14,6 +14,9 @@
 #include "core/hle/service/fs/archive.h"
 #include "core/loader/ncch.h"
 #include "core/memory.h"
+#include "video_core/renderer_base.h"
+#include "video_core/shader/shader.h"
+#include "video_core/video_core.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Loader namespace
@@ -152,6 +155,10 @@ ResultStatus AppLoader_NCCH::LoadExec() {
 
         Kernel::g_current_process = Kernel::Process::Create(std::move(codeset));
 
+        Pica::Shader::LoadDiskCache(ncch_header.program_id);
+        if (VideoCore::g_renderer != nullptr)
+            VideoCore::g_renderer->LoadDiskCache(ncch_header.program_id);
+
         // Attach a resource limit to the process based on the resource limit category
         Kernel::g_current_process->resource_limit =
             Kernel::ResourceLimit::GetForCategory(static_cast<Kernel::ResourceLimitCategory>(
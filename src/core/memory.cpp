@@ -11,6 +11,7 @@
 #include "core/arm/arm_interface.h"
 #include "core/core.h"
 #include "core/hle/kernel/process.h"
+#include "core/hw/gpu.h"
 #include "core/memory.h"
 #include "core/memory_setup.h"
 #include "core/mmio.h"
@@ -47,7 +48,7 @@ struct SpecialRegion {
  * requires an indexed fetch and a check for NULL.
  */
 struct PageTable {
-    static const size_t NUM_ENTRIES = 1 << (32 - PAGE_BITS);
+    static const size_t NUM_ENTRIES = PAGE_TABLE_NUM_ENTRIES;
 
     /**
      * Array of memory pointers backing each page. An entry can only be non-null if the
@@ -79,6 +80,74 @@ static PageTable main_page_table;
 /// Currently active page table
 static PageTable* current_page_table = &main_page_table;
 
+/// Start of the physical address range covered by the physical page table (the IO area)
+static const PAddr PHYSICAL_TABLE_PADDR = IO_AREA_PADDR;
+/// End of the physical address range covered by the physical page table (the end of FCRAM)
+static const PAddr PHYSICAL_TABLE_PADDR_END = FCRAM_PADDR_END;
+static const size_t PHYSICAL_TABLE_NUM_ENTRIES =
+    (PHYSICAL_TABLE_PADDR_END - PHYSICAL_TABLE_PADDR) >> PAGE_BITS;
+
+/**
+ * Memory pointers backing each physical page, indexed by page relative to PHYSICAL_TABLE_PADDR.
+ * Entries are filled in whenever a virtual region that maps 1:1 to physical memory is mapped to
+ * regular memory. They are kept while the page is cached by the rasterizer, and when only one of
+ * the virtual regions aliasing the page is unmapped. This lets hardware access physical memory
+ * without going through (or depending on the state of) the page table.
+ */
+static std::array<u8*, PHYSICAL_TABLE_NUM_ENTRIES> physical_page_pointers;
+
+/**
+ * Converts a virtual address to a physical address if it is inside one of the regions with a 1:1
+ * mapping to physical memory.
+ * @returns true on success, false if the address is not in such a region
+ */
+static bool TryVirtualToPhysicalAddress(VAddr addr, PAddr& paddr) {
+    if (addr >= VRAM_VADDR && addr < VRAM_VADDR_END) {
+        paddr = addr - VRAM_VADDR + VRAM_PADDR;
+    } else if (addr >= LINEAR_HEAP_VADDR && addr < LINEAR_HEAP_VADDR_END) {
+        paddr = addr - LINEAR_HEAP_VADDR + FCRAM_PADDR;
+    } else if (addr >= DSP_RAM_VADDR && addr < DSP_RAM_VADDR_END) {
+        paddr = addr - DSP_RAM_VADDR + DSP_RAM_PADDR;
+    } else if (addr >= IO_AREA_VADDR && addr < IO_AREA_VADDR_END) {
+        paddr = addr - IO_AREA_VADDR + IO_AREA_PADDR;
+    } else if (addr >= NEW_LINEAR_HEAP_VADDR && addr < NEW_LINEAR_HEAP_VADDR_END) {
+        paddr = addr - NEW_LINEAR_HEAP_VADDR + FCRAM_PADDR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/// Returns the memory backing the physical page containing paddr, or nullptr if there is none.
+static u8* GetPhysicalPagePointer(PAddr paddr) {
+    if (paddr < PHYSICAL_TABLE_PADDR || paddr >= PHYSICAL_TABLE_PADDR_END) {
+        return nullptr;
+    }
+    return physical_page_pointers[(paddr - PHYSICAL_TABLE_PADDR) >> PAGE_BITS];
+}
+
+/**
+ * Returns true if a page other than the one at vaddr that maps 1:1 to the given physical page is
+ * mapped to memory. FCRAM is visible through both the linear heap and the new linear heap.
+ */
+static bool IsPhysicalPageMappedElsewhere(VAddr vaddr, PAddr paddr) {
+    if (paddr < FCRAM_PADDR || paddr >= FCRAM_PADDR_END) {
+        return false;
+    }
+
+    for (VAddr alias : {paddr - FCRAM_PADDR + LINEAR_HEAP_VADDR,
+                        paddr - FCRAM_PADDR + NEW_LINEAR_HEAP_VADDR}) {
+        if (alias == vaddr) {
+            continue;
+        }
+        PageType type = current_page_table->attributes[alias >> PAGE_BITS];
+        if (type == PageType::Memory || type == PageType::RasterizerCachedMemory) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void MapPages(u32 base, u32 size, u8* memory, PageType type) {
     LOG_DEBUG(HW_Memory, "Mapping %p onto %08X-%08X", memory, base * PAGE_SIZE,
               (base + size) * PAGE_SIZE);
@@ -100,6 +169,15 @@ static void MapPages(u32 base, u32 size, u8* memory, PageType type) {
         current_page_table->pointers[base] = memory;
         current_page_table->cached_res_count[base] = 0;
 
+        // Both mappings of an aliased physical page share its backing memory, so the entry is
+        // only cleared once neither of them is mapped anymore
+        PAddr paddr;
+        if (TryVirtualToPhysicalAddress(base << PAGE_BITS, paddr) &&
+            paddr >= PHYSICAL_TABLE_PADDR && paddr < PHYSICAL_TABLE_PADDR_END &&
+            (memory != nullptr || !IsPhysicalPageMappedElsewhere(base << PAGE_BITS, paddr))) {
+            physical_page_pointers[(paddr - PHYSICAL_TABLE_PADDR) >> PAGE_BITS] = memory;
+        }
+
         base += 1;
         if (memory != nullptr)
             memory += PAGE_SIZE;
@@ -110,6 +188,7 @@ void InitMemoryMap() {
     main_page_table.pointers.fill(nullptr);
     main_page_table.attributes.fill(PageType::Unmapped);
     main_page_table.cached_res_count.fill(0);
+    physical_page_pointers.fill(nullptr);
 }
 
 void MapMemoryRegion(VAddr base, u32 size, u8* target) {
@@ -287,6 +366,10 @@ u8* GetPointer(const VAddr vaddr) {
     return nullptr;
 }
 
+std::array<u8*, PAGE_TABLE_NUM_ENTRIES>* GetCurrentPageTablePointers() {
+    return &current_page_table->pointers;
+}
+
 std::string ReadCString(VAddr vaddr, std::size_t max_length) {
     std::string string;
     string.reserve(max_length);
@@ -302,7 +385,12 @@ std::string ReadCString(VAddr vaddr, std::size_t max_length) {
 }
 
 u8* GetPhysicalPointer(PAddr address) {
-    // TODO(Subv): This call should not go through the application's memory mapping.
+    u8* page_pointer = GetPhysicalPagePointer(address);
+    if (page_pointer) {
+        return page_pointer + (address & PAGE_MASK);
+    }
+
+    // Not backed by regular memory, let GetPointer report the error
     return GetPointer(PhysicalToVirtualAddress(address));
 }
 
@@ -345,8 +433,7 @@ void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
             switch (page_type) {
             case PageType::RasterizerCachedMemory:
                 page_type = PageType::Memory;
-                current_page_table->pointers[vaddr >> PAGE_BITS] =
-                    GetPointerFromVMA(vaddr & ~PAGE_MASK);
+                current_page_table->pointers[vaddr >> PAGE_BITS] = GetPhysicalPagePointer(paddr);
                 break;
             case PageType::RasterizerCachedSpecial:
                 page_type = PageType::Special;
@@ -360,12 +447,14 @@ void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
 }
 
 void RasterizerFlushRegion(PAddr start, u32 size) {
+    GPU::WaitForIdle();
     if (VideoCore::g_renderer != nullptr) {
         VideoCore::g_renderer->Rasterizer()->FlushRegion(start, size);
     }
 }
 
 void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size) {
+    GPU::WaitForIdle();
     if (VideoCore::g_renderer != nullptr) {
         VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(start, size);
     }
@@ -670,16 +759,11 @@ void WriteMMIO<u64>(MMIORegionPointer mmio_handler, VAddr addr, const u64 data)
 PAddr VirtualToPhysicalAddress(const VAddr addr) {
     if (addr == 0) {
         return 0;
-    } else if (addr >= VRAM_VADDR && addr < VRAM_VADDR_END) {
-        return addr - VRAM_VADDR + VRAM_PADDR;
-    } else if (addr >= LINEAR_HEAP_VADDR && addr < LINEAR_HEAP_VADDR_END) {
-        return addr - LINEAR_HEAP_VADDR + FCRAM_PADDR;
-    } else if (addr >= DSP_RAM_VADDR && addr < DSP_RAM_VADDR_END) {
-        return addr - DSP_RAM_VADDR + DSP_RAM_PADDR;
-    } else if (addr >= IO_AREA_VADDR && addr < IO_AREA_VADDR_END) {
-        return addr - IO_AREA_VADDR + IO_AREA_PADDR;
-    } else if (addr >= NEW_LINEAR_HEAP_VADDR && addr < NEW_LINEAR_HEAP_VADDR_END) {
-        return addr - NEW_LINEAR_HEAP_VADDR + FCRAM_PADDR;
+    }
+
+    PAddr paddr;
+    if (TryVirtualToPhysicalAddress(addr, paddr)) {
+        return paddr;
     }
 
     LOG_ERROR(HW_Memory, "Unknown virtual address @ 0x%08X", addr);
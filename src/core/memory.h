@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <string>
 #include "common/common_types.h"
@@ -17,6 +18,7 @@ namespace Memory {
 const u32 PAGE_SIZE = 0x1000;
 const u32 PAGE_MASK = PAGE_SIZE - 1;
 const int PAGE_BITS = 12;
+const size_t PAGE_TABLE_NUM_ENTRIES = 1 << (32 - PAGE_BITS);
 
 /// Physical memory regions as seen from the ARM11
 enum : PAddr {
@@ -131,6 +133,14 @@ void CopyBlock(VAddr dest_addr, VAddr src_addr, size_t size);
 
 u8* GetPointer(VAddr virtual_address);
 
+/**
+ * Returns the host pointers backing each page of the current page table, indexed by
+ * `vaddr >> PAGE_BITS`. An entry is non-null only for pages mapped to regular memory, so accesses
+ * to any other page (unmapped, MMIO or rasterizer cached) must go through the Read/Write
+ * functions. This lets CPU backends access regular memory directly.
+ */
+std::array<u8*, PAGE_TABLE_NUM_ENTRIES>* GetCurrentPageTablePointers();
+
 std::string ReadCString(VAddr virtual_address, std::size_t max_length);
 
 /**
@@ -21,6 +21,10 @@ void Apply() {
     VideoCore::g_hw_renderer_enabled = values.use_hw_renderer;
     VideoCore::g_shader_jit_enabled = values.use_shader_jit;
     VideoCore::g_scaled_resolution_enabled = values.use_scaled_resolution;
+    VideoCore::g_sw_rasterizer_threads = values.sw_rasterizer_threads;
+    VideoCore::g_vertex_shader_threads = values.vertex_shader_threads;
+    VideoCore::g_headless_renderer_enabled = values.use_headless_renderer;
+    VideoCore::g_headless_frame_dump_interval = values.headless_frame_dump_interval;
 
     if (VideoCore::g_emu_window) {
         auto layout = VideoCore::g_emu_window->GetFramebufferLayout();
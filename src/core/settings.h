@@ -152,6 +152,12 @@ struct Values {
     bool use_shader_jit;
     bool use_scaled_resolution;
     bool use_vsync;
+    int sw_rasterizer_threads;
+    int vertex_shader_threads;
+    bool use_async_gpu;
+    bool use_headless_renderer;
+    int headless_frame_dump_interval;
+    int headless_frame_limit;
 
     LayoutOption layout_option;
     bool swap_screen;
@@ -161,10 +167,13 @@ struct Values {
     float bg_blue;
 
     std::string log_filter;
+    bool use_async_logging;
 
     // Audio
     std::string sink_id;
     bool enable_audio_stretching;
+    bool use_audio_thread;
+    int audio_latency;
 
     // Debugging
     bool use_gdbstub;
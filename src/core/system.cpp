@@ -11,6 +11,7 @@
 #include "core/hle/hle.h"
 #include "core/hle/kernel/kernel.h"
 #include "core/hle/kernel/memory.h"
+#include "core/hw/gpu.h"
 #include "core/hw/hw.h"
 #include "core/system.h"
 #include "input_core/input_core.h"
@@ -49,6 +50,7 @@ void Shutdown() {
 	CheatCore::Shutdown();
     InputCore::Shutdown();
     AudioCore::Shutdown();
+    GPU::WaitForIdle();
     VideoCore::Shutdown();
     HLE::Shutdown();
     Kernel::Shutdown();
@@ -0,0 +1,104 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+#include <catch.hpp>
+
+#include "audio_core/codec.h"
+#include "audio_core/interpolate.h"
+#include "common/common_types.h"
+
+static std::vector<u8> MakeADPCMData(size_t sample_count) {
+    // 8 byte frames with 14 samples each: a header byte followed by 7 bytes of nibbles
+    std::vector<u8> data((sample_count + 13) / 14 * 8);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<u8>(i % 8 == 0 ? 0x12 : i * 37);
+    return data;
+}
+
+TEST_CASE("Audio decoding and resampling reuse their output buffers", "[audio_core]") {
+    constexpr size_t sample_count = 1024;
+    const std::vector<u8> data = MakeADPCMData(sample_count);
+    const std::array<s16, 16> coeffs{{0x800, 0, 0x400, 0x200}};
+
+    Codec::ADPCMState adpcm_state{};
+    AudioInterp::State interp_state{};
+    Codec::StereoBuffer16 decoded;
+    Codec::StereoBuffer16 resampled;
+
+    Codec::DecodeADPCM(data.data(), sample_count, coeffs, adpcm_state, decoded);
+    AudioInterp::Linear(interp_state, decoded, 0.75f, resampled);
+    REQUIRE(decoded.size() == sample_count);
+
+    const auto* decoded_storage = decoded.data();
+    const auto* resampled_storage = resampled.data();
+    const size_t resampled_size = resampled.size();
+
+    // Decoding the same amount of data again must not reallocate, and must give the same results
+    // as decoding into fresh buffers
+    Codec::ADPCMState fresh_adpcm_state = adpcm_state;
+    AudioInterp::State fresh_interp_state = interp_state;
+    Codec::StereoBuffer16 fresh_decoded;
+    Codec::StereoBuffer16 fresh_resampled;
+    Codec::DecodeADPCM(data.data(), sample_count, coeffs, fresh_adpcm_state, fresh_decoded);
+    AudioInterp::Linear(fresh_interp_state, fresh_decoded, 0.75f, fresh_resampled);
+
+    Codec::DecodeADPCM(data.data(), sample_count, coeffs, adpcm_state, decoded);
+    AudioInterp::Linear(interp_state, decoded, 0.75f, resampled);
+
+    REQUIRE(decoded.data() == decoded_storage);
+    REQUIRE(resampled.data() == resampled_storage);
+    REQUIRE(resampled.size() == resampled_size);
+    REQUIRE(decoded == fresh_decoded);
+    REQUIRE(resampled == fresh_resampled);
+}
+
+// Micro-benchmark of the per-source work done by the DSP every audio frame, run explicitly with
+// `tests [benchmark]`
+TEST_CASE("Audio source pipeline throughput", "[.][benchmark]") {
+    constexpr size_t num_sources = 24;
+    constexpr size_t samples_per_frame = 160;
+    constexpr size_t frames_per_buffer = 32;
+    constexpr size_t sample_count = samples_per_frame * frames_per_buffer;
+    constexpr int iterations = 200;
+
+    const std::vector<u8> data = MakeADPCMData(sample_count);
+    const std::array<s16, 16> coeffs{{0x800, 0, 0x400, 0x200}};
+
+    struct SourceState {
+        Codec::ADPCMState adpcm_state{};
+        AudioInterp::State interp_state{};
+        Codec::StereoBuffer16 decoded;
+        Codec::StereoBuffer16 resampled;
+    };
+    std::vector<SourceState> sources(num_sources);
+    std::array<std::array<s16, 2>, samples_per_frame> frame;
+
+    size_t frames = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (SourceState& source : sources) {
+            Codec::DecodeADPCM(data.data(), sample_count, coeffs, source.adpcm_state,
+                               source.decoded);
+            AudioInterp::Linear(source.interp_state, source.decoded, 1.0f, source.resampled);
+
+            // Play the buffer back a frame at a time, as Source::GenerateFrame does
+            for (size_t position = 0; position < source.resampled.size();
+                 position += samples_per_frame) {
+                const size_t size =
+                    std::min(samples_per_frame, source.resampled.size() - position);
+                std::copy_n(source.resampled.begin() + position, size, frame.begin());
+                ++frames;
+            }
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    WARN("ADPCM decode + linear resampling: " << elapsed.count() / frames
+                                              << " ns per frame per source");
+}
@@ -0,0 +1,60 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <utility>
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "common/linear_disk_cache.h"
+
+namespace {
+
+class Collector final : public LinearDiskCacheReader<u64, u32> {
+public:
+    void Read(const u64& key, const u32* value, u32 value_size) override {
+        entries.emplace_back(key, std::vector<u32>(value, value + value_size));
+    }
+
+    std::vector<std::pair<u64, std::vector<u32>>> entries;
+};
+
+} // anonymous namespace
+
+TEST_CASE("LinearDiskCache", "[common]") {
+    const std::string filename = "./linear_disk_cache_test.bin";
+    FileUtil::Delete(filename);
+
+    const std::vector<u32> first{1, 2, 3};
+    const std::vector<u32> second{4, 5};
+
+    {
+        LinearDiskCache<u64, u32> cache;
+        Collector collector;
+        REQUIRE(cache.OpenAndRead(filename.c_str(), collector) == 0);
+        cache.Append(0x1234, first.data(), static_cast<u32>(first.size()));
+        cache.Close();
+    }
+
+    {
+        // Reopening reads back existing entries and appends after them
+        LinearDiskCache<u64, u32> cache;
+        Collector collector;
+        REQUIRE(cache.OpenAndRead(filename.c_str(), collector) == 1);
+        cache.Append(0x5678, second.data(), static_cast<u32>(second.size()));
+        cache.Close();
+    }
+
+    LinearDiskCache<u64, u32> cache;
+    Collector collector;
+    REQUIRE(cache.OpenAndRead(filename.c_str(), collector) == 2);
+    cache.Close();
+
+    REQUIRE(collector.entries.size() == 2);
+    REQUIRE(collector.entries[0].first == 0x1234);
+    REQUIRE(collector.entries[0].second == first);
+    REQUIRE(collector.entries[1].first == 0x5678);
+    REQUIRE(collector.entries[1].second == second);
+
+    FileUtil::Delete(filename);
+}
@@ -0,0 +1,87 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "common/logging/backend.h"
+#include "common/logging/log.h"
+
+// Stay below the size of the message queue, so that no message is dropped for lack of space
+static constexpr int NUM_THREADS = 4;
+static constexpr int MESSAGES_PER_THREAD = 200;
+
+/// Returns, for each thread, the sorted indices of its messages found in the log file
+static std::array<std::vector<int>, NUM_THREADS> ReadLoggedMessages(const std::string& filename) {
+    std::string contents;
+    FileUtil::ReadFileToString(true, filename.c_str(), contents);
+
+    std::array<std::vector<int>, NUM_THREADS> messages;
+    std::istringstream stream(contents);
+    std::string line;
+    while (std::getline(stream, line)) {
+        const size_t position = line.find("async log test ");
+        int thread, index;
+        if (position != std::string::npos &&
+            std::sscanf(line.c_str() + position, "async log test %d %d", &thread, &index) == 2) {
+            messages[thread].push_back(index);
+        }
+    }
+    for (auto& indices : messages)
+        std::sort(indices.begin(), indices.end());
+    return messages;
+}
+
+TEST_CASE("Logging: Queued messages are written by StopAsyncLogging", "[common]") {
+    const std::string filename = "./async_logging_test.log";
+
+    for (int iteration = 0; iteration < 5; ++iteration) {
+        FileUtil::Delete(filename);
+        Log::StartAsyncLogging(filename);
+        const u64 dropped_before = Log::GetDroppedMessageCount();
+
+        // Threads keep logging while StopAsyncLogging runs. Every message whose LogMessage call
+        // returned before it was called must be in the file. Messages logged while it runs are
+        // written to the file until it is closed, so no message may be missing in between.
+        std::atomic<bool> stopping{false};
+        std::array<std::atomic<int>, NUM_THREADS> logged_before_stop{};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < MESSAGES_PER_THREAD; ++i) {
+                    LOG_INFO(Log, "async log test %d %d", t, i);
+                    if (!stopping)
+                        logged_before_stop[t] = i + 1;
+                    if (i == MESSAGES_PER_THREAD / 2)
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        while (logged_before_stop[iteration % NUM_THREADS] < MESSAGES_PER_THREAD / 2)
+            std::this_thread::yield();
+        stopping = true;
+        Log::StopAsyncLogging();
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(Log::GetDroppedMessageCount() == dropped_before);
+        const auto messages = ReadLoggedMessages(filename);
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            REQUIRE(messages[t].size() >= static_cast<size_t>(logged_before_stop[t]));
+            for (size_t i = 0; i < messages[t].size(); ++i) {
+                REQUIRE(messages[t][i] == static_cast<int>(i));
+            }
+        }
+    }
+
+    FileUtil::Delete(filename);
+}
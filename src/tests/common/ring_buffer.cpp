@@ -0,0 +1,69 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/ring_buffer.h"
+
+TEST_CASE("RingBuffer: Basic", "[common]") {
+    Common::RingBuffer<u32> buffer(6);
+    REQUIRE(buffer.Capacity() == 8);
+    REQUIRE(buffer.Size() == 0);
+
+    std::array<u32, 10> input;
+    std::iota(input.begin(), input.end(), 0);
+    std::array<u32, 10> output{};
+
+    // Values that don't fit are left out
+    REQUIRE(buffer.Push(input.data(), 10) == 8);
+    REQUIRE(buffer.Size() == 8);
+
+    REQUIRE(buffer.Pop(output.data(), 5) == 5);
+    REQUIRE(output[0] == 0);
+    REQUIRE(output[4] == 4);
+
+    // Wraps around the end of the storage
+    REQUIRE(buffer.Push(input.data() + 8, 2) == 2);
+    REQUIRE(buffer.Pop(output.data(), 10) == 5);
+    REQUIRE(output[0] == 5);
+    REQUIRE(output[2] == 7);
+    REQUIRE(output[3] == 8);
+    REQUIRE(output[4] == 9);
+    REQUIRE(buffer.Size() == 0);
+    REQUIRE(buffer.Pop(output.data(), 10) == 0);
+}
+
+TEST_CASE("RingBuffer: Threaded", "[common]") {
+    constexpr u32 count = 1000000;
+    Common::RingBuffer<u32> buffer(100);
+
+    std::thread producer([&buffer] {
+        std::array<u32, 7> values;
+        u32 next = 0;
+        while (next < count) {
+            const u32 size = std::min<u32>(values.size(), count - next);
+            for (u32 i = 0; i < size; ++i)
+                values[i] = next + i;
+            next += buffer.Push(values.data(), size);
+        }
+    });
+
+    std::array<u32, 13> values;
+    u32 expected = 0;
+    bool in_order = true;
+    while (expected < count) {
+        const size_t popped = buffer.Pop(values.data(), values.size());
+        for (size_t i = 0; i < popped; ++i)
+            in_order &= values[i] == expected++;
+    }
+    producer.join();
+
+    REQUIRE(in_order);
+    REQUIRE(buffer.Size() == 0);
+}
@@ -0,0 +1,84 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <thread>
+#include <catch.hpp>
+#include "common/common_types.h"
+#include "common/spsc_queue.h"
+
+namespace {
+
+/// Counts default constructions, which the queue does once for each node it allocates
+struct Counted {
+    Counted() {
+        ++constructed;
+    }
+    Counted(u32 value) : value(value) {}
+
+    u32 value = 0;
+    static int constructed;
+};
+
+int Counted::constructed = 0;
+
+} // anonymous namespace
+
+TEST_CASE("SPSCQueue: Basic", "[common]") {
+    Common::SPSCQueue<std::unique_ptr<u32>> queue;
+    std::unique_ptr<u32> value;
+    REQUIRE(!queue.Pop(value));
+
+    for (u32 i = 0; i < 3; ++i)
+        queue.Push(std::make_unique<u32>(i));
+
+    for (u32 i = 0; i < 3; ++i) {
+        REQUIRE(queue.Pop(value));
+        REQUIRE(*value == i);
+    }
+    REQUIRE(!queue.Pop(value));
+    REQUIRE(*value == 2);
+}
+
+TEST_CASE("SPSCQueue: Popped nodes are reused", "[common]") {
+    Common::SPSCQueue<Counted> queue;
+    Counted value;
+    Counted::constructed = 0;
+
+    for (u32 i = 0; i < 1000; ++i) {
+        queue.Push(Counted(i));
+        queue.Push(Counted(i + 1));
+        REQUIRE(queue.Pop(value));
+        REQUIRE(value.value == i);
+        REQUIRE(queue.Pop(value));
+        REQUIRE(value.value == i + 1);
+    }
+    REQUIRE(!queue.Pop(value));
+
+    // Two values in flight at most, plus the empty tail and a node not yet handed back
+    REQUIRE(Counted::constructed <= 4);
+}
+
+TEST_CASE("SPSCQueue: Threaded", "[common]") {
+    constexpr u32 count = 1000000;
+    Common::SPSCQueue<u32> queue;
+
+    std::thread producer([&queue] {
+        for (u32 i = 0; i < count; ++i)
+            queue.Push(i);
+    });
+
+    u32 expected = 0;
+    bool in_order = true;
+    while (expected < count) {
+        u32 value;
+        if (queue.Pop(value))
+            in_order &= value == expected++;
+    }
+    producer.join();
+
+    u32 value;
+    REQUIRE(in_order);
+    REQUIRE(!queue.Pop(value));
+}
@@ -0,0 +1,66 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <catch.hpp>
+#include "common/thread_pool.h"
+
+/// Runs a loop on the pool, returning how many times each index ran and the threads that ran them
+static std::set<std::thread::id> RunLoop(Common::ThreadPool& pool, size_t count,
+                                         size_t max_threads, std::vector<int>& runs) {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    runs.assign(count, 0);
+    pool.ParallelFor(count,
+                     [&](size_t i) {
+                         std::lock_guard<std::mutex> lock(mutex);
+                         threads.insert(std::this_thread::get_id());
+                         ++runs[i];
+                         // Keep the loop busy long enough for all threads to join in
+                         std::this_thread::sleep_for(std::chrono::microseconds(100));
+                     },
+                     max_threads);
+    return threads;
+}
+
+TEST_CASE("ThreadPool: Thread limits", "[common]") {
+    Common::ThreadPool pool(4, "Test");
+    REQUIRE(pool.GetNumThreads() == 4);
+    std::vector<int> runs;
+
+    auto threads = RunLoop(pool, 200, 1, runs);
+    REQUIRE(threads == std::set<std::thread::id>{std::this_thread::get_id()});
+    REQUIRE(std::vector<int>(200, 1) == runs);
+
+    threads = RunLoop(pool, 200, 2, runs);
+    REQUIRE(threads.size() <= 2);
+    REQUIRE(std::vector<int>(200, 1) == runs);
+
+    threads = RunLoop(pool, 200, 0, runs);
+    REQUIRE(threads.size() <= 4);
+    REQUIRE(std::vector<int>(200, 1) == runs);
+
+    RunLoop(pool, 0, 0, runs);
+    REQUIRE(runs.empty());
+}
+
+TEST_CASE("ThreadPool: Concurrent callers", "[common]") {
+    Common::ThreadPool pool(3, "Test");
+    std::atomic<int> total{0};
+
+    auto caller = [&] {
+        for (int i = 0; i < 50; ++i)
+            pool.ParallelFor(10, [&](size_t) { ++total; });
+    };
+    std::thread other(caller);
+    caller();
+    other.join();
+
+    REQUIRE(total == 2 * 50 * 10);
+}
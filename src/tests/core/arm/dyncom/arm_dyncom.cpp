@@ -0,0 +1,81 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "core/arm/dyncom/arm_dyncom.h"
+#include "core/arm/skyeye_common/armstate.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+
+namespace {
+
+constexpr VAddr CODE_VADDR = 0x00100000;
+
+/// Maps two pages of memory for code and provides a CPU core to run it
+class TestEnvironment {
+public:
+    TestEnvironment() : memory(2 * Memory::PAGE_SIZE), cpu(USER32MODE) {
+        Memory::MapMemoryRegion(CODE_VADDR, static_cast<u32>(memory.size()), memory.data());
+    }
+
+    ~TestEnvironment() {
+        Memory::UnmapRegion(CODE_VADDR, static_cast<u32>(memory.size()));
+    }
+
+    void Run(VAddr pc, int num_instructions) {
+        // Keep CoreTiming out of the way, nothing is scheduled
+        cpu.down_count = 1000000;
+        cpu.SetPC(pc);
+        cpu.Run(num_instructions);
+    }
+
+    std::vector<u8> memory;
+    ARM_DynCom cpu;
+};
+
+} // anonymous namespace
+
+TEST_CASE("ARM_DynCom: Code writes take effect after ClearInstructionCache", "[core][arm]") {
+    TestEnvironment env;
+    Memory::Write32(CODE_VADDR, 0xE3A00001);     // mov r0, #1
+    Memory::Write32(CODE_VADDR + 4, 0xEAFFFFFD); // b CODE_VADDR
+
+    env.Run(CODE_VADDR, 2);
+    REQUIRE(env.cpu.GetReg(0) == 1);
+    REQUIRE(env.cpu.GetPC() == CODE_VADDR);
+
+    // The translated block keeps being used until the cache is cleared
+    Memory::Write32(CODE_VADDR, 0xE3A00002); // mov r0, #2
+    env.Run(CODE_VADDR, 2);
+    REQUIRE(env.cpu.GetReg(0) == 1);
+
+    env.cpu.ClearInstructionCache();
+    env.Run(CODE_VADDR, 2);
+    REQUIRE(env.cpu.GetReg(0) == 2);
+}
+
+TEST_CASE("ARM_DynCom: Thumb BL split across a page boundary", "[core][arm]") {
+    TestEnvironment env;
+    const VAddr page_end = CODE_VADDR + Memory::PAGE_SIZE;
+    Memory::Write16(page_end - 4, 0x2001);     // movs r0, #1
+    Memory::Write16(page_end - 2, 0xF000);     // bl page_end + 0x100 (first half)
+    Memory::Write16(page_end, 0xF87F);         // bl page_end + 0x100 (second half)
+    Memory::Write16(page_end + 0x100, 0x2105); // movs r1, #5
+    Memory::Write16(page_end + 0x102, 0xE7FE); // b .
+    Memory::Write16(page_end + 0x200, 0x2107); // movs r1, #7
+    Memory::Write16(page_end + 0x202, 0xE7FE); // b .
+
+    env.cpu.SetCPSR(env.cpu.GetCPSR() | (1 << 5));
+    env.Run(page_end - 4, 4);
+    REQUIRE(env.cpu.GetReg(0) == 1);
+    REQUIRE(env.cpu.GetReg(1) == 5);
+    REQUIRE(env.cpu.GetReg(14) == ((page_end + 2) | 1));
+
+    // Rewriting the second half in the next page redirects the call once the cache is cleared
+    Memory::Write16(page_end, 0xF8FF); // bl page_end + 0x200 (second half)
+    env.cpu.ClearInstructionCache();
+    env.Run(page_end - 4, 4);
+    REQUIRE(env.cpu.GetReg(1) == 7);
+}
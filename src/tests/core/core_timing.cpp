@@ -0,0 +1,170 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "core/arm/arm_interface.h"
+#include "core/core.h"
+#include "core/core_timing.h"
+
+namespace CoreTiming {
+
+/// CPU core that only provides the down_count used by CoreTiming
+class DummyCore final : public ARM_Interface {
+public:
+    void ClearInstructionCache() override {}
+    void SetPC(u32 addr) override {}
+    u32 GetPC() const override {
+        return 0;
+    }
+    u32 GetReg(int index) const override {
+        return 0;
+    }
+    void SetReg(int index, u32 value) override {}
+    u32 GetVFPReg(int index) const override {
+        return 0;
+    }
+    void SetVFPReg(int index, u32 value) override {}
+    u32 GetVFPSystemReg(VFPSystemRegister reg) const override {
+        return 0;
+    }
+    void SetVFPSystemReg(VFPSystemRegister reg, u32 value) override {}
+    u32 GetCPSR() const override {
+        return 0;
+    }
+    void SetCPSR(u32 cpsr) override {}
+    u32 GetCP15Register(CP15Register reg) override {
+        return 0;
+    }
+    void SetCP15Register(CP15Register reg, u32 value) override {}
+    void AddTicks(u64 ticks) override {
+        down_count -= ticks;
+    }
+    void SaveContext(Core::ThreadContext& ctx) override {}
+    void LoadContext(const Core::ThreadContext& ctx) override {}
+    void PrepareReschedule() override {}
+
+protected:
+    void ExecuteInstructions(int num_instructions) override {}
+};
+
+/// Sets up CoreTiming on a dummy CPU core for the duration of a test
+class ScopedCoreTiming {
+public:
+    ScopedCoreTiming() {
+        Core::g_app_core = std::make_unique<DummyCore>();
+        Init();
+    }
+    ~ScopedCoreTiming() {
+        Shutdown();
+        Core::g_app_core.reset();
+    }
+};
+
+/// Runs the CPU until all events due within the given number of cycles have fired
+static void RunFor(s64 cycles) {
+    const u64 target = GetTicks() + cycles;
+    while (GetTicks() < target) {
+        const s64 remaining = static_cast<s64>(target - GetTicks());
+        Core::g_app_core->AddTicks(
+            std::max<s64>(std::min<s64>(Core::g_app_core->down_count, remaining), 1));
+        Advance();
+    }
+}
+
+static std::vector<u64> fired;
+
+static void RecordCallback(u64 userdata, int cycles_late) {
+    fired.push_back(userdata);
+}
+
+TEST_CASE("CoreTiming fires events in time and scheduling order", "[core][core_timing]") {
+    ScopedCoreTiming timing;
+    fired.clear();
+    int event_type = RegisterEvent("Record", RecordCallback);
+
+    ScheduleEvent(300, event_type, 3);
+    ScheduleEvent(100, event_type, 1);
+    ScheduleEvent(200, event_type, 2);
+    ScheduleEvent(200, event_type, 22);
+    ScheduleEvent_Threadsafe(150, event_type, 15);
+    ScheduleEvent(400, event_type, 4);
+
+    REQUIRE(IsScheduled(event_type));
+    REQUIRE(UnscheduleEvent(event_type, 4) == 400);
+    REQUIRE(UnscheduleEvent(event_type, 4) == 0);
+
+    RunFor(1000);
+    REQUIRE(fired == std::vector<u64>({1, 15, 2, 22, 3}));
+    REQUIRE(!IsScheduled(event_type));
+}
+
+TEST_CASE("CoreTiming removes events by type", "[core][core_timing]") {
+    ScopedCoreTiming timing;
+    fired.clear();
+    int kept_type = RegisterEvent("Kept", RecordCallback);
+    int removed_type = RegisterEvent("Removed", RecordCallback);
+
+    for (u64 i = 0; i < 10; ++i) {
+        ScheduleEvent(10 * i, i % 2 ? kept_type : removed_type, i);
+    }
+    ScheduleEvent_Threadsafe(5, removed_type, 100);
+    RemoveAllEvents(removed_type);
+
+    RunFor(1000);
+    REQUIRE(fired == std::vector<u64>({1, 3, 5, 7, 9}));
+}
+
+TEST_CASE("CoreTiming accepts events from other threads", "[core][core_timing]") {
+    ScopedCoreTiming timing;
+    fired.clear();
+    int event_type = RegisterEvent("Record", RecordCallback);
+
+    std::vector<std::thread> threads;
+    for (u64 t = 0; t < 4; ++t) {
+        threads.emplace_back([t, event_type] {
+            for (u64 i = 0; i < 100; ++i) {
+                ScheduleEvent_Threadsafe(1000, event_type, t * 100 + i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    RunFor(10000);
+    REQUIRE(fired.size() == 400);
+}
+
+static void NopCallback(u64 userdata, int cycles_late) {}
+
+TEST_CASE("CoreTiming scheduling benchmark", "[.][benchmark][core_timing]") {
+    ScopedCoreTiming timing;
+    int event_type = RegisterEvent("Nop", NopCallback);
+
+    const int num_events = 100000;
+    const auto start = std::chrono::steady_clock::now();
+
+    // Keep many timers pending while rescheduling some of them, as kernel timers do
+    for (int i = 0; i < num_events; ++i) {
+        ScheduleEvent((i * 7919LL) % 1000000, event_type, i);
+    }
+    for (int i = 0; i < num_events; i += 2) {
+        UnscheduleEvent(event_type, i);
+        ScheduleEvent((i * 104729LL) % 1000000, event_type, i);
+    }
+    RunFor(1000000);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    WARN("Scheduled, rescheduled and fired " << num_events << " events in " << elapsed.count()
+                                             << " us");
+}
+
+} // namespace CoreTiming
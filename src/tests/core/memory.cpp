@@ -0,0 +1,33 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "core/hle/kernel/process.h"
+#include "core/memory.h"
+#include "core/memory_setup.h"
+
+TEST_CASE("Memory: Unmapping one alias of FCRAM keeps the other one backed", "[core][memory]") {
+    Kernel::g_current_process = Kernel::Process::Create(Kernel::CodeSet::Create("", 0));
+
+    const u32 size = 2 * Memory::PAGE_SIZE;
+    std::vector<u8> fcram(size);
+    Memory::MapMemoryRegion(Memory::LINEAR_HEAP_VADDR, size, fcram.data());
+    Memory::MapMemoryRegion(Memory::NEW_LINEAR_HEAP_VADDR, size, fcram.data());
+
+    Memory::UnmapRegion(Memory::NEW_LINEAR_HEAP_VADDR, size);
+    REQUIRE(Memory::GetPhysicalPointer(Memory::FCRAM_PADDR) == fcram.data());
+
+    // Uncaching the page restores its pointer from the physical page table
+    Memory::RasterizerMarkRegionCached(Memory::FCRAM_PADDR, Memory::PAGE_SIZE, 1);
+    Memory::RasterizerMarkRegionCached(Memory::FCRAM_PADDR, Memory::PAGE_SIZE, -1);
+    REQUIRE(Memory::GetPointer(Memory::LINEAR_HEAP_VADDR) == fcram.data());
+
+    Memory::Write32(Memory::LINEAR_HEAP_VADDR + 4, 0x12345678);
+    REQUIRE(Memory::Read32(Memory::LINEAR_HEAP_VADDR + 4) == 0x12345678);
+    REQUIRE(fcram[4] == 0x78);
+
+    Memory::UnmapRegion(Memory::LINEAR_HEAP_VADDR, size);
+    Kernel::g_current_process = nullptr;
+}
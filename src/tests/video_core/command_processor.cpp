@@ -0,0 +1,155 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+
+#include "common/common_types.h"
+#include "video_core/command_processor.h"
+#include "video_core/pica.h"
+#include "video_core/pica_state.h"
+#include "video_core/rasterizer_interface.h"
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+namespace Pica {
+namespace CommandProcessor {
+
+/// Appends a command writing `values` to the given register, and to the following ones if grouped
+static void AddCommand(std::vector<u32>& list, u32 id, u32 mask, bool group,
+                       const std::vector<u32>& values) {
+    CommandHeader header;
+    header.hex = 0;
+    header.cmd_id.Assign(id);
+    header.parameter_mask.Assign(mask);
+    header.extra_data_length.Assign(static_cast<u32>(values.size() - 1));
+    header.group_commands.Assign(group ? 1 : 0);
+
+    list.push_back(values[0]);
+    list.push_back(header.hex);
+    list.insert(list.end(), values.begin() + 1, values.end());
+
+    // Commands are aligned to 8 bytes. Lists must not end with padding, which would be read as
+    // another command.
+    if (list.size() % 2 != 0)
+        list.push_back(0);
+}
+
+static std::vector<u32> ConsumeDirtyRegisters() {
+    std::vector<u32> dirty;
+    g_state.dirty_regs.Consume([&dirty](u32 id) { dirty.push_back(id); });
+    return dirty;
+}
+
+TEST_CASE("Grouped register writes are stored and marked dirty", "[video_core]") {
+    g_state.Reset();
+    ConsumeDirtyRegisters();
+
+    const u32 first_id = PICA_REG_INDEX(tev_stage0);
+    std::vector<u32> list;
+    AddCommand(list, first_id, 0xF, true, {0x11111111, 0x22222222, 0x33333333, 0x44444444});
+    AddCommand(list, first_id + 1, 0x3, true, {0xAAAAAAAA, 0xBBBBBBBB, 0xCCCCCCCC});
+    ProcessCommandList(list.data(), static_cast<u32>(list.size() * sizeof(u32)));
+
+    REQUIRE(g_state.regs[first_id] == 0x11111111);
+    REQUIRE(g_state.regs[first_id + 1] == 0x2222AAAA);
+    REQUIRE(g_state.regs[first_id + 2] == 0x3333BBBB);
+    REQUIRE(g_state.regs[first_id + 3] == 0x4444CCCC);
+
+    const std::vector<u32> expected_dirty = {first_id, first_id + 1, first_id + 2, first_id + 3};
+    REQUIRE(ConsumeDirtyRegisters() == expected_dirty);
+    REQUIRE(ConsumeDirtyRegisters().empty());
+}
+
+TEST_CASE("Register writes with side effects run their handlers", "[video_core]") {
+    g_state.Reset();
+    ConsumeDirtyRegisters();
+
+    // A grouped write spanning the program offset and the first program word can't be stored
+    // directly, and repeated writes to a program word each upload an instruction
+    const u32 offset_id = PICA_REG_INDEX_WORKAROUND(vs.program.offset, 0x2cb);
+    const u32 word_id = PICA_REG_INDEX_WORKAROUND(vs.program.set_word[0], 0x2cc);
+    std::vector<u32> list;
+    AddCommand(list, offset_id, 0xF, true, {5, 0x12345678});
+    AddCommand(list, word_id, 0xF, false, {0x23456789, 0x3456789A, 0x456789AB});
+    ProcessCommandList(list.data(), static_cast<u32>(list.size() * sizeof(u32)));
+
+    REQUIRE(g_state.vs.program_code[5] == 0x12345678);
+    REQUIRE(g_state.vs.program_code[6] == 0x23456789);
+    REQUIRE(g_state.vs.program_code[7] == 0x3456789A);
+    REQUIRE(g_state.vs.program_code[8] == 0x456789AB);
+    REQUIRE(g_state.regs.vs.program.offset == 9);
+
+    const std::vector<u32> expected_dirty = {offset_id, word_id};
+    REQUIRE(ConsumeDirtyRegisters() == expected_dirty);
+}
+
+/// Rasterizer recording the TEV stage 0 configuration at the time queued triangles are flushed
+class TestRasterizer final : public VideoCore::RasterizerInterface {
+public:
+    void AddTriangle(const Shader::OutputVertex&, const Shader::OutputVertex&,
+                     const Shader::OutputVertex&) override {
+        ++num_triangles;
+    }
+    void DrawTriangles() override {}
+    void NotifyPicaRegistersChanging() override {
+        flushed_sources.push_back(g_state.regs.tev_stage0.sources_raw);
+    }
+    void FlushAll() override {}
+    void FlushRegion(PAddr addr, u32 size) override {}
+    void FlushAndInvalidateRegion(PAddr addr, u32 size) override {}
+
+    unsigned num_triangles = 0;
+    std::vector<u32> flushed_sources;
+};
+
+class TestRenderer final : public RendererBase {
+public:
+    explicit TestRenderer(std::unique_ptr<TestRasterizer> test_rasterizer) {
+        rasterizer = std::move(test_rasterizer);
+    }
+    void SwapBuffers() override {}
+    void SetWindow(EmuWindow* window) override {}
+    bool Init() override {
+        return true;
+    }
+    void ShutDown() override {}
+};
+
+TEST_CASE("Queued triangles are flushed before registers change", "[video_core]") {
+    g_state.Reset();
+
+    auto test_rasterizer = std::make_unique<TestRasterizer>();
+    TestRasterizer& rasterizer = *test_rasterizer;
+    VideoCore::g_renderer = std::make_unique<TestRenderer>(std::move(test_rasterizer));
+
+    const u32 program_offset_id = PICA_REG_INDEX_WORKAROUND(vs.program.offset, 0x2cb);
+    const u32 program_word_id = PICA_REG_INDEX_WORKAROUND(vs.program.set_word[0], 0x2cc);
+    const u32 attribute_index_id =
+        PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.index, 0x232);
+    const u32 attribute_value_id =
+        PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[0], 0x233);
+    const u32 tev_sources_id = PICA_REG_INDEX(tev_stage0);
+    const u32 end_instruction = 0x22 << 26;
+
+    // Submit a triangle in immediate mode, using a vertex shader that only ends, then reconfigure
+    // the TEV
+    std::vector<u32> list;
+    AddCommand(list, tev_sources_id, 0xF, false, {0x111});
+    AddCommand(list, program_offset_id, 0xF, true, {0, end_instruction});
+    AddCommand(list, attribute_index_id, 0xF, false, {15});
+    AddCommand(list, attribute_value_id, 0xF, false, std::vector<u32>(3 * 3, 0));
+    AddCommand(list, tev_sources_id, 0xF, false, {0x222});
+    ProcessCommandList(list.data(), static_cast<u32>(list.size() * sizeof(u32)));
+
+    REQUIRE(rasterizer.num_triangles == 1);
+    REQUIRE(rasterizer.flushed_sources == std::vector<u32>{0x111});
+    REQUIRE(g_state.regs.tev_stage0.sources_raw == 0x222);
+
+    VideoCore::g_renderer.reset();
+}
+
+} // namespace CommandProcessor
+} // namespace Pica
@@ -0,0 +1,102 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include <catch.hpp>
+
+#include "common/common_types.h"
+#include "video_core/morton.h"
+#include "video_core/utils.h"
+
+namespace VideoCore {
+
+// Per-texel conversion, as done before the tile-based routines existed
+static void ReferenceCopy(bool morton_to_linear, u32 bytes_per_pixel, u32 width, u32 height,
+                          u8* morton_data, u8* linear_data, bool flip) {
+    for (u32 y = 0; y < height; ++y) {
+        for (u32 x = 0; x < width; ++x) {
+            const u32 coarse_y = y & ~7;
+            u8* morton_pixel = morton_data + GetMortonOffset(x, y, bytes_per_pixel) +
+                               coarse_y * width * bytes_per_pixel;
+            u8* linear_pixel =
+                linear_data + ((flip ? height - 1 - y : y) * width + x) * bytes_per_pixel;
+
+            if (morton_to_linear) {
+                std::memcpy(linear_pixel, morton_pixel, bytes_per_pixel);
+            } else {
+                std::memcpy(morton_pixel, linear_pixel, bytes_per_pixel);
+            }
+        }
+    }
+}
+
+static std::vector<u8> MakePattern(size_t size) {
+    std::vector<u8> data(size);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<u8>(i * 7 + (i >> 8));
+    return data;
+}
+
+static void CheckSurface(u32 bytes_per_pixel, u32 width, u32 height, bool flip) {
+    const size_t size = width * height * bytes_per_pixel;
+    const s32 stride = width * bytes_per_pixel;
+    const std::vector<u8> source = MakePattern(size);
+
+    std::vector<u8> tiled = source;
+    std::vector<u8> expected(size), actual(size);
+    ReferenceCopy(true, bytes_per_pixel, width, height, tiled.data(), expected.data(), flip);
+    MortonCopySurface(true, bytes_per_pixel, width, height, tiled.data(), stride,
+                      flip ? actual.data() + (height - 1) * stride : actual.data(),
+                      flip ? -stride : stride);
+    REQUIRE(actual == expected);
+
+    std::vector<u8> linear = source;
+    std::vector<u8> expected_tiled(size), actual_tiled(size);
+    ReferenceCopy(false, bytes_per_pixel, width, height, expected_tiled.data(), linear.data(),
+                  flip);
+    MortonCopySurface(false, bytes_per_pixel, width, height, actual_tiled.data(), stride,
+                      flip ? linear.data() + (height - 1) * stride : linear.data(),
+                      flip ? -stride : stride);
+    REQUIRE(actual_tiled == expected_tiled);
+}
+
+TEST_CASE("MortonCopySurface matches per-texel conversion", "[video_core]") {
+    for (u32 bytes_per_pixel = 1; bytes_per_pixel <= 4; ++bytes_per_pixel) {
+        CheckSurface(bytes_per_pixel, 8, 8, false);
+        CheckSurface(bytes_per_pixel, 64, 24, false);
+        CheckSurface(bytes_per_pixel, 64, 24, true);
+    }
+}
+
+// Throughput benchmark, run explicitly with `tests [benchmark]`
+TEST_CASE("MortonCopySurface throughput", "[.][benchmark]") {
+    const u32 width = 1024;
+    const u32 height = 1024;
+    const int iterations = 64;
+
+    for (u32 bytes_per_pixel = 1; bytes_per_pixel <= 4; ++bytes_per_pixel) {
+        const s32 stride = width * bytes_per_pixel;
+        std::vector<u8> tiled = MakePattern(width * height * bytes_per_pixel);
+        std::vector<u8> linear(tiled.size());
+
+        for (bool morton_to_linear : {true, false}) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                MortonCopySurface(morton_to_linear, bytes_per_pixel, width, height, tiled.data(),
+                                  stride, linear.data(), stride);
+            }
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+
+            const double megabytes = tiled.size() * iterations / (1024.0 * 1024.0);
+            WARN(bytes_per_pixel << " bytes per pixel, "
+                                 << (morton_to_linear ? "untiling" : "tiling") << ": "
+                                 << megabytes / elapsed.count() << " MiB/s");
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,135 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <random>
+#include <vector>
+#include <catch.hpp>
+
+#include "common/vector_math.h"
+#include "video_core/rasterizer.h"
+
+namespace Pica {
+namespace Rasterizer {
+
+// Per-pixel evaluation of the edge functions, as done by the original rasterization loop
+static int SignedArea(const Math::Vec2<int>& vtx1, const Math::Vec2<int>& vtx2,
+                      const Math::Vec2<int>& vtx3) {
+    const auto vec1 = Math::MakeVec(vtx2 - vtx1, 0);
+    const auto vec2 = Math::MakeVec(vtx3 - vtx1, 0);
+    return Math::Cross(vec1, vec2).z;
+}
+
+static void CheckBlock(const std::array<Math::Vec2<int>, 3>& vtxpos, const std::array<int, 3>& bias,
+                       u16 min_x, u16 min_y, u16 max_x, u16 max_y) {
+    BlockCoverage coverage;
+    const bool any_covered =
+        ComputeBlockCoverage(vtxpos, bias, min_x, min_y, max_x, max_y, coverage);
+
+    bool expected_any_covered = false;
+    for (u16 y = min_y + 8; y < max_y; y += 0x10) {
+        for (u16 x = min_x + 8; x < max_x; x += 0x10) {
+            const int row = (y - min_y) >> 4;
+            const int column = (x - min_x) >> 4;
+
+            int w0 = bias[0] + SignedArea(vtxpos[1], vtxpos[2], {x, y});
+            int w1 = bias[1] + SignedArea(vtxpos[2], vtxpos[0], {x, y});
+            int w2 = bias[2] + SignedArea(vtxpos[0], vtxpos[1], {x, y});
+            const bool covered = w0 >= 0 && w1 >= 0 && w2 >= 0;
+            expected_any_covered |= covered;
+
+            if (!any_covered)
+                continue;
+
+            REQUIRE(((coverage.row_mask[row] >> column) & 1) == covered);
+            if (covered) {
+                REQUIRE(coverage.w[0][row][column] == w0);
+                REQUIRE(coverage.w[1][row][column] == w1);
+                REQUIRE(coverage.w[2][row][column] == w2);
+            }
+        }
+    }
+    REQUIRE(any_covered == expected_any_covered);
+}
+
+TEST_CASE("ComputeBlockCoverage matches per-pixel evaluation", "[video_core][rasterizer]") {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> coord(0, 64 * 16);
+    std::uniform_int_distribution<int> bias_dist(-1, 0);
+    std::uniform_int_distribution<int> block_pos(0, 64 / TILE_SIZE - 1);
+    std::uniform_int_distribution<int> block_size(1, TILE_SIZE);
+
+    for (int i = 0; i < 2000; ++i) {
+        std::array<Math::Vec2<int>, 3> vtxpos;
+        for (auto& vtx : vtxpos) {
+            vtx = Math::MakeVec(coord(rng), coord(rng));
+        }
+        // The rasterizer only ever sees counter-clockwise triangles
+        if (SignedArea(vtxpos[0], vtxpos[1], vtxpos[2]) <= 0)
+            std::swap(vtxpos[1], vtxpos[2]);
+
+        const std::array<int, 3> bias = {bias_dist(rng), bias_dist(rng), bias_dist(rng)};
+
+        for (int block = 0; block < 16; ++block) {
+            const u16 min_x = static_cast<u16>(block_pos(rng) * TILE_SIZE * 16);
+            const u16 min_y = static_cast<u16>(block_pos(rng) * TILE_SIZE * 16);
+            const u16 max_x = static_cast<u16>(min_x + block_size(rng) * 16);
+            const u16 max_y = static_cast<u16>(min_y + block_size(rng) * 16);
+            CheckBlock(vtxpos, bias, min_x, min_y, max_x, max_y);
+        }
+    }
+}
+
+TEST_CASE("ComputeBlockCoverage trivial accept and reject", "[video_core][rasterizer]") {
+    // A triangle covering the whole first tile and nothing of the second one
+    const std::array<Math::Vec2<int>, 3> vtxpos = {
+        {Math::MakeVec(0, 0), Math::MakeVec(8 * 16 * 3, 0), Math::MakeVec(0, 8 * 16 * 3)}};
+    const std::array<int, 3> bias = {0, 0, 0};
+
+    BlockCoverage coverage;
+    REQUIRE(ComputeBlockCoverage(vtxpos, bias, 0, 0, 8 * 16, 8 * 16, coverage));
+    for (u8 mask : coverage.row_mask) {
+        REQUIRE(mask == 0xFF);
+    }
+    CheckBlock(vtxpos, bias, 0, 0, 8 * 16, 8 * 16);
+
+    REQUIRE(!ComputeBlockCoverage(vtxpos, bias, 8 * 16 * 3, 8 * 16 * 3, 8 * 16 * 4, 8 * 16 * 4,
+                                  coverage));
+    CheckBlock(vtxpos, bias, 8 * 16 * 3, 8 * 16 * 3, 8 * 16 * 4, 8 * 16 * 4);
+}
+
+TEST_CASE("GetTileBounds covers each framebuffer pixel once", "[video_core][rasterizer]") {
+    for (int width : {8, 20, 240}) {
+        for (int last_row : {7, 12, 399}) {
+            const int tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+            const int tiles_y = last_row / TILE_SIZE + 1;
+            std::vector<int> covered(width * (last_row + 1), 0);
+
+            for (int tile_y = 0; tile_y < tiles_y; ++tile_y) {
+                for (int tile_x = 0; tile_x < tiles_x; ++tile_x) {
+                    const TileBounds bounds = GetTileBounds(tile_x, tile_y, width, last_row);
+                    REQUIRE(bounds.min_x < bounds.max_x);
+                    REQUIRE(bounds.min_y < bounds.max_y);
+
+                    for (int y = bounds.min_y >> 4; y < bounds.max_y >> 4; ++y) {
+                        // Memory row written by DrawPixel, which must be in this tile's block
+                        const int row = last_row - y;
+                        REQUIRE(row >= 0);
+                        REQUIRE(row / TILE_SIZE == tile_y);
+
+                        for (int x = bounds.min_x >> 4; x < bounds.max_x >> 4; ++x) {
+                            REQUIRE(x < width);
+                            REQUIRE(x / TILE_SIZE == tile_x);
+                            ++covered[row * width + x];
+                        }
+                    }
+                }
+            }
+            REQUIRE(std::vector<int>(width * (last_row + 1), 1) == covered);
+        }
+    }
+}
+
+} // namespace Rasterizer
+} // namespace Pica
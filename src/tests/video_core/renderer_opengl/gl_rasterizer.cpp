@@ -0,0 +1,53 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <vector>
+#include <catch.hpp>
+#include "common/file_util.h"
+#include "common/linear_disk_cache.h"
+#include "video_core/renderer_opengl/gl_rasterizer.h"
+
+static PicaShaderConfig MakeConfig(u8 fill) {
+    PicaShaderConfig config;
+    std::memset(&config.state, fill, sizeof(PicaShaderConfig::State));
+    return config;
+}
+
+TEST_CASE("ShaderDiskCacheReader reads back the configs written", "[video_core]") {
+    const std::string filename = "./shader_disk_cache_test.bin";
+    FileUtil::Delete(filename);
+
+    const std::vector<PicaShaderConfig> configs{MakeConfig(1), MakeConfig(2), MakeConfig(3)};
+
+    {
+        LinearDiskCache<u64, u8> cache;
+        ShaderDiskCacheReader reader;
+        REQUIRE(cache.OpenAndRead(filename.c_str(), reader) == 0);
+        for (const PicaShaderConfig& config : configs) {
+            AppendShaderDiskCacheEntry(cache, config);
+        }
+
+        // A repeated config, an entry of the wrong size and one whose key doesn't match its config
+        AppendShaderDiskCacheEntry(cache, configs[1]);
+        const u8 short_value[4] = {};
+        cache.Append(1, short_value, sizeof(short_value));
+        const PicaShaderConfig stale = MakeConfig(4);
+        cache.Append(2, reinterpret_cast<const u8*>(&stale.state), sizeof(stale.state));
+        cache.Close();
+    }
+
+    LinearDiskCache<u64, u8> cache;
+    ShaderDiskCacheReader reader;
+    REQUIRE(cache.OpenAndRead(filename.c_str(), reader) == 6);
+    cache.Close();
+
+    REQUIRE(reader.num_skipped == 3);
+    REQUIRE(reader.configs.size() == configs.size());
+    for (size_t i = 0; i < configs.size(); ++i) {
+        REQUIRE(reader.configs[i] == configs[i]);
+    }
+
+    FileUtil::Delete(filename);
+}
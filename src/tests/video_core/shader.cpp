@@ -0,0 +1,307 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <catch.hpp>
+#include <nihstro/shader_bytecode.h>
+
+#include "common/common_types.h"
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_interpreter.h"
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/shader/shader_jit_x64.h"
+#endif
+
+using nihstro::OpCode;
+
+namespace Pica {
+namespace Shader {
+
+// Register encodings used in instructions
+static constexpr u32 V(u32 index) {
+    return index; // input
+}
+static constexpr u32 O(u32 index) {
+    return index; // output
+}
+static constexpr u32 R(u32 index) {
+    return 0x10 + index; // temporary
+}
+static constexpr u32 C(u32 index) {
+    return 0x20 + index; // float uniform
+}
+
+static u32 Arithmetic(OpCode::Id opcode, u32 dest, u32 src1, u32 src2, u32 operand_desc_id,
+                      u32 address_register_index = 0) {
+    return (static_cast<u32>(opcode) << 26) | (dest << 21) | (address_register_index << 19) |
+           (src1 << 12) | (src2 << 7) | operand_desc_id;
+}
+
+static u32 Compare(u32 src1, u32 src2, u32 compare_x, u32 compare_y, u32 operand_desc_id) {
+    return (static_cast<u32>(OpCode::Id::CMP) << 26) | (compare_x << 24) | (compare_y << 21) |
+           (src1 << 12) | (src2 << 7) | operand_desc_id;
+}
+
+static u32 MultiplyAdd(u32 dest, u32 src1, u32 src2, u32 src3, u32 operand_desc_id) {
+    return (static_cast<u32>(OpCode::Id::MAD) << 26) | (dest << 24) | (src1 << 17) |
+           (src2 << 10) | (src3 << 5) | operand_desc_id;
+}
+
+static u32 FlowControl(OpCode::Id opcode, u32 dest_offset, u32 num_instructions,
+                       u32 condition_bits = 0) {
+    return (static_cast<u32>(opcode) << 26) | (condition_bits << 22) | (dest_offset << 10) |
+           num_instructions;
+}
+
+static u32 Swizzle(u32 dest_mask, u32 src1, u32 src2 = 0x1B, u32 src3 = 0x1B, bool negate1 = false,
+                   bool negate2 = false, bool negate3 = false) {
+    return dest_mask | (negate1 << 4) | (src1 << 5) | (negate2 << 13) | (src2 << 14) |
+           (negate3 << 22) | (src3 << 23);
+}
+
+// Raw source selectors, with the selector of the first component in the highest bits
+static constexpr u32 XYZW = 0x1B;
+static constexpr u32 YXWZ = 0x4E;
+static constexpr u32 WZYX = 0xE4;
+static constexpr u32 XXXX = 0x00;
+static constexpr u32 ZWXY = 0xB1;
+
+static void SetupUniforms(ShaderSetup& setup) {
+    for (unsigned i = 0; i < 8; ++i) {
+        setup.uniforms.f[i] = Math::MakeVec(float24::FromFloat32(0.5f * i - 1.0f),
+                                            float24::FromFloat32(1.5f - 0.25f * i),
+                                            float24::FromFloat32(0.125f * i * i),
+                                            float24::FromFloat32(2.0f + i));
+    }
+    setup.uniforms.f[6] = Math::MakeVec(float24::FromFloat32(1.0f), float24::FromFloat32(2.0f),
+                                        float24::Zero(), float24::Zero());
+    setup.uniforms.i[0] = Math::MakeVec<u8>(3, 0, 1, 0);
+}
+
+/// Builds a program touching every instruction the interpreter handles
+static void SetupTestProgram(ShaderSetup& setup) {
+    setup.swizzle_data[0] = Swizzle(0xF, XYZW);
+    setup.swizzle_data[1] = Swizzle(0xA, YXWZ, WZYX, XYZW, true);
+    setup.swizzle_data[2] = Swizzle(0xF, XXXX, XYZW, ZWXY, false, false, true);
+    setup.swizzle_data[3] = Swizzle(0xC, XYZW);
+
+    const std::vector<u32> program = {
+        /* 0 */ Arithmetic(OpCode::Id::MUL, R(0), V(0), C(0), 0),
+        /* 1 */ Arithmetic(OpCode::Id::ADD, O(0), V(1), C(1), 1),
+        /* 2 */ MultiplyAdd(R(1), V(0), C(2), R(0), 2),
+        /* 3 */ Arithmetic(OpCode::Id::DP4, O(1), R(1), C(3), 0),
+        /* 4 */ Arithmetic(OpCode::Id::DP3, R(2), V(1), R(0), 0),
+        /* 5 */ Arithmetic(OpCode::Id::DPH, R(3), V(0), C(3), 0),
+        /* 6 */ Arithmetic(OpCode::Id::RCP, R(4), R(2), 0, 0),
+        /* 7 */ Arithmetic(OpCode::Id::RSQ, R(5), C(4), 0, 0),
+        /* 8 */ Arithmetic(OpCode::Id::EX2, R(6), V(1), 0, 0),
+        /* 9 */ Arithmetic(OpCode::Id::LG2, R(7), C(4), 0, 0),
+        /* 10 */ Arithmetic(OpCode::Id::MAX, O(2), R(4), R(5), 0),
+        /* 11 */ Arithmetic(OpCode::Id::MIN, O(3), R(6), R(7), 0),
+        /* 12 */ Arithmetic(OpCode::Id::SGE, R(8), V(0), V(1), 0),
+        /* 13 */ Arithmetic(OpCode::Id::SLT, R(9), V(0), V(1), 0),
+        /* 14 */ Arithmetic(OpCode::Id::FLR, O(4), C(5), 0, 0),
+        /* 15 */ Arithmetic(OpCode::Id::MOVA, 0, C(6), 0, 3),
+        /* 16 */ Arithmetic(OpCode::Id::MOV, O(5), C(0), 0, 0, 1),
+        /* 17 */ Compare(V(0), V(1), 2 /* LessThan */, 5 /* GreaterEqual */, 3),
+        // if (cmp.x == 1 && cmp.y == 0) { o6 = v0 + c1 } else { o6 = v0 * c1 }
+        /* 18 */ FlowControl(OpCode::Id::IFC, 20, 1, (1 << 3) | (0 << 2) | 1),
+        /* 19 */ Arithmetic(OpCode::Id::ADD, O(6), V(0), C(1), 0),
+        /* 20 */ Arithmetic(OpCode::Id::MUL, O(6), V(0), C(1), 0),
+        // Sum c[aL] into r10 for each iteration of the loop configured by i0
+        /* 21 */ Arithmetic(OpCode::Id::MOV, R(10), C(7), 0, 0),
+        /* 22 */ FlowControl(OpCode::Id::LOOP, 23, 0),
+        /* 23 */ Arithmetic(OpCode::Id::ADD, R(10), R(10), C(0), 0, 3),
+        /* 24 */ Arithmetic(OpCode::Id::MOV, O(7), R(10), 0, 0),
+        /* 25 */ FlowControl(OpCode::Id::CALLU, 34, 1, 0),
+        // Skip the next instruction if b1 is set
+        /* 26 */ FlowControl(OpCode::Id::JMPU, 28, 0, 1),
+        /* 27 */ Arithmetic(OpCode::Id::MOV, O(9), C(0), 0, 0),
+        /* 28 */ Arithmetic(OpCode::Id::MOV, O(10), R(8), 0, 0),
+        /* 29 */ Arithmetic(OpCode::Id::MOV, O(11), R(9), 0, 0),
+        /* 30 */ Arithmetic(OpCode::Id::MOV, O(12), R(3), 0, 0),
+        /* 31 */ Arithmetic(OpCode::Id::MOV, O(13), R(2), 0, 0),
+        /* 32 */ FlowControl(OpCode::Id::NOP, 0, 0),
+        /* 33 */ FlowControl(OpCode::Id::END, 0, 0),
+        /* 34 */ Arithmetic(OpCode::Id::MOV, O(8), C(7), 0, 0),
+    };
+    std::copy(program.begin(), program.end(), setup.program_code.begin());
+    SetupUniforms(setup);
+}
+
+static void SetupInputs(UnitState<false>& state, unsigned vertex) {
+    for (unsigned i = 0; i < 16; ++i) {
+        const float base = static_cast<float>(vertex * 16 + i);
+        state.registers.input[i] = Math::MakeVec(
+            float24::FromFloat32(base * 0.1f - 3.0f), float24::FromFloat32(1.0f - base * 0.05f),
+            float24::FromFloat32(base * 0.3f), float24::FromFloat32(-base * 0.2f));
+    }
+    state.conditional_code[0] = false;
+    state.conditional_code[1] = false;
+}
+
+TEST_CASE("Decoded shader programs match the interpreter", "[video_core][shader]") {
+    auto setup = std::make_unique<ShaderSetup>();
+    SetupTestProgram(*setup);
+    const auto program = CompileInterpreterProgram(*setup);
+
+    for (unsigned uniforms = 0; uniforms < 4; ++uniforms) {
+        setup->uniforms.b[0] = (uniforms & 1) != 0;
+        setup->uniforms.b[1] = (uniforms & 2) != 0;
+
+        auto expected = std::make_unique<UnitState<false>>();
+        auto actual = std::make_unique<UnitState<false>>();
+        for (unsigned vertex = 0; vertex < 8; ++vertex) {
+            SetupInputs(*expected, vertex);
+            RunInterpreter(*setup, *expected, 0);
+
+            SetupInputs(*actual, vertex);
+            RunInterpreter(*setup, *program, *actual, 0);
+
+            REQUIRE(std::memcmp(&actual->output_registers, &expected->output_registers,
+                                sizeof(OutputRegisters)) == 0);
+            REQUIRE(std::memcmp(&actual->registers, &expected->registers,
+                                sizeof(actual->registers)) == 0);
+            REQUIRE(std::memcmp(actual->address_registers, expected->address_registers,
+                                sizeof(actual->address_registers)) == 0);
+            REQUIRE(actual->conditional_code[0] == expected->conditional_code[0]);
+            REQUIRE(actual->conditional_code[1] == expected->conditional_code[1]);
+        }
+    }
+}
+
+// Interpreter throughput benchmark, run explicitly with `tests [benchmark]`
+TEST_CASE("Shader interpreter throughput", "[.][benchmark]") {
+    constexpr unsigned num_vertices = 100000;
+
+    auto setup = std::make_unique<ShaderSetup>();
+    SetupTestProgram(*setup);
+    const auto program = CompileInterpreterProgram(*setup);
+    auto state = std::make_unique<UnitState<false>>();
+
+    for (bool decoded : {false, true}) {
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned vertex = 0; vertex < num_vertices; ++vertex) {
+            SetupInputs(*state, vertex % 8);
+            if (decoded) {
+                RunInterpreter(*setup, *program, *state, 0);
+            } else {
+                RunInterpreter(*setup, *state, 0);
+            }
+        }
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        WARN((decoded ? "Decoded program: " : "Interpreter: ") << elapsed.count() / num_vertices
+                                                                << " ns per vertex");
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+/// Builds a program running straight to an END, with every instruction the SoA program handles
+static void SetupStraightProgram(ShaderSetup& setup) {
+    setup.swizzle_data[0] = Swizzle(0xF, XYZW);
+    setup.swizzle_data[1] = Swizzle(0xA, YXWZ, WZYX, XYZW, true);
+    setup.swizzle_data[2] = Swizzle(0xF, XXXX, XYZW, ZWXY, false, false, true);
+    setup.swizzle_data[3] = Swizzle(0xC, XYZW);
+    setup.swizzle_data[4] = Swizzle(0x7, ZWXY, YXWZ, XYZW, false, true);
+
+    const std::vector<u32> program = {
+        /* 0 */ Arithmetic(OpCode::Id::MUL, R(0), C(0), V(0), 0),
+        // Reads components of its destination register
+        /* 1 */ Arithmetic(OpCode::Id::ADD, R(0), R(0), V(1), 1),
+        /* 2 */ MultiplyAdd(R(1), V(0), C(2), R(0), 2),
+        /* 3 */ Arithmetic(OpCode::Id::DP4, O(0), C(3), R(1), 0),
+        /* 4 */ Arithmetic(OpCode::Id::DP3, O(1), V(1), R(0), 3),
+        /* 5 */ Arithmetic(OpCode::Id::DPH, O(2), C(3), V(0), 4),
+        /* 6 */ Arithmetic(OpCode::Id::RCP, R(2), V(2), 0, 0),
+        /* 7 */ Arithmetic(OpCode::Id::RSQ, R(3), C(4), 0, 0),
+        /* 8 */ Arithmetic(OpCode::Id::MAX, O(3), R(2), R(3), 2),
+        /* 9 */ Arithmetic(OpCode::Id::MIN, O(4), C(1), V(3), 4),
+        /* 10 */ Arithmetic(OpCode::Id::SGE, O(5), V(0), V(1), 0),
+        /* 11 */ Arithmetic(OpCode::Id::SLT, O(6), V(0), V(1), 1),
+        /* 12 */ Arithmetic(OpCode::Id::FLR, O(7), V(2), 0, 0),
+        /* 13 */ Arithmetic(OpCode::Id::MOV, O(8), R(1), 0, 2),
+        /* 14 */ Arithmetic(OpCode::Id::MOV, O(9), R(0), 0, 0),
+        /* 15 */ FlowControl(OpCode::Id::NOP, 0, 0),
+        /* 16 */ FlowControl(OpCode::Id::END, 0, 0),
+    };
+    std::copy(program.begin(), program.end(), setup.program_code.begin());
+    SetupUniforms(setup);
+}
+
+/// Checks that shading vertices in a batch gives the same results as shading them one at a time
+static void CheckBatch(const ShaderSetup& setup, const JitShader& shader) {
+    constexpr unsigned num_vertices = 2 * SOA_WIDTH + 2;
+
+    auto expected = std::make_unique<UnitState<false>>();
+    auto actual = std::make_unique<UnitState<false>>();
+    std::vector<InputVertex> inputs(num_vertices);
+    std::vector<OutputRegisters> expected_outputs(num_vertices);
+    std::vector<OutputRegisters> actual_outputs(num_vertices);
+
+    for (unsigned i = 0; i < 16; ++i) {
+        expected->registers.temporary[i] = Math::MakeVec(
+            float24::FromFloat32(1.0f * i), float24::FromFloat32(2.0f * i),
+            float24::FromFloat32(3.0f * i), float24::FromFloat32(4.0f * i));
+        expected->output_registers.value[i] = expected->registers.temporary[i];
+    }
+    std::memcpy(actual.get(), expected.get(), sizeof(UnitState<false>));
+
+    for (unsigned vertex = 0; vertex < num_vertices; ++vertex) {
+        SetupInputs(*expected, vertex);
+        std::copy_n(expected->registers.input, 16, inputs[vertex].attr);
+        shader.Run(setup, *expected, 0);
+        expected_outputs[vertex] = expected->output_registers;
+    }
+
+    shader.RunBatch(setup, *actual, 0, inputs.data(), actual_outputs.data(), num_vertices);
+
+    REQUIRE(std::memcmp(actual_outputs.data(), expected_outputs.data(),
+                        num_vertices * sizeof(OutputRegisters)) == 0);
+    REQUIRE(std::memcmp(&actual->output_registers, &expected->output_registers,
+                        sizeof(OutputRegisters)) == 0);
+    REQUIRE(std::memcmp(&actual->registers, &expected->registers, sizeof(actual->registers)) == 0);
+}
+
+TEST_CASE("Batched JIT shaders use the SoA program for straight programs", "[video_core][shader]") {
+    auto setup = std::make_unique<ShaderSetup>();
+    SetupStraightProgram(*setup);
+    JitShader shader;
+    shader.Compile(*setup);
+
+    REQUIRE(shader.HasSoAProgram(0));
+    CheckBatch(*setup, shader);
+}
+
+TEST_CASE("Batched JIT shaders carry temporary registers over", "[video_core][shader]") {
+    auto setup = std::make_unique<ShaderSetup>();
+    SetupStraightProgram(*setup);
+    // Reads the temporary register left by the previous vertex
+    setup->program_code[0] = Arithmetic(OpCode::Id::ADD, R(0), C(0), R(0), 0);
+    JitShader shader;
+    shader.Compile(*setup);
+
+    REQUIRE(!shader.HasSoAProgram(0));
+    CheckBatch(*setup, shader);
+}
+
+TEST_CASE("Batched JIT shaders fall back to the scalar program", "[video_core][shader]") {
+    auto setup = std::make_unique<ShaderSetup>();
+    SetupTestProgram(*setup);
+    setup->uniforms.b[0] = true;
+    JitShader shader;
+    shader.Compile(*setup);
+
+    REQUIRE(!shader.HasSoAProgram(0));
+    CheckBatch(*setup, shader);
+}
+#endif // ARCHITECTURE_x86_64
+
+} // namespace Shader
+} // namespace Pica
@@ -0,0 +1,87 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <vector>
+#include <catch.hpp>
+#include "core/memory.h"
+#include "core/memory_setup.h"
+#include "video_core/debug_utils/debug_utils.h"
+#include "video_core/pica.h"
+#include "video_core/texture_cache.h"
+
+namespace Pica {
+
+static Regs::TextureConfig MakeConfig(PAddr address, u32 width, u32 height) {
+    Regs::TextureConfig config{};
+    config.address = address / 8;
+    config.width.Assign(width);
+    config.height.Assign(height);
+    return config;
+}
+
+static void CheckTexels(const DecodedTexture& texture, const Regs::TextureConfig& config) {
+    const auto info = DebugUtils::TextureInfo::FromPicaRegister(config, texture.format);
+    const u8* data = Memory::GetPhysicalPointer(info.physical_address);
+    for (int t = 0; t < info.height; ++t) {
+        for (int s = 0; s < info.width; ++s) {
+            const auto expected = DebugUtils::LookupTexture(data, s, t, info);
+            const auto& texel = texture.Lookup(s, t);
+            REQUIRE(texel.r() == expected.r());
+            REQUIRE(texel.g() == expected.g());
+            REQUIRE(texel.b() == expected.b());
+            REQUIRE(texel.a() == expected.a());
+        }
+    }
+}
+
+TEST_CASE("TextureCache: InvalidateRegion evicts overlapping textures", "[video_core]") {
+    std::vector<u8> vram(Memory::VRAM_SIZE);
+    for (size_t i = 0; i < 0x200; ++i) {
+        vram[i] = static_cast<u8>(i);
+    }
+    Memory::MapMemoryRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE, vram.data());
+
+    const auto format = Regs::TextureFormat::RGBA8;
+    const auto config = MakeConfig(Memory::VRAM_PADDR, 8, 8);
+    TextureCache cache;
+
+    const auto texture = cache.GetTexture(config, format);
+    REQUIRE(texture != nullptr);
+    CheckTexels(*texture, config);
+    const u64 generation = cache.GetGeneration();
+
+    // Writes are only noticed once they are reported
+    vram[0x10] = 0xFF;
+    REQUIRE(cache.GetTexture(config, format) == texture);
+
+    // Regions next to the texture leave it alone
+    cache.InvalidateRegion(Memory::VRAM_PADDR + 8 * 8 * 4, 0x100);
+    REQUIRE(cache.GetGeneration() == generation);
+    REQUIRE(cache.GetTexture(config, format) == texture);
+
+    cache.InvalidateRegion(Memory::VRAM_PADDR + 0x10, 1);
+    REQUIRE(cache.GetGeneration() != generation);
+    const auto updated = cache.GetTexture(config, format);
+    REQUIRE(updated != nullptr);
+    REQUIRE(updated != texture);
+    CheckTexels(*updated, config);
+
+    Memory::UnmapRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE);
+}
+
+TEST_CASE("TextureCache: Textures running past the end of memory are rejected", "[video_core]") {
+    std::vector<u8> vram(Memory::VRAM_SIZE);
+    Memory::MapMemoryRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE, vram.data());
+
+    TextureCache cache;
+    const auto format = Regs::TextureFormat::RGBA8;
+    REQUIRE(cache.GetTexture(MakeConfig(Memory::VRAM_PADDR_END - 8 * 8 * 4, 8, 8), format) !=
+            nullptr);
+    REQUIRE(cache.GetTexture(MakeConfig(Memory::VRAM_PADDR_END - 8 * 8 * 2, 8, 8), format) ==
+            nullptr);
+
+    Memory::UnmapRegion(Memory::VRAM_VADDR, Memory::VRAM_SIZE);
+}
+
+} // namespace Pica
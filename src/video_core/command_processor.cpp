@@ -2,13 +2,18 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 #include <utility>
+#include <vector>
 #include "common/assert.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/hle/service/gsp_gpu.h"
 #include "core/hw/gpu.h"
@@ -42,213 +47,362 @@ static const u32 expand_bits_to_bytes[] = {
 
 MICROPROFILE_DEFINE(GPU_Drawing, "GPU", "Drawing", MP_RGB(50, 50, 240));
 
-static void WritePicaReg(u32 id, u32 value, u32 mask) {
-    auto& regs = g_state.regs;
+/**
+ * Direct-mapped post-transform vertex cache for indexed draws, keyed on the vertex index.
+ *
+ * Each entry records a hash of the vertex shader state (program, swizzles, uniforms and shader
+ * configuration) it was shaded with, and is only used while that state is current. Writes to
+ * those registers merely mark the hash as outdated, and it is recomputed at the next draw, so
+ * games that upload the same uniforms before every draw keep hitting the cache. Invalidate()
+ * bumps the generation and thereby drops all entries. Within a draw call an entry is trusted as
+ * is. An entry carried over from a previous draw is only reused if the freshly loaded input
+ * attributes match the ones it was shaded with, so vertex buffers rewritten by the CPU or a
+ * changed attribute layout never produce stale results.
+ */
+struct VertexCache {
+    // Must be a power of two
+    static constexpr size_t SIZE = 512;
+
+    struct Entry {
+        u32 vertex;
+        u32 generation;
+        u32 draw_id;
+        u64 shader_key;
+        Shader::InputVertex input;
+        Shader::OutputRegisters output;
+    };
+
+    std::array<Entry, SIZE> entries;
+    u32 generation = 1;
+    u32 draw_id = 0;
+
+    /// Hash of the current vertex shader state, and of its program and swizzle data
+    u64 shader_key = 0;
+    u64 program_key = 0;
+    /// Set when a write may have changed the shader state, or its program and swizzle data
+    bool shader_dirty = true;
+    bool program_dirty = true;
+
+    Entry& Get(u32 vertex) {
+        return entries[vertex & (SIZE - 1)];
+    }
 
-    if (id >= regs.NumIds())
-        return;
+    bool IsValid(const Entry& entry, u32 vertex) const {
+        return entry.vertex == vertex && entry.generation == generation &&
+               entry.shader_key == shader_key;
+    }
 
-    // If we're skipping this frame, only allow trigger IRQ
-    if (GPU::g_skip_frame && id != PICA_REG_INDEX(trigger_irq))
-        return;
+    void Invalidate() {
+        ++generation;
+        if (generation == 0) {
+            // Make sure stale entries can never alias a future generation after wrap-around
+            for (auto& entry : entries)
+                entry.generation = 0;
+            generation = 1;
+        }
+    }
 
-    // TODO: Figure out how register masking acts on e.g. vs.uniform_setup.set_value
-    u32 old_value = regs[id];
+    void BeginDraw() {
+        ++draw_id;
+        if (draw_id == 0) {
+            for (auto& entry : entries)
+                entry.draw_id = 0;
+            draw_id = 1;
+        }
 
-    const u32 write_mask = expand_bits_to_bytes[mask];
+        const auto& setup = g_state.vs;
+        if (program_dirty) {
+            program_key = Common::ComputeHash64(&setup.program_code, sizeof(setup.program_code)) ^
+                          Common::ComputeHash64(&setup.swizzle_data, sizeof(setup.swizzle_data));
+        }
+        if (shader_dirty || program_dirty) {
+            const std::array<u64, 5> keys = {
+                program_key,
+                Common::ComputeHash64(&setup.uniforms.f, sizeof(setup.uniforms.f)),
+                Common::ComputeHash64(&setup.uniforms.b, sizeof(setup.uniforms.b)),
+                Common::ComputeHash64(&setup.uniforms.i, sizeof(setup.uniforms.i)),
+                Common::ComputeHash64(&g_state.regs.vs, sizeof(Regs::ShaderConfig)),
+            };
+            shader_key = Common::ComputeHash64(keys.data(), sizeof(keys));
+        }
+        shader_dirty = false;
+        program_dirty = false;
+    }
+};
 
-    regs[id] = (old_value & ~write_mask) | (value & write_mask);
+static VertexCache vertex_cache;
 
-    DebugUtils::OnPicaRegWrite({(u16)id, (u16)mask, regs[id]});
+void InvalidateVertexCache() {
+    vertex_cache.Invalidate();
+}
 
-    if (g_debug_context)
-        g_debug_context->OnEvent(DebugContext::Event::PicaCommandLoaded,
-                                 reinterpret_cast<void*>(&id));
+/// Returns true if a write to the given registers may change the output of the vertex shader
+static bool AffectsVertexShader(u32 first_id, u32 count = 1) {
+    const u32 vs_begin = PICA_REG_INDEX(vs);
+    const u32 vs_end = vs_begin + sizeof(Regs::ShaderConfig) / sizeof(u32);
+    const u32 com_mode = PICA_REG_INDEX(vs_com_mode);
+    const u32 last_id = first_id + count;
+    return (first_id < vs_end && last_id > vs_begin) ||
+           (com_mode >= first_id && com_mode < last_id);
+}
+
+/// Returns the number of threads of the shared video core pool to shade vertices on
+static size_t GetVertexShaderThreads() {
+    const size_t pool_threads = VideoCore::GetThreadPool().GetNumThreads();
+    const size_t num_threads = std::max(VideoCore::g_vertex_shader_threads.load(), 0);
+    return num_threads == 0 ? pool_threads : std::min(num_threads, pool_threads);
+}
+
+/// Copies the state carried over from one vertex to the next between shader units
+static void CopyUnitRegisters(Shader::UnitState<false>& dest, const Shader::UnitState<false>& src) {
+    dest.registers = src.registers;
+    dest.output_registers = src.output_registers;
+    std::copy(std::begin(src.conditional_code), std::end(src.conditional_code),
+              std::begin(dest.conditional_code));
+    std::copy(std::begin(src.address_registers), std::end(src.address_registers),
+              std::begin(dest.address_registers));
+}
+
+/**
+ * Runs the vertex shader on a batch of vertices split into consecutive chunks, one per worker.
+ * Each chunk is shaded on its own unit starting from the registers of the given unit, which is
+ * left with the registers of the last chunk. Registers not written by the attributes or the shader
+ * thus don't carry over across chunk boundaries like they do when shading sequentially, which the
+ * round-robin shader unit scheduling doesn't guarantee either.
+ */
+static void RunBatchParallel(Common::ThreadPool& pool, size_t num_chunks,
+                             Shader::UnitState<false>& unit, const Shader::InputVertex* inputs,
+                             Shader::OutputRegisters* outputs, unsigned int count,
+                             int num_attributes) {
+    static std::vector<std::unique_ptr<Shader::UnitState<false>>> chunk_units;
+    while (chunk_units.size() < num_chunks)
+        chunk_units.push_back(std::make_unique<Shader::UnitState<false>>());
+
+    pool.ParallelFor(num_chunks, [&](size_t chunk) {
+        const unsigned int first = static_cast<unsigned int>(count * chunk / num_chunks);
+        const unsigned int last = static_cast<unsigned int>(count * (chunk + 1) / num_chunks);
+        Shader::UnitState<false>& chunk_unit = *chunk_units[chunk];
+        CopyUnitRegisters(chunk_unit, unit);
+        g_state.vs.RunBatch(chunk_unit, inputs + first, outputs + first, last - first,
+                            num_attributes, g_state.regs.vs);
+    });
+
+    CopyUnitRegisters(unit, *chunk_units[num_chunks - 1]);
+}
+
+/// Called after a register has been written, with the value written to it
+using RegisterHandler = void (*)(u32 id, u32 value);
+
+// Set when triangles have been submitted to the rasterizer since the last register write
+static bool triangles_pending = false;
 
-    switch (id) {
-    // Trigger IRQ
-    case PICA_REG_INDEX(trigger_irq):
-        GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::P3D);
-        break;
+static void AddTriangle(const Shader::OutputVertex& v0, const Shader::OutputVertex& v1,
+                        const Shader::OutputVertex& v2) {
+    VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
+    triangles_pending = true;
+}
 
-    case PICA_REG_INDEX_WORKAROUND(triangle_topology, 0x25E):
-        g_state.primitive_assembler.Reconfigure(regs.triangle_topology);
-        break;
+static void TriggerIRQ(u32 id, u32 value) {
+    GSP_GPU::SignalInterrupt(GSP_GPU::InterruptId::P3D);
+}
 
-    case PICA_REG_INDEX_WORKAROUND(restart_primitive, 0x25F):
-        g_state.primitive_assembler.Reset();
-        break;
+static void SetTriangleTopology(u32 id, u32 value) {
+    g_state.primitive_assembler.Reconfigure(g_state.regs.triangle_topology);
+}
+
+static void RestartPrimitive(u32 id, u32 value) {
+    g_state.primitive_assembler.Reset();
+}
 
-    case PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.index, 0x232):
-        g_state.immediate.current_attribute = 0;
+static void SetDefaultAttributeIndex(u32 id, u32 value) {
+    g_state.immediate.current_attribute = 0;
+    default_attr_counter = 0;
+}
+
+// Load default vertex input attributes
+static void SetDefaultAttributeValue(u32 id, u32 value) {
+    auto& regs = g_state.regs;
+
+    // TODO: Does actual hardware indeed keep an intermediate buffer or does
+    //       it directly write the values?
+    default_attr_write_buffer[default_attr_counter++] = value;
+
+    // Default attributes are written in a packed format such that four float24 values are
+    // encoded in
+    // three 32-bit numbers. We write to internal memory once a full such vector is
+    // written.
+    if (default_attr_counter >= 3) {
         default_attr_counter = 0;
-        break;
-
-    // Load default vertex input attributes
-    case PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[0], 0x233):
-    case PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[1], 0x234):
-    case PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[2], 0x235): {
-        // TODO: Does actual hardware indeed keep an intermediate buffer or does
-        //       it directly write the values?
-        default_attr_write_buffer[default_attr_counter++] = value;
-
-        // Default attributes are written in a packed format such that four float24 values are
-        // encoded in
-        // three 32-bit numbers. We write to internal memory once a full such vector is
-        // written.
-        if (default_attr_counter >= 3) {
-            default_attr_counter = 0;
-
-            auto& setup = regs.vs_default_attributes_setup;
-
-            if (setup.index >= 16) {
-                LOG_ERROR(HW_GPU, "Invalid VS default attribute index %d", (int)setup.index);
-                break;
-            }
 
-            Math::Vec4<float24> attribute;
+        auto& setup = regs.vs_default_attributes_setup;
 
-            // NOTE: The destination component order indeed is "backwards"
-            attribute.w = float24::FromRaw(default_attr_write_buffer[0] >> 8);
-            attribute.z = float24::FromRaw(((default_attr_write_buffer[0] & 0xFF) << 16) |
-                                           ((default_attr_write_buffer[1] >> 16) & 0xFFFF));
-            attribute.y = float24::FromRaw(((default_attr_write_buffer[1] & 0xFFFF) << 8) |
-                                           ((default_attr_write_buffer[2] >> 24) & 0xFF));
-            attribute.x = float24::FromRaw(default_attr_write_buffer[2] & 0xFFFFFF);
+        if (setup.index >= 16) {
+            LOG_ERROR(HW_GPU, "Invalid VS default attribute index %d", (int)setup.index);
+            return;
+        }
 
-            LOG_TRACE(HW_GPU, "Set default VS attribute %x to (%f %f %f %f)", (int)setup.index,
-                      attribute.x.ToFloat32(), attribute.y.ToFloat32(), attribute.z.ToFloat32(),
-                      attribute.w.ToFloat32());
+        Math::Vec4<float24> attribute;
 
-            // TODO: Verify that this actually modifies the register!
-            if (setup.index < 15) {
-                g_state.vs_default_attributes[setup.index] = attribute;
-                setup.index++;
-            } else {
-                // Put each attribute into an immediate input buffer.
-                // When all specified immediate attributes are present, the Vertex Shader is invoked
-                // and everything is
-                // sent to the primitive assembler.
+        // NOTE: The destination component order indeed is "backwards"
+        attribute.w = float24::FromRaw(default_attr_write_buffer[0] >> 8);
+        attribute.z = float24::FromRaw(((default_attr_write_buffer[0] & 0xFF) << 16) |
+                                       ((default_attr_write_buffer[1] >> 16) & 0xFFFF));
+        attribute.y = float24::FromRaw(((default_attr_write_buffer[1] & 0xFFFF) << 8) |
+                                       ((default_attr_write_buffer[2] >> 24) & 0xFF));
+        attribute.x = float24::FromRaw(default_attr_write_buffer[2] & 0xFFFFFF);
 
-                auto& immediate_input = g_state.immediate.input_vertex;
-                auto& immediate_attribute_id = g_state.immediate.current_attribute;
+        LOG_TRACE(HW_GPU, "Set default VS attribute %x to (%f %f %f %f)", (int)setup.index,
+                  attribute.x.ToFloat32(), attribute.y.ToFloat32(), attribute.z.ToFloat32(),
+                  attribute.w.ToFloat32());
 
-                immediate_input.attr[immediate_attribute_id++] = attribute;
+        // TODO: Verify that this actually modifies the register!
+        if (setup.index < 15) {
+            g_state.vs_default_attributes[setup.index] = attribute;
+            setup.index++;
+        } else {
+            // Put each attribute into an immediate input buffer.
+            // When all specified immediate attributes are present, the Vertex Shader is invoked
+            // and everything is
+            // sent to the primitive assembler.
 
-                if (immediate_attribute_id >= regs.vs.num_input_attributes + 1) {
-                    immediate_attribute_id = 0;
+            auto& immediate_input = g_state.immediate.input_vertex;
+            auto& immediate_attribute_id = g_state.immediate.current_attribute;
 
-                    auto& shader_unit = Shader::GetShaderUnit(false);
-                    g_state.vs.Setup();
+            immediate_input.attr[immediate_attribute_id++] = attribute;
 
-                    // Send to vertex shader
-                    if (g_debug_context)
-                        g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
-                                                 static_cast<void*>(&immediate_input));
-                    g_state.vs.Run(shader_unit, immediate_input, regs.vs.num_input_attributes + 1,
-                                   regs.vs);
-                    Shader::OutputVertex output_vertex =
-                        shader_unit.output_registers.ToVertex(regs.vs);
-
-                    // Send to renderer
-                    using Pica::Shader::OutputVertex;
-                    auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
-                                          const OutputVertex& v2) {
-                        VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
-                    };
-
-                    g_state.primitive_assembler.SubmitVertex(output_vertex, AddTriangle);
-                }
+            if (immediate_attribute_id >= regs.vs.num_input_attributes + 1) {
+                immediate_attribute_id = 0;
+
+                auto& shader_unit = Shader::GetShaderUnit(false);
+                g_state.vs.Setup();
+
+                // Send to vertex shader
+                if (g_debug_context)
+                    g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
+                                             static_cast<void*>(&immediate_input));
+                g_state.vs.Run(shader_unit, immediate_input, regs.vs.num_input_attributes + 1,
+                               regs.vs);
+                Shader::OutputVertex output_vertex =
+                    shader_unit.output_registers.ToVertex(regs.vs);
+
+                // Send to renderer
+                g_state.primitive_assembler.SubmitVertex(output_vertex, AddTriangle);
             }
         }
-        break;
     }
+}
 
-    case PICA_REG_INDEX(gpu_mode):
-        if (regs.gpu_mode == Regs::GPUMode::Configuring) {
-            // Draw immediate mode triangles when GPU Mode is set to GPUMode::Configuring
-            VideoCore::g_renderer->Rasterizer()->DrawTriangles();
+static void SetGPUMode(u32 id, u32 value) {
+    if (g_state.regs.gpu_mode == Regs::GPUMode::Configuring) {
+        // Draw immediate mode triangles when GPU Mode is set to GPUMode::Configuring
+        VideoCore::g_renderer->Rasterizer()->DrawTriangles();
 
-            if (g_debug_context) {
-                g_debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch, nullptr);
-            }
+        if (g_debug_context) {
+            g_debug_context->OnEvent(DebugContext::Event::FinishedPrimitiveBatch, nullptr);
         }
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(command_buffer.trigger[0], 0x23c):
-    case PICA_REG_INDEX_WORKAROUND(command_buffer.trigger[1], 0x23d): {
-        unsigned index = static_cast<unsigned>(id - PICA_REG_INDEX(command_buffer.trigger[0]));
-        u32* head_ptr =
-            (u32*)Memory::GetPhysicalPointer(regs.command_buffer.GetPhysicalAddress(index));
-        g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = head_ptr;
-        g_state.cmd_list.length = regs.command_buffer.GetSize(index) / sizeof(u32);
-        break;
     }
+}
 
-    // It seems like these trigger vertex rendering
-    case PICA_REG_INDEX(trigger_draw):
-    case PICA_REG_INDEX(trigger_draw_indexed): {
-        MICROPROFILE_SCOPE(GPU_Drawing);
+static void TriggerCommandBuffer(u32 id, u32 value) {
+    auto& regs = g_state.regs;
+    unsigned index = static_cast<unsigned>(id - PICA_REG_INDEX(command_buffer.trigger[0]));
+    u32* head_ptr = (u32*)Memory::GetPhysicalPointer(regs.command_buffer.GetPhysicalAddress(index));
+    g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = head_ptr;
+    g_state.cmd_list.length = regs.command_buffer.GetSize(index) / sizeof(u32);
+}
+
+// It seems like these trigger vertex rendering
+static void TriggerDraw(u32 id, u32 value) {
+    auto& regs = g_state.regs;
+
+    MICROPROFILE_SCOPE(GPU_Drawing);
 
 #if PICA_LOG_TEV
-        DebugUtils::DumpTevStageConfig(regs.GetTevStages());
+    DebugUtils::DumpTevStageConfig(regs.GetTevStages());
 #endif
-        if (g_debug_context)
-            g_debug_context->OnEvent(DebugContext::Event::IncomingPrimitiveBatch, nullptr);
-
-        // Processes information about internal vertex attributes to figure out how a vertex is
-        // loaded.
-        // Later, these can be compiled and cached.
-        const u32 base_address = regs.vertex_attributes.GetPhysicalBaseAddress();
-        VertexLoader loader(regs);
-
-        // Load vertices
-        bool is_indexed = (id == PICA_REG_INDEX(trigger_draw_indexed));
-
-        const auto& index_info = regs.index_array;
-        const u8* index_address_8 = Memory::GetPhysicalPointer(base_address + index_info.offset);
-            if (!index_address_8) {
-                LOG_CRITICAL(HW_GPU, "Invalid index_address_8 %08x", index_address_8);
-                break;
-            }
-        const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
-        bool index_u16 = index_info.format != 0;
+    if (g_debug_context)
+        g_debug_context->OnEvent(DebugContext::Event::IncomingPrimitiveBatch, nullptr);
 
-        PrimitiveAssembler<Shader::OutputVertex>& primitive_assembler = g_state.primitive_assembler;
+    // Look up the loader specialized for the current vertex attribute layout, building it
+    // if this layout hasn't been seen before
+    const u32 base_address = regs.vertex_attributes.GetPhysicalBaseAddress();
+    const VertexLoader& loader = VertexLoader::GetCached(regs);
 
-        if (g_debug_context) {
-            for (int i = 0; i < 3; ++i) {
-                const auto texture = regs.GetTextures()[i];
-                if (!texture.enabled)
-                    continue;
+    // Load vertices
+    bool is_indexed = (id == PICA_REG_INDEX(trigger_draw_indexed));
 
-                u8* texture_data = Memory::GetPhysicalPointer(texture.config.GetPhysicalAddress());
-                if (g_debug_context && Pica::g_debug_context->recorder)
-                    g_debug_context->recorder->MemoryAccessed(
-                        texture_data, Pica::Regs::NibblesPerPixel(texture.format) *
-                                          texture.config.width / 2 * texture.config.height,
-                        texture.config.GetPhysicalAddress());
-            }
+    const auto& index_info = regs.index_array;
+    const u8* index_address_8 = Memory::GetPhysicalPointer(base_address + index_info.offset);
+    if (!index_address_8) {
+        LOG_CRITICAL(HW_GPU, "Invalid index_address_8 %08x", index_address_8);
+        return;
+    }
+    const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
+    bool index_u16 = index_info.format != 0;
+
+    PrimitiveAssembler<Shader::OutputVertex>& primitive_assembler = g_state.primitive_assembler;
+
+    if (g_debug_context) {
+        for (int i = 0; i < 3; ++i) {
+            const auto texture = regs.GetTextures()[i];
+            if (!texture.enabled)
+                continue;
+
+            u8* texture_data = Memory::GetPhysicalPointer(texture.config.GetPhysicalAddress());
+            if (g_debug_context && Pica::g_debug_context->recorder)
+                g_debug_context->recorder->MemoryAccessed(
+                    texture_data, Pica::Regs::NibblesPerPixel(texture.format) *
+                                      texture.config.width / 2 * texture.config.height,
+                    texture.config.GetPhysicalAddress());
         }
+    }
 
-        DebugUtils::MemoryAccessTracker memory_accesses;
-
-        // Simple circular-replacement vertex cache
-        // The size has been tuned for optimal balance between hit-rate and the cost of lookup
-        const size_t VERTEX_CACHE_SIZE = 32;
-        std::array<u16, VERTEX_CACHE_SIZE> vertex_cache_ids;
-        std::array<Shader::OutputRegisters, VERTEX_CACHE_SIZE> vertex_cache;
-
-        unsigned int vertex_cache_pos = 0;
-        vertex_cache_ids.fill(-1);
-
-        auto& vs_shader_unit = Shader::GetShaderUnit(false);
-        g_state.vs.Setup();
-
-        auto& gs_unit_state = Shader::GetShaderUnit(true);
-        g_state.gs.Setup();
-
-        for (unsigned int index = 0; index < regs.num_vertices; ++index) {
+    DebugUtils::MemoryAccessTracker memory_accesses;
+
+    vertex_cache.BeginDraw();
+    unsigned int vertex_cache_hits = 0;
+    unsigned int vertex_cache_misses = 0;
+    const size_t input_size = loader.GetNumTotalAttributes() * sizeof(Math::Vec4<float24>);
+
+    auto& vs_shader_unit = Shader::GetShaderUnit(false);
+    g_state.vs.Setup();
+
+    auto& gs_unit_state = Shader::GetShaderUnit(true);
+    g_state.gs.Setup();
+
+    // Vertices are processed in windows of consecutive indices: the window's indices are
+    // first resolved to cached outputs or queued for shading, then the queued vertices are
+    // shaded with a single call and finally all vertices are assembled in order.
+    // Large draws without a geometry shader use bigger windows, whose queued vertices are
+    // shaded in parallel chunks. The debugger expects vertices to be shaded one at a time.
+    constexpr unsigned int VERTEX_BATCH_SIZE = 32;
+    constexpr unsigned int PARALLEL_VERTEX_BATCH_SIZE = 1024;
+    constexpr unsigned int MIN_VERTICES_PER_CHUNK = 64;
+
+    const bool shade_in_parallel = !Shader::UseGS() && !g_debug_context &&
+                                   regs.num_vertices >= 2 * MIN_VERTICES_PER_CHUNK;
+    const size_t shader_threads = shade_in_parallel ? GetVertexShaderThreads() : 1;
+    const unsigned int window_size =
+        shader_threads > 1 ? PARALLEL_VERTEX_BATCH_SIZE : VERTEX_BATCH_SIZE;
+
+    static std::vector<Shader::InputVertex> batch_inputs(PARALLEL_VERTEX_BATCH_SIZE);
+    static std::vector<Shader::OutputRegisters> batch_outputs(PARALLEL_VERTEX_BATCH_SIZE);
+    static std::vector<u32> batch_vertices(PARALLEL_VERTEX_BATCH_SIZE);
+    static std::vector<const Shader::OutputRegisters*> window_outputs(
+        PARALLEL_VERTEX_BATCH_SIZE);
+
+    // Batch slot of the vertices queued in the current window, hashed like the vertex cache.
+    // Slots are validated against batch_vertices, so the table never needs to be cleared.
+    constexpr size_t PENDING_TABLE_SIZE = 2 * PARALLEL_VERTEX_BATCH_SIZE;
+    static std::array<u32, PENDING_TABLE_SIZE> pending_slots;
+
+    for (unsigned int window_start = 0; window_start < regs.num_vertices;
+         window_start += window_size) {
+        const unsigned int window_end =
+            std::min<unsigned int>(window_start + window_size, regs.num_vertices);
+        unsigned int batch_size = 0;
+
+        for (unsigned int index = window_start; index < window_end; ++index) {
             // Indexed rendering doesn't use the start offset
             unsigned int vertex =
                 is_indexed ? (index_u16 ? index_address_16[index] : index_address_8[index])
@@ -258,8 +412,10 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
             // the PICA supports it, and it would mess up the caching, guard against it here.
             ASSERT(vertex != -1);
 
-            bool vertex_cache_hit = false;
-            Shader::OutputRegisters output_registers;
+            const Shader::OutputRegisters*& output = window_outputs[index - window_start];
+            output = nullptr;
+            bool input_loaded = false;
+            Shader::InputVertex& input = batch_inputs[batch_size];
 
             if (is_indexed) {
                 if (g_debug_context && Pica::g_debug_context->recorder) {
@@ -268,40 +424,61 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
                                               size);
                 }
 
-                for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
-                    if (vertex == vertex_cache_ids[i]) {
-                        output_registers = vertex_cache[i];
-                        vertex_cache_hit = true;
-                        break;
+                // Vertices repeated within the window are only shaded once
+                u32& pending_slot = pending_slots[vertex & (PENDING_TABLE_SIZE - 1)];
+                if (pending_slot < batch_size && batch_vertices[pending_slot] == vertex)
+                    output = &batch_outputs[pending_slot];
+
+                VertexCache::Entry& entry = vertex_cache.Get(vertex);
+                if (output == nullptr && vertex_cache.IsValid(entry, vertex)) {
+                    if (entry.draw_id == vertex_cache.draw_id) {
+                        output = &entry.output;
+                    } else {
+                        // Entry from an earlier draw: only reuse it if the inputs are unchanged
+                        loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
+                        input_loaded = true;
+                        if (std::memcmp(&input, &entry.input, input_size) == 0) {
+                            entry.draw_id = vertex_cache.draw_id;
+                            output = &entry.output;
+                        }
                     }
                 }
+
+                if (output != nullptr) {
+                    ++vertex_cache_hits;
+                    continue;
+                }
+                ++vertex_cache_misses;
             }
 
-            if (!vertex_cache_hit) {
-                // Initialize data for the current vertex
-                Shader::InputVertex input;
+            // Initialize data for the current vertex
+            if (!input_loaded)
                 loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
 
-                // Send to vertex shader
-                if (g_debug_context)
-                    g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
-                                             (void*)&input);
-                g_state.vs.Run(vs_shader_unit, input, loader.GetNumTotalAttributes(), regs.vs);
-                output_registers = vs_shader_unit.output_registers;
-
-                if (is_indexed) {
-                    vertex_cache[vertex_cache_pos] = output_registers;
-                    vertex_cache_ids[vertex_cache_pos] = vertex;
-                    vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
-                }
-            }
+            // Send to vertex shader
+            if (g_debug_context)
+                g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation,
+                                         (void*)&input);
+            batch_vertices[batch_size] = vertex;
+            pending_slots[vertex & (PENDING_TABLE_SIZE - 1)] = batch_size;
+            output = &batch_outputs[batch_size];
+            ++batch_size;
+        }
 
-            // Helper to send triangle to renderer
-            using Pica::Shader::OutputVertex;
-            auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1,
-                                  const OutputVertex& v2) {
-                VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
-            };
+        const size_t num_chunks =
+            std::min<size_t>(shader_threads, batch_size / MIN_VERTICES_PER_CHUNK);
+        if (num_chunks > 1) {
+            RunBatchParallel(VideoCore::GetThreadPool(), num_chunks, vs_shader_unit,
+                             batch_inputs.data(), batch_outputs.data(), batch_size,
+                             loader.GetNumTotalAttributes());
+        } else if (batch_size > 0) {
+            g_state.vs.RunBatch(vs_shader_unit, batch_inputs.data(), batch_outputs.data(),
+                                batch_size, loader.GetNumTotalAttributes(), regs.vs);
+        }
+
+        for (unsigned int index = window_start; index < window_end; ++index) {
+            const Shader::OutputRegisters& output_registers =
+                *window_outputs[index - window_start];
 
             if (Shader::UseGS()) {
 
@@ -353,185 +530,249 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
             }
         }
 
-        for (auto& range : memory_accesses.ranges) {
-            g_debug_context->recorder->MemoryAccessed(Memory::GetPhysicalPointer(range.first),
-                                                      range.second, range.first);
+        // Cache entries are only replaced once the window's vertices have been assembled,
+        // since cache hits within the window point into them
+        if (is_indexed) {
+            for (unsigned int i = 0; i < batch_size; ++i) {
+                VertexCache::Entry& entry = vertex_cache.Get(batch_vertices[i]);
+                entry.vertex = batch_vertices[i];
+                entry.generation = vertex_cache.generation;
+                entry.draw_id = vertex_cache.draw_id;
+                entry.shader_key = vertex_cache.shader_key;
+                std::memcpy(&entry.input, &batch_inputs[i], input_size);
+                entry.output = batch_outputs[i];
+            }
         }
-
-        break;
     }
 
-    case PICA_REG_INDEX(gs.bool_uniforms):
-        Shader::WriteUniformBoolReg(true, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[0], 0x281):
-    case PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[1], 0x282):
-    case PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[2], 0x283):
-    case PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[3], 0x284): {
-        unsigned index = (id - PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[0], 0x281));
-        auto values = regs.gs.int_uniforms[index];
-        Shader::WriteUniformIntReg(true, index,
-                                   Math::Vec4<u8>(values.x, values.y, values.z, values.w));
-        break;
+    for (auto& range : memory_accesses.ranges) {
+        g_debug_context->recorder->MemoryAccessed(Memory::GetPhysicalPointer(range.first),
+                                                  range.second, range.first);
     }
 
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.setup, 0x290):
-        Shader::WriteUniformFloatSetupReg(true, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[0], 0x291):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[1], 0x292):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[2], 0x293):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[3], 0x294):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[4], 0x295):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[5], 0x296):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[6], 0x297):
-    case PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[7], 0x298): {
-        Shader::WriteUniformFloatReg(true, value);
-        break;
+    if (is_indexed) {
+        MICROPROFILE_META_CPU("Vertex cache hits", vertex_cache_hits);
+        MICROPROFILE_META_CPU("Vertex cache misses", vertex_cache_misses);
     }
 
-    // Load shader program code
-    case PICA_REG_INDEX_WORKAROUND(gs.program.offset, 0x29b):
-        Shader::WriteProgramCodeOffset(true, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[0], 0x29c):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[1], 0x29d):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[2], 0x29e):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[3], 0x29f):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[4], 0x2a0):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[5], 0x2a1):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[6], 0x2a2):
-    case PICA_REG_INDEX_WORKAROUND(gs.program.set_word[7], 0x2a3): {
-        Shader::WriteProgramCode(true, value);
-        break;
-    }
+}
 
-    // Load swizzle pattern data
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.offset, 0x2a5):
-        Shader::WriteSwizzlePatternsOffset(true, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[0], 0x2a6):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[1], 0x2a7):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[2], 0x2a8):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[3], 0x2a9):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[4], 0x2aa):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[5], 0x2ab):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[6], 0x2ac):
-    case PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[7], 0x2ad): {
-        Shader::WriteSwizzlePatterns(true, value);
-        break;
-    }
+template <bool gs>
+static void SetBoolUniforms(u32 id, u32 value) {
+    Shader::WriteUniformBoolReg(gs, value);
+}
 
-    case PICA_REG_INDEX(vs.bool_uniforms):
-        Shader::WriteUniformBoolReg(false, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[0], 0x2b1):
-    case PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[1], 0x2b2):
-    case PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[2], 0x2b3):
-    case PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[3], 0x2b4): {
-        unsigned index = (id - PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[0], 0x2b1));
-        auto values = regs.vs.int_uniforms[index];
-        Shader::WriteUniformIntReg(false, index,
-                                   Math::Vec4<u8>(values.x, values.y, values.z, values.w));
-        break;
-    }
+template <bool gs>
+static void SetIntUniforms(u32 id, u32 value) {
+    const auto& config = gs ? g_state.regs.gs : g_state.regs.vs;
+    const u32 first_id = gs ? PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[0], 0x281)
+                            : PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[0], 0x2b1);
+    unsigned index = id - first_id;
+    auto values = config.int_uniforms[index];
+    Shader::WriteUniformIntReg(gs, index, Math::Vec4<u8>(values.x, values.y, values.z, values.w));
+}
 
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.setup, 0x2c0):
-        Shader::WriteUniformFloatSetupReg(false, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[0], 0x2c1):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[1], 0x2c2):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[2], 0x2c3):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[3], 0x2c4):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[4], 0x2c5):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[5], 0x2c6):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[6], 0x2c7):
-    case PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[7], 0x2c8): {
-        Shader::WriteUniformFloatReg(false, value);
-        break;
-    }
+template <bool gs>
+static void SetFloatUniformSetup(u32 id, u32 value) {
+    Shader::WriteUniformFloatSetupReg(gs, value);
+}
 
-    // Load shader program code
-    case PICA_REG_INDEX_WORKAROUND(vs.program.offset, 0x2cb):
-        Shader::WriteProgramCodeOffset(false, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[0], 0x2cc):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[1], 0x2cd):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[2], 0x2ce):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[3], 0x2cf):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[4], 0x2d0):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[5], 0x2d1):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[6], 0x2d2):
-    case PICA_REG_INDEX_WORKAROUND(vs.program.set_word[7], 0x2d3): {
-        Shader::WriteProgramCode(false, value);
-        break;
-    }
+template <bool gs>
+static void SetFloatUniformValue(u32 id, u32 value) {
+    Shader::WriteUniformFloatReg(gs, value);
+}
 
-    // Load swizzle pattern data
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.offset, 0x2d5):
-        Shader::WriteSwizzlePatternsOffset(false, value);
-        break;
-
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[0], 0x2d6):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[1], 0x2d7):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[2], 0x2d8):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[3], 0x2d9):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[4], 0x2da):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[5], 0x2db):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[6], 0x2dc):
-    case PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[7], 0x2dd): {
-        Shader::WriteSwizzlePatterns(false, value);
-        break;
-    }
+// Load shader program code
+template <bool gs>
+static void SetProgramCodeOffset(u32 id, u32 value) {
+    Shader::WriteProgramCodeOffset(gs, value);
+}
 
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[0], 0x1c8):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[1], 0x1c9):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[2], 0x1ca):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[3], 0x1cb):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[4], 0x1cc):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[5], 0x1cd):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[6], 0x1ce):
-    case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[7], 0x1cf): {
-        auto& lut_config = regs.lighting.lut_config;
-
-        ASSERT_MSG(lut_config.index < 256, "lut_config.index exceeded maximum value of 255!");
-
-        g_state.lighting.luts[lut_config.type][lut_config.index].raw = value;
-        lut_config.index.Assign(lut_config.index + 1);
-        break;
-    }
+template <bool gs>
+static void SetProgramCode(u32 id, u32 value) {
+    Shader::WriteProgramCode(gs, value);
+    if (!gs)
+        vertex_cache.program_dirty = true;
+}
 
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[0], 0xe8):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[1], 0xe9):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[2], 0xea):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[3], 0xeb):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[4], 0xec):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[5], 0xed):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[6], 0xee):
-    case PICA_REG_INDEX_WORKAROUND(fog_lut_data[7], 0xef): {
-        g_state.fog.lut[regs.fog_lut_offset % 128].raw = value;
-        regs.fog_lut_offset.Assign(regs.fog_lut_offset + 1);
-        break;
-    }
+// Load swizzle pattern data
+template <bool gs>
+static void SetSwizzlePatternsOffset(u32 id, u32 value) {
+    Shader::WriteSwizzlePatternsOffset(gs, value);
+}
+
+template <bool gs>
+static void SetSwizzlePatterns(u32 id, u32 value) {
+    Shader::WriteSwizzlePatterns(gs, value);
+    if (!gs)
+        vertex_cache.program_dirty = true;
+}
+
+static void SetLightingLUTData(u32 id, u32 value) {
+    auto& lut_config = g_state.regs.lighting.lut_config;
+
+    ASSERT_MSG(lut_config.index < 256, "lut_config.index exceeded maximum value of 255!");
+
+    g_state.lighting.luts[lut_config.type][lut_config.index].raw = value;
+    g_state.lighting.dirty_luts |= 1u << lut_config.type;
+    lut_config.index.Assign(lut_config.index + 1);
+}
+
+static void SetFogLUTData(u32 id, u32 value) {
+    auto& regs = g_state.regs;
+    g_state.fog.lut[regs.fog_lut_offset % 128].raw = value;
+    regs.fog_lut_offset.Assign(regs.fog_lut_offset + 1);
+}
+
+using RegisterHandlerTable = std::array<RegisterHandler, Regs::NumIds()>;
+
+static RegisterHandlerTable BuildRegisterHandlers() {
+    RegisterHandlerTable handlers{};
+    const auto set_handlers = [&handlers](size_t first_id, size_t count, RegisterHandler handler) {
+        std::fill_n(handlers.begin() + first_id, count, handler);
+    };
+
+    handlers[PICA_REG_INDEX(trigger_irq)] = TriggerIRQ;
+    handlers[PICA_REG_INDEX_WORKAROUND(triangle_topology, 0x25E)] = SetTriangleTopology;
+    handlers[PICA_REG_INDEX_WORKAROUND(restart_primitive, 0x25F)] = RestartPrimitive;
+    handlers[PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.index, 0x232)] =
+        SetDefaultAttributeIndex;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[0], 0x233), 3,
+                 SetDefaultAttributeValue);
+    handlers[PICA_REG_INDEX(gpu_mode)] = SetGPUMode;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(command_buffer.trigger[0], 0x23c), 2,
+                 TriggerCommandBuffer);
+    handlers[PICA_REG_INDEX(trigger_draw)] = TriggerDraw;
+    handlers[PICA_REG_INDEX(trigger_draw_indexed)] = TriggerDraw;
+
+    handlers[PICA_REG_INDEX(gs.bool_uniforms)] = SetBoolUniforms<true>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(gs.int_uniforms[0], 0x281), 4, SetIntUniforms<true>);
+    handlers[PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.setup, 0x290)] =
+        SetFloatUniformSetup<true>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(gs.uniform_setup.set_value[0], 0x291), 8,
+                 SetFloatUniformValue<true>);
+    handlers[PICA_REG_INDEX_WORKAROUND(gs.program.offset, 0x29b)] = SetProgramCodeOffset<true>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(gs.program.set_word[0], 0x29c), 8,
+                 SetProgramCode<true>);
+    handlers[PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.offset, 0x2a5)] =
+        SetSwizzlePatternsOffset<true>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(gs.swizzle_patterns.set_word[0], 0x2a6), 8,
+                 SetSwizzlePatterns<true>);
+
+    handlers[PICA_REG_INDEX(vs.bool_uniforms)] = SetBoolUniforms<false>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(vs.int_uniforms[0], 0x2b1), 4, SetIntUniforms<false>);
+    handlers[PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.setup, 0x2c0)] =
+        SetFloatUniformSetup<false>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(vs.uniform_setup.set_value[0], 0x2c1), 8,
+                 SetFloatUniformValue<false>);
+    handlers[PICA_REG_INDEX_WORKAROUND(vs.program.offset, 0x2cb)] = SetProgramCodeOffset<false>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(vs.program.set_word[0], 0x2cc), 8,
+                 SetProgramCode<false>);
+    handlers[PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.offset, 0x2d5)] =
+        SetSwizzlePatternsOffset<false>;
+    set_handlers(PICA_REG_INDEX_WORKAROUND(vs.swizzle_patterns.set_word[0], 0x2d6), 8,
+                 SetSwizzlePatterns<false>);
+
+    set_handlers(PICA_REG_INDEX_WORKAROUND(lighting.lut_data[0], 0x1c8), 8, SetLightingLUTData);
+    set_handlers(PICA_REG_INDEX_WORKAROUND(fog_lut_data[0], 0xe8), 8, SetFogLUTData);
+
+    return handlers;
+}
+
+// Registers with side effects beyond storing the written value. Writes to all other registers
+// only need to be recorded.
+static const RegisterHandlerTable register_handlers = BuildRegisterHandlers();
 
-    default:
-        break;
+/// Returns true if the given register only stores the value written to it
+static bool IsStorageRegister(u32 id) {
+    return register_handlers[id] == nullptr;
+}
+
+/// Must be called before writing to registers that may affect how triangles are drawn
+static void BeginRegisterWrite(u32 id) {
+    // Immediate mode vertex data doesn't affect rasterization, so keep batching triangles
+    const bool is_vertex_data =
+        id >= PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[0], 0x233) &&
+        id <= PICA_REG_INDEX_WORKAROUND(vs_default_attributes_setup.set_value[2], 0x235);
+
+    if (triangles_pending && !is_vertex_data) {
+        VideoCore::g_renderer->Rasterizer()->NotifyPicaRegistersChanging();
+        triangles_pending = false;
     }
+}
+
+static void WritePicaReg(u32 id, u32 value, u32 mask) {
+    auto& regs = g_state.regs;
+
+    if (id >= regs.NumIds())
+        return;
 
-    VideoCore::g_renderer->Rasterizer()->NotifyPicaRegisterChanged(id);
+    // If we're skipping this frame, only allow trigger IRQ
+    if (GPU::g_skip_frame && id != PICA_REG_INDEX(trigger_irq))
+        return;
+
+    BeginRegisterWrite(id);
+
+    // TODO: Figure out how register masking acts on e.g. vs.uniform_setup.set_value
+    u32 old_value = regs[id];
+
+    const u32 write_mask = expand_bits_to_bytes[mask];
+
+    regs[id] = (old_value & ~write_mask) | (value & write_mask);
+    g_state.dirty_regs.Set(id);
+
+    DebugUtils::OnPicaRegWrite({(u16)id, (u16)mask, regs[id]});
+
+    if (g_debug_context)
+        g_debug_context->OnEvent(DebugContext::Event::PicaCommandLoaded,
+                                 reinterpret_cast<void*>(&id));
+
+    if (AffectsVertexShader(id))
+        vertex_cache.shader_dirty = true;
+
+    if (!IsStorageRegister(id))
+        register_handlers[id](id, value);
 
     if (g_debug_context)
         g_debug_context->OnEvent(DebugContext::Event::PicaCommandProcessed,
                                  reinterpret_cast<void*>(&id));
 }
 
+/**
+ * Writes consecutive registers at once, if they all only store the values written to them and
+ * there is nobody observing the individual writes. Returns false if they need to be written one
+ * by one instead.
+ */
+static bool WritePicaRegRange(u32 first_id, const u32* values, u32 count, u32 mask) {
+    if (g_debug_context || DebugUtils::IsPicaTracing() || GPU::g_skip_frame)
+        return false;
+
+    if (first_id + count > Regs::NumIds())
+        return false;
+
+    for (u32 id = first_id; id < first_id + count; ++id) {
+        if (!IsStorageRegister(id))
+            return false;
+    }
+
+    BeginRegisterWrite(first_id);
+
+    u32* regs = &g_state.regs[first_id];
+    if (mask == 0xF) {
+        std::memcpy(regs, values, count * sizeof(u32));
+    } else {
+        const u32 write_mask = expand_bits_to_bytes[mask];
+        for (u32 i = 0; i < count; ++i)
+            regs[i] = (regs[i] & ~write_mask) | (values[i] & write_mask);
+    }
+    g_state.dirty_regs.SetRange(first_id, count);
+
+    if (AffectsVertexShader(first_id, count))
+        vertex_cache.shader_dirty = true;
+
+    return true;
+}
+
 void ProcessCommandList(const u32* list, u32 size) {
     g_state.cmd_list.head_ptr = g_state.cmd_list.current_ptr = list;
     g_state.cmd_list.length = size / sizeof(u32);
@@ -547,6 +788,15 @@ void ProcessCommandList(const u32* list, u32 size) {
 
         WritePicaReg(header.cmd_id, value, header.parameter_mask);
 
+        // Bursts of writes to consecutive storage registers, such as whole blocks of render
+        // state, are copied into the register file directly
+        if (header.group_commands &&
+            WritePicaRegRange(header.cmd_id + 1, g_state.cmd_list.current_ptr,
+                              header.extra_data_length, header.parameter_mask)) {
+            g_state.cmd_list.current_ptr += header.extra_data_length;
+            continue;
+        }
+
         for (unsigned i = 0; i < header.extra_data_length; ++i) {
             u32 cmd = header.cmd_id + (header.group_commands ? i + 1 : 0);
             WritePicaReg(cmd, *g_state.cmd_list.current_ptr++, header.parameter_mask);
@@ -36,6 +36,9 @@ static_assert(sizeof(CommandHeader) == sizeof(u32), "CommandHeader has incorrect
 
 void ProcessCommandList(const u32* list, u32 size);
 
+/// Discards all entries of the post-transform vertex cache used for indexed draws
+void InvalidateVertexCache();
+
 } // namespace
 
 } // namespace
@@ -0,0 +1,164 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include "common/assert.h"
+#include "common/common_types.h"
+#include "video_core/morton.h"
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+namespace VideoCore {
+
+// An 8x8 tile is made of sixteen 2x2 blocks stored one after another in Morton order (see
+// GetMortonOffset). Each block holds two pixels of one row followed by the two pixels of the row
+// above it, so a tile can be converted by moving runs of two pixels instead of single texels.
+
+using TileFunc = void (*)(u8* tile_data, u8* linear_data, s32 linear_stride);
+
+template <bool morton_to_linear>
+static inline void CopyBytes(u8* tile, u8* linear, size_t size) {
+    if (morton_to_linear) {
+        std::memcpy(linear, tile, size);
+    } else {
+        std::memcpy(tile, linear, size);
+    }
+}
+
+template <u32 bytes_per_pixel, bool morton_to_linear>
+static void CopyTile(u8* tile_data, u8* linear_data, s32 linear_stride) {
+    constexpr u32 pair_size = 2 * bytes_per_pixel;
+
+    for (u32 block = 0; block < 16; ++block) {
+        const s32 x = ((block & 1) | ((block >> 1) & 2)) * 2;
+        const s32 y = (((block >> 1) & 1) | ((block >> 2) & 2)) * 2;
+
+        u8* tile = tile_data + block * 2 * pair_size;
+        u8* row = linear_data + y * linear_stride + x * bytes_per_pixel;
+        CopyBytes<morton_to_linear>(tile, row, pair_size);
+        CopyBytes<morton_to_linear>(tile + pair_size, row + linear_stride, pair_size);
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+/// Index of the block holding the first two pixels of the given row pair
+static constexpr u32 FirstBlockOfRows(u32 y) {
+    return (((y >> 1) & 1) << 1) | (((y >> 2) & 1) << 3);
+}
+
+template <bool morton_to_linear>
+static void CopyTile16BitSSE2(u8* tile_data, u8* linear_data, s32 linear_stride) {
+    // Two consecutive blocks cover four pixels of two rows, as 32-bit pairs ordered
+    // (row 0, row 1, row 0, row 1). Swapping the middle pairs separates the rows.
+    for (s32 y = 0; y < 8; y += 2) {
+        u8* left = tile_data + FirstBlockOfRows(y) * 8;
+        u8* right = left + 4 * 8;
+        u8* row0 = linear_data + y * linear_stride;
+        u8* row1 = row0 + linear_stride;
+
+        if (morton_to_linear) {
+            const __m128i l = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i*>(left)),
+                                                _MM_SHUFFLE(3, 1, 2, 0));
+            const __m128i r = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i*>(right)),
+                                                _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row0), _mm_unpacklo_epi64(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row1), _mm_unpackhi_epi64(l, r));
+        } else {
+            const __m128i r0 = _mm_loadu_si128(reinterpret_cast<__m128i*>(row0));
+            const __m128i r1 = _mm_loadu_si128(reinterpret_cast<__m128i*>(row1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(left),
+                             _mm_shuffle_epi32(_mm_unpacklo_epi64(r0, r1), _MM_SHUFFLE(3, 1, 2, 0)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(right),
+                             _mm_shuffle_epi32(_mm_unpackhi_epi64(r0, r1), _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+    }
+}
+
+template <bool morton_to_linear>
+static void CopyTile32BitSSE2(u8* tile_data, u8* linear_data, s32 linear_stride) {
+    // A block is exactly 16 bytes: two pixels of row 0 in the low half, two of row 1 in the high
+    for (s32 y = 0; y < 8; y += 2) {
+        u8* row0 = linear_data + y * linear_stride;
+        u8* row1 = row0 + linear_stride;
+
+        for (u32 half = 0; half < 2; ++half) {
+            u8* block0 = tile_data + (FirstBlockOfRows(y) + half * 4) * 16;
+            u8* block1 = block0 + 16;
+            __m128i* dst0 = reinterpret_cast<__m128i*>(row0 + half * 16);
+            __m128i* dst1 = reinterpret_cast<__m128i*>(row1 + half * 16);
+
+            if (morton_to_linear) {
+                const __m128i b0 = _mm_loadu_si128(reinterpret_cast<__m128i*>(block0));
+                const __m128i b1 = _mm_loadu_si128(reinterpret_cast<__m128i*>(block1));
+                _mm_storeu_si128(dst0, _mm_unpacklo_epi64(b0, b1));
+                _mm_storeu_si128(dst1, _mm_unpackhi_epi64(b0, b1));
+            } else {
+                const __m128i r0 = _mm_loadu_si128(dst0);
+                const __m128i r1 = _mm_loadu_si128(dst1);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(block0), _mm_unpacklo_epi64(r0, r1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(block1), _mm_unpackhi_epi64(r0, r1));
+            }
+        }
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
+template <bool morton_to_linear>
+static TileFunc GetTileFunc(u32 bytes_per_pixel) {
+    switch (bytes_per_pixel) {
+    case 1:
+        return CopyTile<1, morton_to_linear>;
+    case 2:
+#ifdef ARCHITECTURE_x86_64
+        return CopyTile16BitSSE2<morton_to_linear>;
+#else
+        return CopyTile<2, morton_to_linear>;
+#endif
+    case 3:
+        return CopyTile<3, morton_to_linear>;
+    case 4:
+#ifdef ARCHITECTURE_x86_64
+        return CopyTile32BitSSE2<morton_to_linear>;
+#else
+        return CopyTile<4, morton_to_linear>;
+#endif
+    default:
+        UNREACHABLE_MSG("Unsupported pixel size %u", bytes_per_pixel);
+    }
+}
+
+static TileFunc GetTileFunc(bool morton_to_linear, u32 bytes_per_pixel) {
+    return morton_to_linear ? GetTileFunc<true>(bytes_per_pixel)
+                            : GetTileFunc<false>(bytes_per_pixel);
+}
+
+void MortonCopyTile(bool morton_to_linear, u32 bytes_per_pixel, u8* tile_data, u8* linear_data,
+                    s32 linear_stride) {
+    GetTileFunc(morton_to_linear, bytes_per_pixel)(tile_data, linear_data, linear_stride);
+}
+
+void MortonCopySurface(bool morton_to_linear, u32 bytes_per_pixel, u32 width, u32 height,
+                       u8* morton_data, u32 morton_stride, u8* linear_data, s32 linear_stride) {
+    DEBUG_ASSERT(width % 8 == 0 && height % 8 == 0);
+
+    const TileFunc copy_tile = GetTileFunc(morton_to_linear, bytes_per_pixel);
+    const u32 tile_size = 8 * 8 * bytes_per_pixel;
+
+    for (u32 y = 0; y < height; y += 8) {
+        u8* tile = morton_data + y * morton_stride;
+        u8* linear = linear_data + static_cast<s32>(y) * linear_stride;
+
+        for (u32 x = 0; x < width; x += 8) {
+            copy_tile(tile, linear, linear_stride);
+            tile += tile_size;
+            linear += 8 * bytes_per_pixel;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,38 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+namespace VideoCore {
+
+/**
+ * Converts a single 8x8 tile between Morton order (see GetMortonOffset) and linear rows.
+ * @param morton_to_linear Direction of the copy
+ * @param bytes_per_pixel Size of a pixel, 1 to 4 bytes; depth formats use their storage size
+ * @param tile_data The 64 pixels of the tile, in Morton order
+ * @param linear_data First pixel of the tile's first row in the linear image
+ * @param linear_stride Distance in bytes between linear rows, negative for bottom-up images
+ */
+void MortonCopyTile(bool morton_to_linear, u32 bytes_per_pixel, u8* tile_data, u8* linear_data,
+                    s32 linear_stride);
+
+/**
+ * Converts a whole image between tiled and linear layout. Both width and height must be
+ * multiples of 8.
+ * @param morton_to_linear Direction of the copy
+ * @param bytes_per_pixel Size of a pixel, 1 to 4 bytes; depth formats use their storage size
+ * @param width Width of the region to copy in pixels
+ * @param height Height of the region to copy in pixels
+ * @param morton_data The tiled image
+ * @param morton_stride Size in bytes of a pixel row of the tiled image (image width times
+ *                      bytes_per_pixel), so that rows of tiles are 8 * morton_stride bytes apart
+ * @param linear_data First pixel of the first row in the linear image
+ * @param linear_stride Distance in bytes between linear rows, negative for bottom-up images
+ */
+void MortonCopySurface(bool morton_to_linear, u32 bytes_per_pixel, u32 width, u32 height,
+                       u8* morton_data, u32 morton_stride, u8* linear_data, s32 linear_stride);
+
+} // namespace
@@ -6,10 +6,13 @@
 #include <iterator>
 #include <unordered_map>
 #include <utility>
+#include "video_core/command_processor.h"
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
 #include "video_core/primitive_assembly.h"
+#include "video_core/rasterizer.h"
 #include "video_core/shader/shader.h"
+#include "video_core/vertex_loader.h"
 
 namespace Pica {
 
@@ -496,10 +499,13 @@ std::string Regs::GetCommandName(int index) {
 
 void Init() {
     g_state.Reset();
+    CommandProcessor::InvalidateVertexCache();
 }
 
 void Shutdown() {
     Shader::ClearCache();
+    VertexLoader::ClearCache();
+    Rasterizer::ClearTextureCache();
 }
 
 template <typename T>
@@ -5,7 +5,9 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include "common/bit_field.h"
+#include "common/bit_set.h"
 #include "common/common_types.h"
 #include "video_core/pica.h"
 #include "video_core/primitive_assembly.h"
@@ -20,6 +22,37 @@ struct State {
     /// Pica registers
     Regs regs;
 
+    /// Set of registers, used to track which ones were written since a consumer last looked
+    struct RegisterSet {
+        void Set(size_t id) {
+            words[id / 64] |= u64(1) << (id % 64);
+        }
+
+        void SetRange(size_t first_id, size_t count) {
+            for (size_t id = first_id; id < first_id + count; ++id)
+                Set(id);
+        }
+
+        /// Calls `func` with the index of each register in the set in ascending order, and
+        /// empties the set
+        template <typename Func>
+        void Consume(Func&& func) {
+            for (size_t i = 0; i < words.size(); ++i) {
+                u64 word = words[i];
+                words[i] = 0;
+                while (word != 0) {
+                    func(static_cast<u32>(i * 64 + Common::LeastSignificantSetBit(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+
+        std::array<u64, (Regs::NumIds() + 63) / 64> words{};
+    };
+
+    /// Registers written since the rasterizer last synchronized its state with them
+    RegisterSet dirty_regs;
+
     Shader::UnitState<false> shader_units[4];
 
     Shader::ShaderSetup vs;
@@ -44,6 +77,9 @@ struct State {
         };
 
         std::array<std::array<LutEntry, 256>, 24> luts;
+
+        /// Bit i is set if luts[i] was written since the rasterizer last synchronized it
+        u32 dirty_luts = 0;
     } lighting;
 
     struct {
@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <iterator>
+#include <memory>
+#include <vector>
 #include "common/assert.h"
 #include "common/bit_field.h"
 #include "common/color.h"
@@ -12,6 +15,7 @@
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 #include "core/hw/gpu.h"
 #include "core/memory.h"
@@ -21,8 +25,13 @@
 #include "video_core/pica_types.h"
 #include "video_core/rasterizer.h"
 #include "video_core/shader/shader.h"
+#include "video_core/texture_cache.h"
 #include "video_core/utils.h"
 
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
 namespace Pica {
 
 namespace Rasterizer {
@@ -303,6 +312,52 @@ static int SignedArea(const Math::Vec2<Fix12P4>& vtx1, const Math::Vec2<Fix12P4>
 
 MICROPROFILE_DEFINE(GPU_Rasterization, "GPU", "Rasterization", MP_RGB(50, 50, 240));
 
+/// Triangle data computed once at setup time and shared by all tiles the triangle touches.
+struct TriangleSetup {
+    // Vertices in counter-clockwise order
+    Shader::OutputVertex v0;
+    Shader::OutputVertex v1;
+    Shader::OutputVertex v2;
+
+    // Vertex positions in rasterizer coordinates
+    std::array<Math::Vec2<int>, 3> vtxpos;
+
+    // Fill rule biases added to the barycentric coordinates w0, w1 and w2
+    std::array<int, 3> bias;
+
+    // Pixel-aligned bounding box in 12.4 fixed point, clipped to the scissor box in Include mode
+    u16 min_x;
+    u16 min_y;
+    u16 max_x;
+    u16 max_y;
+};
+
+// Triangles waiting to be rasterized, in submission order
+static std::vector<TriangleSetup> queued_triangles;
+// Indices into queued_triangles of the triangles overlapping each tile, in submission order
+static std::vector<std::vector<u32>> tile_bins;
+
+static TextureCache texture_cache;
+// Decoded textures of each texture unit, looked up once per batch of queued triangles
+static std::array<std::shared_ptr<const DecodedTexture>, 3> active_textures;
+
+// Texture unit registers that active_textures were looked up with
+struct TextureUnitState {
+    bool enabled;
+    u32 address;
+    u32 width;
+    u32 height;
+    Regs::TextureFormat format;
+
+    bool operator==(const TextureUnitState& other) const {
+        return enabled == other.enabled && address == other.address && width == other.width &&
+               height == other.height && format == other.format;
+    }
+};
+static std::array<TextureUnitState, 3> active_texture_units{};
+// Texture cache generation that active_textures were looked up at
+static u64 active_textures_generation = 0;
+
 /**
  * Helper function for ProcessTriangle with the "reversed" flag to allow for implementing
  * culling via recursion.
@@ -310,7 +365,6 @@ MICROPROFILE_DEFINE(GPU_Rasterization, "GPU", "Rasterization", MP_RGB(50, 50, 24
 static void ProcessTriangleInternal(const Shader::OutputVertex& v0, const Shader::OutputVertex& v1,
                                     const Shader::OutputVertex& v2, bool reversed = false) {
     const auto& regs = g_state.regs;
-    MICROPROFILE_SCOPE(GPU_Rasterization);
 
     // vertex positions in rasterizer coordinates
     static auto FloatToFix = [](float24 flt) {
@@ -349,14 +403,14 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0, const Shader
     u16 max_x = std::max({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x});
     u16 max_y = std::max({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y});
 
-    // Convert the scissor box coordinates to 12.4 fixed point
-    u16 scissor_x1 = (u16)(regs.scissor_test.x1 << 4);
-    u16 scissor_y1 = (u16)(regs.scissor_test.y1 << 4);
-    // x2,y2 have +1 added to cover the entire sub-pixel area
-    u16 scissor_x2 = (u16)((regs.scissor_test.x2 + 1) << 4);
-    u16 scissor_y2 = (u16)((regs.scissor_test.y2 + 1) << 4);
-
     if (regs.scissor_test.mode == Regs::ScissorMode::Include) {
+        // Convert the scissor box coordinates to 12.4 fixed point
+        u16 scissor_x1 = (u16)(regs.scissor_test.x1 << 4);
+        u16 scissor_y1 = (u16)(regs.scissor_test.y1 << 4);
+        // x2,y2 have +1 added to cover the entire sub-pixel area
+        u16 scissor_x2 = (u16)((regs.scissor_test.x2 + 1) << 4);
+        u16 scissor_y2 = (u16)((regs.scissor_test.y2 + 1) << 4);
+
         // Calculate the new bounds
         min_x = std::max(min_x, scissor_x1);
         min_y = std::max(min_y, scissor_y1);
@@ -369,6 +423,9 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0, const Shader
     max_x = ((max_x + Fix12P4::FracMask()) & Fix12P4::IntMask());
     max_y = ((max_y + Fix12P4::FracMask()) & Fix12P4::IntMask());
 
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
     // Triangle filling rules: Pixels on the right-sided edge or on flat bottom edges are not
     // drawn. Pixels on any other triangle border are drawn. This is implemented with three bias
     // values which are added to the barycentric coordinates w0, w1 and w2, respectively.
@@ -387,12 +444,190 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0, const Shader
                                         ((int)line2.y - (int)line1.y);
         }
     };
-    int bias0 =
+
+    queued_triangles.emplace_back();
+    TriangleSetup& triangle = queued_triangles.back();
+    triangle.v0 = v0;
+    triangle.v1 = v1;
+    triangle.v2 = v2;
+    for (int i = 0; i < 3; ++i) {
+        triangle.vtxpos[i] = Math::MakeVec<int>(vtxpos[i].x, vtxpos[i].y);
+    }
+    triangle.bias[0] =
         IsRightSideOrFlatBottomEdge(vtxpos[0].xy(), vtxpos[1].xy(), vtxpos[2].xy()) ? -1 : 0;
-    int bias1 =
+    triangle.bias[1] =
         IsRightSideOrFlatBottomEdge(vtxpos[1].xy(), vtxpos[2].xy(), vtxpos[0].xy()) ? -1 : 0;
-    int bias2 =
+    triangle.bias[2] =
         IsRightSideOrFlatBottomEdge(vtxpos[2].xy(), vtxpos[0].xy(), vtxpos[1].xy()) ? -1 : 0;
+    triangle.min_x = min_x;
+    triangle.min_y = min_y;
+    triangle.max_x = max_x;
+    triangle.max_y = max_y;
+}
+
+bool ComputeBlockCoverage(const std::array<Math::Vec2<int>, 3>& vtxpos,
+                          const std::array<int, 3>& bias, u16 min_x, u16 min_y, u16 max_x,
+                          u16 max_y, BlockCoverage& coverage) {
+    const int num_columns = (max_x - min_x) >> 4;
+    const int num_rows = (max_y - min_y) >> 4;
+    if (num_columns <= 0 || num_rows <= 0)
+        return false;
+    DEBUG_ASSERT(num_columns <= TILE_SIZE && num_rows <= TILE_SIZE);
+
+    // Pixel centers of the block corners
+    const int first_x = min_x + 8;
+    const int first_y = min_y + 8;
+    const int last_x = max_x - 8;
+    const int last_y = max_y - 8;
+
+    // Each barycentric coordinate is the signed area spanned by an edge and the pixel center.
+    // That is an affine function of the pixel position, so it is evaluated exactly once per block
+    // and then stepped by constant per-pixel increments.
+    int origin[3];
+    int step_x[3];
+    int step_y[3];
+    bool all_covered = true;
+    for (int i = 0; i < 3; ++i) {
+        const auto& vtx1 = vtxpos[(i + 1) % 3];
+        const auto& vtx2 = vtxpos[(i + 2) % 3];
+        auto Evaluate = [&](int x, int y) {
+            return bias[i] + (vtx2.x - vtx1.x) * (y - vtx1.y) - (vtx2.y - vtx1.y) * (x - vtx1.x);
+        };
+
+        origin[i] = Evaluate(first_x, first_y);
+        step_x[i] = (vtx1.y - vtx2.y) * 0x10;
+        step_y[i] = (vtx2.x - vtx1.x) * 0x10;
+
+        // The extrema of an affine function over a rectangle lie on its corners, so the corners
+        // tell whether the block is entirely outside or entirely inside this edge.
+        const int corners[4] = {origin[i], Evaluate(last_x, first_y), Evaluate(first_x, last_y),
+                                Evaluate(last_x, last_y)};
+        if (*std::max_element(std::begin(corners), std::end(corners)) < 0)
+            return false;
+        if (*std::min_element(std::begin(corners), std::end(corners)) < 0)
+            all_covered = false;
+    }
+
+    u8 any_covered = 0;
+
+#ifdef ARCHITECTURE_x86_64
+    const u8 columns_mask = static_cast<u8>((1 << num_columns) - 1);
+
+    // Evaluate each row as two vectors of four pixels
+    __m128i row_lo[3];
+    __m128i row_hi[3];
+    __m128i row_step[3];
+    for (int i = 0; i < 3; ++i) {
+        row_lo[i] = _mm_setr_epi32(origin[i], origin[i] + step_x[i], origin[i] + 2 * step_x[i],
+                                   origin[i] + 3 * step_x[i]);
+        row_hi[i] = _mm_add_epi32(row_lo[i], _mm_set1_epi32(4 * step_x[i]));
+        row_step[i] = _mm_set1_epi32(step_y[i]);
+    }
+
+    for (int row = 0; row < num_rows; ++row) {
+        for (int i = 0; i < 3; ++i) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&coverage.w[i][row][0]), row_lo[i]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&coverage.w[i][row][4]), row_hi[i]);
+        }
+
+        u8 mask = columns_mask;
+        if (!all_covered) {
+            // A pixel is covered if none of its barycentric coordinates has the sign bit set
+            const __m128i any_negative_lo =
+                _mm_or_si128(_mm_or_si128(row_lo[0], row_lo[1]), row_lo[2]);
+            const __m128i any_negative_hi =
+                _mm_or_si128(_mm_or_si128(row_hi[0], row_hi[1]), row_hi[2]);
+            const int negative = _mm_movemask_ps(_mm_castsi128_ps(any_negative_lo)) |
+                                 (_mm_movemask_ps(_mm_castsi128_ps(any_negative_hi)) << 4);
+            mask &= static_cast<u8>(~negative);
+        }
+        coverage.row_mask[row] = mask;
+        any_covered |= mask;
+
+        for (int i = 0; i < 3; ++i) {
+            row_lo[i] = _mm_add_epi32(row_lo[i], row_step[i]);
+            row_hi[i] = _mm_add_epi32(row_hi[i], row_step[i]);
+        }
+    }
+#else
+    int row_start[3] = {origin[0], origin[1], origin[2]};
+    for (int row = 0; row < num_rows; ++row) {
+        int w[3] = {row_start[0], row_start[1], row_start[2]};
+        u8 mask = 0;
+        for (int column = 0; column < num_columns; ++column) {
+            for (int i = 0; i < 3; ++i) {
+                coverage.w[i][row][column] = w[i];
+            }
+            if (all_covered || (w[0] | w[1] | w[2]) >= 0)
+                mask |= 1 << column;
+            for (int i = 0; i < 3; ++i) {
+                w[i] += step_x[i];
+            }
+        }
+        coverage.row_mask[row] = mask;
+        any_covered |= mask;
+
+        for (int i = 0; i < 3; ++i) {
+            row_start[i] += step_y[i];
+        }
+    }
+#endif
+
+    return any_covered != 0;
+}
+
+TileBounds GetTileBounds(int tile_x, int tile_y, int width, int last_row) {
+    // Convert the tile's memory rows back to rasterizer rows
+    const int first_row = tile_y << TILE_SIZE_BITS;
+    const int end_row = std::min(first_row + TILE_SIZE, last_row + 1);
+
+    TileBounds bounds;
+    bounds.min_x = static_cast<u16>((tile_x << TILE_SIZE_BITS) << 4);
+    bounds.max_x = static_cast<u16>(std::min((tile_x + 1) << TILE_SIZE_BITS, width) << 4);
+    bounds.min_y = static_cast<u16>((last_row - (end_row - 1)) << 4);
+    bounds.max_y = static_cast<u16>((last_row - first_row + 1) << 4);
+    return bounds;
+}
+
+/**
+ * Shades the pixels of a triangle that lie within the given tile. Tiles never share pixels, so
+ * different tiles may be processed concurrently.
+ */
+static void RasterizeTriangle(const TriangleSetup& triangle, const TileBounds& tile) {
+    const auto& regs = g_state.regs;
+
+    const auto& v0 = triangle.v0;
+    const auto& v1 = triangle.v1;
+    const auto& v2 = triangle.v2;
+
+    const u16 min_x = std::max(triangle.min_x, tile.min_x);
+    const u16 min_y = std::max(triangle.min_y, tile.min_y);
+    const u16 max_x = std::min(triangle.max_x, tile.max_x);
+    const u16 max_y = std::min(triangle.max_y, tile.max_y);
+
+    // Convert the scissor box coordinates to 12.4 fixed point
+    u16 scissor_x1 = (u16)(regs.scissor_test.x1 << 4);
+    u16 scissor_y1 = (u16)(regs.scissor_test.y1 << 4);
+    // x2,y2 have +1 added to cover the entire sub-pixel area
+    u16 scissor_x2 = (u16)((regs.scissor_test.x2 + 1) << 4);
+    u16 scissor_y2 = (u16)((regs.scissor_test.y2 + 1) << 4);
+
+    // In Exclude mode, the scissor box only needs to be tested per pixel if it partially
+    // overlaps the block
+    bool scissor_exclude = regs.scissor_test.mode == Regs::ScissorMode::Exclude;
+    if (scissor_exclude) {
+        if (min_x >= scissor_x1 && max_x <= scissor_x2 && min_y >= scissor_y1 &&
+            max_y <= scissor_y2)
+            return;
+        if (max_x <= scissor_x1 || min_x >= scissor_x2 || max_y <= scissor_y1 ||
+            min_y >= scissor_y2)
+            scissor_exclude = false;
+    }
+
+    BlockCoverage coverage;
+    if (!ComputeBlockCoverage(triangle.vtxpos, triangle.bias, min_x, min_y, max_x, max_y,
+                              coverage))
+        return;
 
     auto w_inverse = Math::MakeVec(v0.pos.w, v1.pos.w, v2.pos.w);
 
@@ -406,25 +641,30 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0, const Shader
     // Enter rasterization loop, starting at the center of the topleft bounding box corner.
     // TODO: Not sure if looping through x first might be faster
     for (u16 y = min_y + 8; y < max_y; y += 0x10) {
+        const int row = (y - min_y) >> 4;
+        if (coverage.row_mask[row] == 0)
+            continue;
+
         for (u16 x = min_x + 8; x < max_x; x += 0x10) {
+            const int column = (x - min_x) >> 4;
+
+            // If current pixel is not covered by the current primitive
+            if ((coverage.row_mask[row] & (1 << column)) == 0)
+                continue;
 
             // Do not process the pixel if it's inside the scissor box and the scissor mode is set
             // to Exclude
-            if (regs.scissor_test.mode == Regs::ScissorMode::Exclude) {
+            if (scissor_exclude) {
                 if (x >= scissor_x1 && x < scissor_x2 && y >= scissor_y1 && y < scissor_y2)
                     continue;
             }
 
-            // Calculate the barycentric coordinates w0, w1 and w2
-            int w0 = bias0 + SignedArea(vtxpos[1].xy(), vtxpos[2].xy(), {x, y});
-            int w1 = bias1 + SignedArea(vtxpos[2].xy(), vtxpos[0].xy(), {x, y});
-            int w2 = bias2 + SignedArea(vtxpos[0].xy(), vtxpos[1].xy(), {x, y});
+            // Barycentric coordinates w0, w1 and w2
+            int w0 = coverage.w[0][row][column];
+            int w1 = coverage.w[1][row][column];
+            int w2 = coverage.w[2][row][column];
             int wsum = w0 + w1 + w2;
 
-            // If current pixel is not covered by the current primitive
-            if (w0 < 0 || w1 < 0 || w2 < 0)
-                continue;
-
             auto baricentric_coordinates =
                 Math::MakeVec(float24::FromFloat32(static_cast<float>(w0)),
                               float24::FromFloat32(static_cast<float>(w1)),
@@ -576,15 +816,13 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0, const Shader
                     t = texture.config.height - 1 -
                         GetWrappedTexCoord(texture.config.wrap_t, t, texture.config.height);
 
-                    u8* texture_data =
-                        Memory::GetPhysicalPointer(texture.config.GetPhysicalAddress());
-                    auto info =
-                        DebugUtils::TextureInfo::FromPicaRegister(texture.config, texture.format);
-
                     // TODO: Apply the min and mag filters to the texture
-                    texture_color[i] = DebugUtils::LookupTexture(texture_data, s, t, info);
+                    if (active_textures[i] != nullptr)
+                        texture_color[i] = active_textures[i]->Lookup(s, t);
 #if PICA_DUMP_TEXTURES
-                    DebugUtils::DumpTexture(texture.config, texture_data);
+                    DebugUtils::DumpTexture(
+                        texture.config,
+                        Memory::GetPhysicalPointer(texture.config.GetPhysicalAddress()));
 #endif
                 }
             }
@@ -1281,6 +1519,105 @@ void ProcessTriangle(const Shader::OutputVertex& v0, const Shader::OutputVertex&
     ProcessTriangleInternal(v0, v1, v2);
 }
 
+void DrawQueuedTriangles(Common::ThreadPool& thread_pool, size_t max_threads) {
+    if (queued_triangles.empty())
+        return;
+
+    MICROPROFILE_SCOPE(GPU_Rasterization);
+
+    // Texture registers can't change while triangles are queued. Textures only need to be looked
+    // up again if the registers changed or the cache dropped any since the last batch.
+    const auto textures = g_state.regs.GetTextures();
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const TextureUnitState state = {textures[i].enabled, textures[i].config.address,
+                                        textures[i].config.width, textures[i].config.height,
+                                        textures[i].format};
+        if (state == active_texture_units[i] &&
+            active_textures_generation == texture_cache.GetGeneration())
+            continue;
+
+        active_textures[i] =
+            state.enabled ? texture_cache.GetTexture(textures[i].config, textures[i].format)
+                          : nullptr;
+        active_texture_units[i] = state;
+    }
+    active_textures_generation = texture_cache.GetGeneration();
+
+    const auto& framebuffer = g_state.regs.framebuffer;
+    const int width = framebuffer.GetWidth();
+    // DrawPixel stores rasterizer row y in memory row last_row - y
+    const int last_row = framebuffer.height;
+
+    // Tile rows are counted in memory order, which is flipped vertically compared to rasterizer
+    // coordinates, so that tiles line up with the Morton blocks of the framebuffer
+    const int tiles_x = (width + TILE_SIZE - 1) >> TILE_SIZE_BITS;
+    const int tiles_y = (last_row >> TILE_SIZE_BITS) + 1;
+    const size_t num_tiles = static_cast<size_t>(tiles_x * tiles_y);
+    if (tile_bins.size() < num_tiles)
+        tile_bins.resize(num_tiles);
+
+    // Bin triangles by bounding box. Only tiles within the framebuffer are used, and tile bounds
+    // leave out pixels beyond its edges, which DrawPixel doesn't check for.
+    std::vector<u32> active_tiles;
+    for (u32 index = 0; index < queued_triangles.size(); ++index) {
+        const TriangleSetup& triangle = queued_triangles[index];
+
+        const int x_begin = triangle.min_x >> 4;
+        const int x_end = std::min<int>(triangle.max_x >> 4, width);
+        const int y_begin = triangle.min_y >> 4;
+        const int y_end = std::min<int>(triangle.max_y >> 4, last_row + 1);
+        if (x_begin >= x_end || y_begin >= y_end)
+            continue;
+
+        const int tile_x_begin = x_begin >> TILE_SIZE_BITS;
+        const int tile_x_end = ((x_end - 1) >> TILE_SIZE_BITS) + 1;
+        const int tile_y_begin = (last_row - (y_end - 1)) >> TILE_SIZE_BITS;
+        const int tile_y_end = ((last_row - y_begin) >> TILE_SIZE_BITS) + 1;
+
+        for (int tile_y = tile_y_begin; tile_y < tile_y_end; ++tile_y) {
+            for (int tile_x = tile_x_begin; tile_x < tile_x_end; ++tile_x) {
+                const u32 tile = tile_y * tiles_x + tile_x;
+                if (tile_bins[tile].empty())
+                    active_tiles.push_back(tile);
+                tile_bins[tile].push_back(index);
+            }
+        }
+    }
+
+    thread_pool.ParallelFor(active_tiles.size(), [&](size_t i) {
+        const u32 tile = active_tiles[i];
+        const TileBounds bounds = GetTileBounds(tile % tiles_x, tile / tiles_x, width, last_row);
+        for (u32 index : tile_bins[tile]) {
+            RasterizeTriangle(queued_triangles[index], bounds);
+        }
+        tile_bins[tile].clear();
+    }, max_threads);
+
+    queued_triangles.clear();
+    if (active_tiles.empty())
+        return;
+
+    // Textures decoded from the render targets are out of date now
+    const u32 num_pixels = static_cast<u32>(width * (last_row + 1));
+    if (framebuffer.allow_color_write != 0) {
+        InvalidateTextureRegion(framebuffer.GetColorBufferPhysicalAddress(),
+                                num_pixels * Regs::BytesPerColorPixel(framebuffer.color_format));
+    }
+    if (framebuffer.allow_depth_stencil_write != 0) {
+        InvalidateTextureRegion(framebuffer.GetDepthBufferPhysicalAddress(),
+                                num_pixels * Regs::BytesPerDepthPixel(framebuffer.depth_format));
+    }
+}
+
+void InvalidateTextureRegion(PAddr addr, u32 size) {
+    texture_cache.InvalidateRegion(addr, size);
+}
+
+void ClearTextureCache() {
+    active_textures = {};
+    texture_cache.Clear();
+}
+
 } // namespace Rasterizer
 
 } // namespace Pica
@@ -4,6 +4,14 @@
 
 #pragma once
 
+#include <array>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+
+namespace Common {
+class ThreadPool;
+}
+
 namespace Pica {
 
 namespace Shader {
@@ -12,9 +20,73 @@ struct OutputVertex;
 
 namespace Rasterizer {
 
+// Screen tiles are 8x8 pixels, matching the Morton-ordered blocks the framebuffer is stored in
+constexpr int TILE_SIZE_BITS = 3;
+constexpr int TILE_SIZE = 1 << TILE_SIZE_BITS;
+
+/// Triangle coverage of a block of at most TILE_SIZE x TILE_SIZE pixels.
+struct BlockCoverage {
+    /// Bit x of row_mask[y] is set if pixel (x, y), relative to the block origin, is covered
+    std::array<u8, TILE_SIZE> row_mask;
+    /// Barycentric coordinates w0, w1 and w2 (including fill rule biases) of each pixel
+    int w[3][TILE_SIZE][TILE_SIZE];
+};
+
+/// Screen region covered by one tile, as pixel-aligned 12.4 fixed point bounds.
+struct TileBounds {
+    u16 min_x;
+    u16 min_y;
+    u16 max_x;
+    u16 max_y;
+};
+
+/**
+ * Returns the rasterizer coordinates covered by a tile. Tiles are placed on the framebuffer's
+ * 8x8 Morton blocks, which are laid out from bottom to top: rasterizer row y is stored in memory
+ * row `last_row - y`, so tile row tile_y covers memory rows TILE_SIZE * tile_y and up. Pixels
+ * outside of the framebuffer are left out of the bounds.
+ * @param width Framebuffer width in pixels
+ * @param last_row Framebuffer height register, which holds the height in pixels minus one
+ */
+TileBounds GetTileBounds(int tile_x, int tile_y, int width, int last_row);
+
+/**
+ * Evaluates the edge functions of a triangle at the pixel centers of a block. Only the entries
+ * of covered pixels are guaranteed to be written.
+ * @param vtxpos Counter-clockwise vertex positions in 12.4 fixed point rasterizer coordinates
+ * @param bias Fill rule biases added to w0, w1 and w2
+ * @param min_x,min_y,max_x,max_y Pixel-aligned block bounds in 12.4 fixed point
+ * @param coverage Receives the coverage masks and barycentric coordinates
+ * @return false if no pixel in the block is covered
+ */
+bool ComputeBlockCoverage(const std::array<Math::Vec2<int>, 3>& vtxpos,
+                          const std::array<int, 3>& bias, u16 min_x, u16 min_y, u16 max_x,
+                          u16 max_y, BlockCoverage& coverage);
+
+/**
+ * Sets up a triangle and queues it for rasterization. Queued triangles are drawn by the next call
+ * to DrawQueuedTriangles, which must happen before any Pica register changes.
+ */
 void ProcessTriangle(const Shader::OutputVertex& v0, const Shader::OutputVertex& v1,
                      const Shader::OutputVertex& v2);
 
+/**
+ * Rasterizes all queued triangles. The framebuffer is split into 8x8 pixel tiles, each triangle is
+ * binned into the tiles its bounding box overlaps and tiles are shaded in parallel on up to
+ * max_threads threads of the given pool (0 for all of them). Within a tile, triangles are drawn in
+ * the order they were queued.
+ */
+void DrawQueuedTriangles(Common::ThreadPool& thread_pool, size_t max_threads);
+
+/**
+ * Drops decoded textures overlapping the given region of physical memory. Must not be called
+ * while triangles are queued.
+ */
+void InvalidateTextureRegion(PAddr addr, u32 size);
+
+/// Drops all decoded textures. Must not be called while triangles are queued.
+void ClearTextureCache();
+
 } // namespace Rasterizer
 
 } // namespace Pica
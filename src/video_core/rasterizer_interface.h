@@ -29,8 +29,18 @@ public:
     /// Draw the current batch of triangles
     virtual void DrawTriangles() = 0;
 
-    /// Notify rasterizer that the specified PICA register has been changed
-    virtual void NotifyPicaRegisterChanged(u32 id) = 0;
+    /**
+     * Notify rasterizer that PICA registers are about to be changed after triangles have been
+     * submitted to it. Registers written since the last draw are marked in
+     * Pica::State::dirty_regs, for rasterizers that synchronize their state lazily.
+     */
+    virtual void NotifyPicaRegistersChanging() {}
+
+    /**
+     * Notify rasterizer that a title is being loaded, so that it can open the on-disk caches of
+     * that title. No caches are used for program ID 0 (e.g. homebrew).
+     */
+    virtual void LoadDiskCache(u64 program_id) {}
 
     /// Notify rasterizer that all caches should be flushed to 3DS memory
     virtual void FlushAll() = 0;
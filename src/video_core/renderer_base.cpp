@@ -19,5 +19,12 @@ void RendererBase::RefreshRasterizerSetting() {
         } else {
             rasterizer = std::make_unique<VideoCore::SWRasterizer>();
         }
+        rasterizer->LoadDiskCache(program_id);
     }
 }
+
+void RendererBase::LoadDiskCache(u64 program_id) {
+    this->program_id = program_id;
+    if (rasterizer != nullptr)
+        rasterizer->LoadDiskCache(program_id);
+}
@@ -49,6 +49,9 @@ public:
 
     void RefreshRasterizerSetting();
 
+    /// Opens the on-disk caches of the given title in the current rasterizer and any later one
+    void LoadDiskCache(u64 program_id);
+
 protected:
     std::unique_ptr<VideoCore::RasterizerInterface> rasterizer;
     f32 m_current_fps = 0.0f; ///< Current framerate, should be set by the renderer
@@ -56,4 +59,5 @@ protected:
 
 private:
     bool opengl_rasterizer_active = false;
+    u64 program_id = 0; ///< Title whose disk caches the rasterizer uses
 };
@@ -0,0 +1,193 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <memory>
+#include "common/color.h"
+#include "common/emu_window.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/profiler_reporting.h"
+#include "common/string_util.h"
+#include "common/synchronized_wrapper.h"
+#include "core/hw/gpu.h"
+#include "core/hw/hw.h"
+#include "core/hw/lcd.h"
+#include "core/memory.h"
+#include "core/tracer/recorder.h"
+#include "video_core/debug_utils/debug_utils.h"
+#include "video_core/renderer_headless/renderer_headless.h"
+#include "video_core/swrasterizer.h"
+#include "video_core/video_core.h"
+
+RendererHeadless::RendererHeadless() : image(kImageWidth * kImageHeight * 3) {}
+
+RendererHeadless::~RendererHeadless() = default;
+
+void RendererHeadless::SwapBuffers() {
+    // Top screen (left eye) at the top, bottom screen centered below it
+    const int offsets[2][2] = {
+        {0, 0}, {(kImageWidth - VideoCore::kScreenBottomWidth) / 2, VideoCore::kScreenTopHeight},
+    };
+    const int widths[2] = {VideoCore::kScreenTopWidth, VideoCore::kScreenBottomWidth};
+    const int heights[2] = {VideoCore::kScreenTopHeight, VideoCore::kScreenBottomHeight};
+
+    for (int i : {0, 1}) {
+        const auto& framebuffer = GPU::g_regs.framebuffer_config[i];
+
+        // Main LCD (0): 0x1ED02204, Sub LCD (1): 0x1ED02A04
+        u32 lcd_color_addr =
+            (i == 0) ? LCD_REG_INDEX(color_fill_top) : LCD_REG_INDEX(color_fill_bottom);
+        lcd_color_addr = HW::VADDR_LCD + 4 * lcd_color_addr;
+        LCD::Regs::ColorFill color_fill = {0};
+        LCD::Read(color_fill.raw, lcd_color_addr);
+
+        if (color_fill.is_enabled) {
+            FillScreen(offsets[i][0], offsets[i][1], widths[i], heights[i], color_fill.color_r,
+                       color_fill.color_g, color_fill.color_b);
+        } else {
+            PresentScreen(framebuffer, offsets[i][0], offsets[i][1]);
+        }
+    }
+
+    const int dump_interval = VideoCore::g_headless_frame_dump_interval;
+    if (dump_interval > 0 && m_current_frame % dump_interval == 0) {
+        DumpImage();
+    }
+
+    m_current_frame++;
+    UpdateFramerate();
+
+    auto& profiler = Common::Profiling::GetProfilingManager();
+    profiler.FinishFrame();
+    {
+        auto aggregator = Common::Profiling::GetTimingResultsAggregator();
+        aggregator->AddFrame(profiler.GetPreviousFrameResults());
+    }
+
+    render_window->PollEvents();
+    render_window->SwapBuffers();
+
+    profiler.BeginFrame();
+
+    if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
+        Pica::g_debug_context->recorder->FrameFinished();
+    }
+}
+
+void RendererHeadless::PresentScreen(const GPU::Regs::FramebufferConfig& framebuffer,
+                                     int offset_x, int offset_y) {
+    const PAddr framebuffer_addr =
+        framebuffer.active_fb == 0 ? framebuffer.address_left1 : framebuffer.address_left2;
+    if (framebuffer_addr == 0)
+        return;
+
+    const int bpp = GPU::Regs::BytesPerPixel(framebuffer.color_format);
+
+    // The framebuffer is stored rotated: each of its rows is a column of the screen
+    const int screen_width = std::min<int>(framebuffer.height, kImageWidth - offset_x);
+    const int screen_height = std::min<int>(framebuffer.width, kImageHeight - offset_y);
+
+    Memory::RasterizerFlushRegion(framebuffer_addr, framebuffer.stride * framebuffer.height);
+    const u8* framebuffer_data = Memory::GetPhysicalPointer(framebuffer_addr);
+    if (framebuffer_data == nullptr)
+        return;
+
+    for (int x = 0; x < screen_width; ++x) {
+        const u8* column = framebuffer_data + x * framebuffer.stride;
+        for (int y = 0; y < screen_height; ++y) {
+            const u8* pixel = column + (framebuffer.width - 1 - y) * bpp;
+
+            Math::Vec4<u8> color;
+            switch (framebuffer.color_format) {
+            case GPU::Regs::PixelFormat::RGBA8:
+                color = Color::DecodeRGBA8(pixel);
+                break;
+            case GPU::Regs::PixelFormat::RGB8:
+                color = Color::DecodeRGB8(pixel);
+                break;
+            case GPU::Regs::PixelFormat::RGB565:
+                color = Color::DecodeRGB565(pixel);
+                break;
+            case GPU::Regs::PixelFormat::RGB5A1:
+                color = Color::DecodeRGB5A1(pixel);
+                break;
+            case GPU::Regs::PixelFormat::RGBA4:
+                color = Color::DecodeRGBA4(pixel);
+                break;
+            default:
+                LOG_CRITICAL(Render_Software, "Unknown framebuffer color format %x",
+                             static_cast<u32>(framebuffer.color_format.Value()));
+                return;
+            }
+
+            u8* dest = &image[((offset_y + y) * kImageWidth + offset_x + x) * 3];
+            dest[0] = color.r();
+            dest[1] = color.g();
+            dest[2] = color.b();
+        }
+    }
+}
+
+void RendererHeadless::FillScreen(int offset_x, int offset_y, int width, int height, u8 r, u8 g,
+                                  u8 b) {
+    for (int y = offset_y; y < offset_y + height; ++y) {
+        for (int x = offset_x; x < offset_x + width; ++x) {
+            u8* dest = &image[(y * kImageWidth + x) * 3];
+            dest[0] = r;
+            dest[1] = g;
+            dest[2] = b;
+        }
+    }
+}
+
+void RendererHeadless::DumpImage() const {
+    const std::string dir = FileUtil::GetUserPath(D_DUMPFRAMES_IDX);
+    if (!FileUtil::CreateFullPath(dir)) {
+        LOG_ERROR(Render_Software, "Failed to create frame dump directory %s", dir.c_str());
+        return;
+    }
+
+    const std::string filename = dir + Common::StringFromFormat("frame_%06d.ppm", m_current_frame);
+    FileUtil::IOFile file(filename, "wb");
+    const std::string header =
+        Common::StringFromFormat("P6\n%d %d\n255\n", kImageWidth, kImageHeight);
+    if (file.WriteBytes(header.data(), header.size()) != header.size() ||
+        file.WriteBytes(image.data(), image.size()) != image.size()) {
+        LOG_ERROR(Render_Software, "Failed to write frame dump %s", filename.c_str());
+    }
+}
+
+void RendererHeadless::UpdateFramerate() {
+    const auto now = std::chrono::steady_clock::now();
+    frames_since_update++;
+
+    const std::chrono::duration<float> elapsed = now - last_update;
+    if (elapsed.count() >= 1.0f) {
+        m_current_fps = frames_since_update / elapsed.count();
+        LOG_INFO(Render_Software, "Frame %d: %.2f FPS", m_current_frame, m_current_fps);
+        frames_since_update = 0;
+        last_update = now;
+    }
+}
+
+/**
+ * Set the emulator window to use for renderer
+ * @param window EmuWindow handle to emulator window to use for rendering
+ */
+void RendererHeadless::SetWindow(EmuWindow* window) {
+    render_window = window;
+}
+
+/// Initialize the renderer
+bool RendererHeadless::Init() {
+    // The hardware rasterizer needs an OpenGL context, so this always uses the software one
+    rasterizer = std::make_unique<VideoCore::SWRasterizer>();
+    last_update = std::chrono::steady_clock::now();
+    LOG_INFO(Render_Software, "Using the headless renderer");
+    return true;
+}
+
+/// Shutdown the renderer
+void RendererHeadless::ShutDown() {}
@@ -0,0 +1,73 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include "common/common_types.h"
+#include "core/hw/gpu.h"
+#include "video_core/renderer_base.h"
+
+class EmuWindow;
+
+/**
+ * Renderer that needs no graphics context or display. It always uses the software rasterizer and
+ * presents both screens into an in-memory RGB image, which can optionally be dumped to disk.
+ */
+class RendererHeadless : public RendererBase {
+public:
+    /// Width of the presented image, which is the width of the top screen
+    static const int kImageWidth = 400;
+    /// Height of the presented image, with the bottom screen below the top screen
+    static const int kImageHeight = 2 * 240;
+
+    RendererHeadless();
+    ~RendererHeadless() override;
+
+    /// Swap buffers (render frame)
+    void SwapBuffers() override;
+
+    /**
+     * Set the emulator window to use for renderer
+     * @param window EmuWindow handle to emulator window to use for rendering
+     */
+    void SetWindow(EmuWindow* window) override;
+
+    /// Initialize the renderer
+    bool Init() override;
+
+    /// Shutdown the renderer
+    void ShutDown() override;
+
+    /// Returns the last presented frame as tightly packed RGB888 rows, from top to bottom
+    const std::vector<u8>& GetImage() const {
+        return image;
+    }
+
+private:
+    /**
+     * Copies a screen into the image, undoing the rotation of the framebuffer in memory
+     * @param framebuffer Framebuffer configuration of the screen
+     * @param offset_x Horizontal position of the screen in the image
+     * @param offset_y Vertical position of the screen in the image
+     */
+    void PresentScreen(const GPU::Regs::FramebufferConfig& framebuffer, int offset_x,
+                       int offset_y);
+
+    /// Fills the area of a screen in the image with a solid color
+    void FillScreen(int offset_x, int offset_y, int width, int height, u8 r, u8 g, u8 b);
+
+    /// Writes the image to a PPM file in the frame dump directory
+    void DumpImage() const;
+
+    void UpdateFramerate();
+
+    EmuWindow* render_window = nullptr; ///< Handle to render window
+
+    std::vector<u8> image;
+
+    int frames_since_update = 0;
+    std::chrono::steady_clock::time_point last_update;
+};
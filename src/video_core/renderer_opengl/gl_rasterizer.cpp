@@ -2,15 +2,21 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 #include <glad/glad.h>
 #include "common/assert.h"
 #include "common/color.h"
+#include "common/file_util.h"
 #include "common/logging/log.h"
 #include "common/math_util.h"
+#include "common/microprofile.h"
+#include "common/string_util.h"
 #include "common/vector_math.h"
 #include "core/hw/gpu.h"
 #include "video_core/pica.h"
@@ -18,6 +24,7 @@
 #include "video_core/renderer_opengl/gl_rasterizer.h"
 #include "video_core/renderer_opengl/gl_shader_gen.h"
 #include "video_core/renderer_opengl/gl_shader_util.h"
+#include "video_core/renderer_opengl/gl_stream_buffer.h"
 #include "video_core/renderer_opengl/pica_to_gl.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 
@@ -31,25 +38,62 @@ static bool IsPassThroughTevStage(const Pica::Regs::TevStageConfig& stage) {
             stage.GetColorMultiplier() == 1 && stage.GetAlphaMultiplier() == 1);
 }
 
-RasterizerOpenGL::RasterizerOpenGL() : shader_dirty(true) {
+MICROPROFILE_DEFINE(OpenGL_ShaderPrecompile, "OpenGL", "Shader Precompile", MP_RGB(100, 50, 200));
+
+/// Configurations compiled when a title boots are limited to the ones recorded most recently
+static constexpr size_t MAX_DISK_CACHE_SHADERS = 1024;
+
+void ShaderDiskCacheReader::Read(const u64& key, const u8* value, u32 value_size) {
+    if (value_size != sizeof(PicaShaderConfig::State)) {
+        LOG_WARNING(Render_OpenGL, "Skipping shader cache entry %016llX of size %u", key,
+                    value_size);
+        ++num_skipped;
+        return;
+    }
+
+    PicaShaderConfig config;
+    std::memcpy(&config.state, value, sizeof(PicaShaderConfig::State));
+    if (key != std::hash<PicaShaderConfig>()(config)) {
+        LOG_WARNING(Render_OpenGL, "Skipping shader cache entry %016llX with a stale key", key);
+        ++num_skipped;
+        return;
+    }
+
+    if (!seen.insert(config).second) {
+        ++num_skipped;
+        return;
+    }
+    configs.push_back(config);
+}
+
+void AppendShaderDiskCacheEntry(LinearDiskCache<u64, u8>& disk_cache,
+                                const PicaShaderConfig& config) {
+    disk_cache.Append(std::hash<PicaShaderConfig>()(config),
+                      reinterpret_cast<const u8*>(&config.state), sizeof(PicaShaderConfig::State));
+}
+
+static constexpr GLsizeiptr VERTEX_BUFFER_SIZE = 8 * 1024 * 1024;
+static constexpr GLsizeiptr UNIFORM_BUFFER_SIZE = 1024 * 1024;
+
+RasterizerOpenGL::RasterizerOpenGL()
+    : shader_dirty(true), vertex_buffer(GL_ARRAY_BUFFER, VERTEX_BUFFER_SIZE),
+      uniform_buffer(GL_UNIFORM_BUFFER, UNIFORM_BUFFER_SIZE) {
     // Create sampler objects
     for (size_t i = 0; i < texture_samplers.size(); ++i) {
         texture_samplers[i].Create();
         state.texture_units[i].sampler = texture_samplers[i].sampler.handle;
     }
 
-    // Generate VBO, VAO and UBO
-    vertex_buffer.Create();
+    // Generate VAO. The VBO and UBO are streamed into, and the UBO is bound to binding point 0
+    // at the offset of the latest uniform data when drawing.
     vertex_array.Create();
-    uniform_buffer.Create();
 
     state.draw.vertex_array = vertex_array.handle;
-    state.draw.vertex_buffer = vertex_buffer.handle;
-    state.draw.uniform_buffer = uniform_buffer.handle;
+    state.draw.vertex_buffer = vertex_buffer.GetHandle();
+    state.draw.uniform_buffer = uniform_buffer.GetHandle();
     state.Apply();
 
-    // Bind the UBO to binding point 0
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, uniform_buffer.handle);
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
 
     uniform_block_data.dirty = true;
 
@@ -168,6 +212,8 @@ void RasterizerOpenGL::DrawTriangles() {
     if (vertex_batch.empty())
         return;
 
+    SyncDirtyRegisters();
+
     const auto& regs = Pica::g_state.regs;
 
     // Sync and bind the framebuffer surfaces
@@ -257,6 +303,13 @@ void RasterizerOpenGL::DrawTriangles() {
         shader_dirty = false;
     }
 
+    // Register writes only keep the uniform values up to date from the point the rasterizer
+    // exists, so take the values already in the registers once before the first draw
+    if (!uniform_block_data.values_synced) {
+        SyncUniforms();
+        uniform_block_data.values_synced = true;
+    }
+
     // Sync the lighting luts
     for (unsigned index = 0; index < lighting_luts.size(); index++) {
         if (uniform_block_data.lut_dirty[index]) {
@@ -271,19 +324,28 @@ void RasterizerOpenGL::DrawTriangles() {
         uniform_block_data.fog_lut_dirty = false;
     }
 
+    state.Apply();
+
     // Sync the uniform data
     if (uniform_block_data.dirty) {
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformData), &uniform_block_data.data,
-                     GL_STATIC_DRAW);
+        const GLintptr offset = uniform_buffer.Upload(
+            &uniform_block_data.data, sizeof(UniformData), uniform_buffer_alignment);
+        glBindBufferRange(GL_UNIFORM_BUFFER, 0, uniform_buffer.GetHandle(), offset,
+                          sizeof(UniformData));
         uniform_block_data.dirty = false;
     }
 
-    state.Apply();
-
-    // Draw the vertex batch
-    glBufferData(GL_ARRAY_BUFFER, vertex_batch.size() * sizeof(HardwareVertex), vertex_batch.data(),
-                 GL_STREAM_DRAW);
-    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertex_batch.size());
+    // Draw the vertex batch, split up if it doesn't fit in the vertex buffer at once. Offsets are
+    // aligned to the vertex size so that they can be passed as the first vertex.
+    const size_t max_vertices =
+        vertex_buffer.GetMaxUploadSize(sizeof(HardwareVertex)) / sizeof(HardwareVertex) / 3 * 3;
+    for (size_t base = 0; base < vertex_batch.size(); base += max_vertices) {
+        const size_t count = std::min(vertex_batch.size() - base, max_vertices);
+        const GLintptr offset = vertex_buffer.Upload(
+            &vertex_batch[base], count * sizeof(HardwareVertex), sizeof(HardwareVertex));
+        glDrawArrays(GL_TRIANGLES, static_cast<GLint>(offset / sizeof(HardwareVertex)),
+                     static_cast<GLsizei>(count));
+    }
 
     // Mark framebuffer surfaces as dirty
     // TODO: Restrict invalidation area to the viewport
@@ -305,7 +367,11 @@ void RasterizerOpenGL::DrawTriangles() {
     state.Apply();
 }
 
-void RasterizerOpenGL::NotifyPicaRegisterChanged(u32 id) {
+void RasterizerOpenGL::SyncDirtyRegisters() {
+    Pica::g_state.dirty_regs.Consume([this](u32 id) { SyncPicaRegister(id); });
+}
+
+void RasterizerOpenGL::SyncPicaRegister(u32 id) {
     const auto& regs = Pica::g_state.regs;
 
     switch (id) {
@@ -686,13 +752,70 @@ void RasterizerOpenGL::NotifyPicaRegisterChanged(u32 id) {
     case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[5], 0x1cd):
     case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[6], 0x1ce):
     case PICA_REG_INDEX_WORKAROUND(lighting.lut_data[7], 0x1cf): {
-        auto& lut_config = regs.lighting.lut_config;
-        uniform_block_data.lut_dirty[lut_config.type / 4] = true;
+        // Each texture holds four of the lookup tables
+        u32& dirty_luts = Pica::g_state.lighting.dirty_luts;
+        for (unsigned lut = 0; lut < 24; ++lut) {
+            if (dirty_luts & (1u << lut))
+                uniform_block_data.lut_dirty[lut / 4] = true;
+        }
+        dirty_luts = 0;
         break;
     }
     }
 }
 
+void RasterizerOpenGL::LoadDiskCache(u64 program_id) {
+    shader_disk_cache.Close();
+    shader_disk_cache_open = false;
+
+    if (program_id == 0)
+        return;
+
+    const std::string dir = FileUtil::GetUserPath(D_SHADERCACHE_IDX);
+    if (!FileUtil::CreateFullPath(dir)) {
+        LOG_ERROR(Render_OpenGL, "Failed to create shader cache directory %s", dir.c_str());
+        return;
+    }
+    const std::string filename = dir + Common::StringFromFormat("%016llX.gl.bin", program_id);
+
+    ShaderDiskCacheReader reader;
+    const u32 num_entries = shader_disk_cache.OpenAndRead(filename.c_str(), reader);
+    shader_disk_cache_open = true;
+
+    if (reader.configs.size() > MAX_DISK_CACHE_SHADERS) {
+        reader.configs.erase(reader.configs.begin(),
+                             reader.configs.end() - MAX_DISK_CACHE_SHADERS);
+    }
+
+    // Drop skipped and excess entries from the file, so that it doesn't keep growing
+    if (reader.configs.size() != num_entries) {
+        LOG_INFO(Render_OpenGL, "Rewriting %s with %zu of its %u entries", filename.c_str(),
+                 reader.configs.size(), num_entries);
+        shader_disk_cache.Close();
+        FileUtil::Delete(filename);
+
+        ShaderDiskCacheReader empty_reader;
+        shader_disk_cache.OpenAndRead(filename.c_str(), empty_reader);
+        for (const PicaShaderConfig& config : reader.configs) {
+            AppendShaderDiskCacheEntry(shader_disk_cache, config);
+        }
+        shader_disk_cache.Sync();
+    }
+
+    // Compile the shaders used in previous runs while the title is loading, rather than stalling
+    // on them at their first draw
+    MICROPROFILE_SCOPE(OpenGL_ShaderPrecompile);
+    for (const PicaShaderConfig& config : reader.configs) {
+        if (shader_cache.count(config) == 0)
+            CompileShader(config);
+    }
+    LOG_INFO(Render_OpenGL, "Precompiled %zu shaders from %s", reader.configs.size(),
+             filename.c_str());
+
+    // Compiling left the last shader bound
+    shader_dirty = true;
+}
+
 void RasterizerOpenGL::FlushAll() {
     res_cache.FlushAll();
 }
@@ -1000,7 +1123,6 @@ void RasterizerOpenGL::SamplerInfo::SyncWithConfig(const Pica::Regs::TextureConf
 
 void RasterizerOpenGL::SetShader() {
     PicaShaderConfig config = PicaShaderConfig::CurrentConfig();
-    std::unique_ptr<PicaShader> shader = std::make_unique<PicaShader>();
 
     // Find (or generate) the GLSL shader for the current TEV state
     auto cached_shader = shader_cache.find(config);
@@ -1010,91 +1132,103 @@ void RasterizerOpenGL::SetShader() {
         state.draw.shader_program = current_shader->shader.handle;
         state.Apply();
     } else {
-        LOG_DEBUG(Render_OpenGL, "Creating new shader");
+        current_shader = CompileShader(config);
 
-        shader->shader.Create(GLShader::GenerateVertexShader().c_str(),
-                              GLShader::GenerateFragmentShader(config).c_str());
+        if (shader_disk_cache_open) {
+            AppendShaderDiskCacheEntry(shader_disk_cache, config);
+            shader_disk_cache.Sync();
+        }
+    }
+}
 
-        state.draw.shader_program = shader->shader.handle;
-        state.Apply();
+void RasterizerOpenGL::SyncUniforms() {
+    SyncDepthScale();
+    SyncDepthOffset();
+    SyncAlphaTest();
+    SyncCombinerColor();
+    auto& tev_stages = Pica::g_state.regs.GetTevStages();
+    for (int index = 0; index < tev_stages.size(); ++index)
+        SyncTevConstColor(index, tev_stages[index]);
+
+    SyncGlobalAmbient();
+    for (int light_index = 0; light_index < 8; light_index++) {
+        SyncLightSpecular0(light_index);
+        SyncLightSpecular1(light_index);
+        SyncLightDiffuse(light_index);
+        SyncLightAmbient(light_index);
+        SyncLightPosition(light_index);
+        SyncLightDistanceAttenuationBias(light_index);
+        SyncLightDistanceAttenuationScale(light_index);
+    }
 
-        // Set the texture samplers to correspond to different texture units
-        GLuint uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[0]");
-        if (uniform_tex != -1) {
-            glUniform1i(uniform_tex, 0);
-        }
-        uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[1]");
-        if (uniform_tex != -1) {
-            glUniform1i(uniform_tex, 1);
-        }
-        uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[2]");
-        if (uniform_tex != -1) {
-            glUniform1i(uniform_tex, 2);
-        }
+    SyncFogColor();
+}
 
-        // Set the texture samplers to correspond to different lookup table texture units
-        GLuint uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[0]");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, 3);
-        }
-        uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[1]");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, 4);
-        }
-        uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[2]");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, 5);
-        }
-        uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[3]");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, 6);
-        }
-        uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[4]");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, 7);
-        }
-        uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[5]");
-        if (uniform_lut != -1) {
-            glUniform1i(uniform_lut, 8);
-        }
+const RasterizerOpenGL::PicaShader* RasterizerOpenGL::CompileShader(
+    const PicaShaderConfig& config) {
+    LOG_DEBUG(Render_OpenGL, "Creating new shader");
 
-        GLuint uniform_fog_lut = glGetUniformLocation(shader->shader.handle, "fog_lut");
-        if (uniform_fog_lut != -1) {
-            glUniform1i(uniform_fog_lut, 9);
-        }
+    std::unique_ptr<PicaShader> shader = std::make_unique<PicaShader>();
 
-        current_shader = shader_cache.emplace(config, std::move(shader)).first->second.get();
+    shader->shader.Create(GLShader::GenerateVertexShader().c_str(),
+                          GLShader::GenerateFragmentShader(config).c_str());
 
-        unsigned int block_index =
-            glGetUniformBlockIndex(current_shader->shader.handle, "shader_data");
-        GLint block_size;
-        glGetActiveUniformBlockiv(current_shader->shader.handle, block_index,
-                                  GL_UNIFORM_BLOCK_DATA_SIZE, &block_size);
-        ASSERT_MSG(block_size == sizeof(UniformData), "Uniform block size did not match!");
-        glUniformBlockBinding(current_shader->shader.handle, block_index, 0);
+    state.draw.shader_program = shader->shader.handle;
+    state.Apply();
 
-        // Update uniforms
-        SyncDepthScale();
-        SyncDepthOffset();
-        SyncAlphaTest();
-        SyncCombinerColor();
-        auto& tev_stages = Pica::g_state.regs.GetTevStages();
-        for (int index = 0; index < tev_stages.size(); ++index)
-            SyncTevConstColor(index, tev_stages[index]);
+    // Set the texture samplers to correspond to different texture units
+    GLuint uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[0]");
+    if (uniform_tex != -1) {
+        glUniform1i(uniform_tex, 0);
+    }
+    uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[1]");
+    if (uniform_tex != -1) {
+        glUniform1i(uniform_tex, 1);
+    }
+    uniform_tex = glGetUniformLocation(shader->shader.handle, "tex[2]");
+    if (uniform_tex != -1) {
+        glUniform1i(uniform_tex, 2);
+    }
 
-        SyncGlobalAmbient();
-        for (int light_index = 0; light_index < 8; light_index++) {
-            SyncLightSpecular0(light_index);
-            SyncLightSpecular1(light_index);
-            SyncLightDiffuse(light_index);
-            SyncLightAmbient(light_index);
-            SyncLightPosition(light_index);
-            SyncLightDistanceAttenuationBias(light_index);
-            SyncLightDistanceAttenuationScale(light_index);
-        }
+    // Set the texture samplers to correspond to different lookup table texture units
+    GLuint uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[0]");
+    if (uniform_lut != -1) {
+        glUniform1i(uniform_lut, 3);
+    }
+    uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[1]");
+    if (uniform_lut != -1) {
+        glUniform1i(uniform_lut, 4);
+    }
+    uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[2]");
+    if (uniform_lut != -1) {
+        glUniform1i(uniform_lut, 5);
+    }
+    uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[3]");
+    if (uniform_lut != -1) {
+        glUniform1i(uniform_lut, 6);
+    }
+    uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[4]");
+    if (uniform_lut != -1) {
+        glUniform1i(uniform_lut, 7);
+    }
+    uniform_lut = glGetUniformLocation(shader->shader.handle, "lut[5]");
+    if (uniform_lut != -1) {
+        glUniform1i(uniform_lut, 8);
+    }
 
-        SyncFogColor();
+    GLuint uniform_fog_lut = glGetUniformLocation(shader->shader.handle, "fog_lut");
+    if (uniform_fog_lut != -1) {
+        glUniform1i(uniform_fog_lut, 9);
     }
+
+    unsigned int block_index = glGetUniformBlockIndex(shader->shader.handle, "shader_data");
+    GLint block_size;
+    glGetActiveUniformBlockiv(shader->shader.handle, block_index, GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &block_size);
+    ASSERT_MSG(block_size == sizeof(UniformData), "Uniform block size did not match!");
+    glUniformBlockBinding(shader->shader.handle, block_index, 0);
+
+    return shader_cache.emplace(config, std::move(shader)).first->second.get();
 }
 
 void RasterizerOpenGL::SyncCullMode() {
@@ -9,11 +9,13 @@
 #include <cstring>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <glad/glad.h>
 #include "common/bit_field.h"
 #include "common/common_types.h"
 #include "common/hash.h"
+#include "common/linear_disk_cache.h"
 #include "common/vector_math.h"
 #include "core/hw/gpu.h"
 #include "video_core/pica.h"
@@ -23,6 +25,7 @@
 #include "video_core/renderer_opengl/gl_rasterizer_cache.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
 #include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/renderer_opengl/gl_stream_buffer.h"
 #include "video_core/renderer_opengl/pica_to_gl.h"
 #include "video_core/shader/shader.h"
 
@@ -225,6 +228,27 @@ struct hash<PicaShaderConfig> {
 
 } // namespace std
 
+/**
+ * Collects the shader configurations read from a shader disk cache. Entries that don't hold a
+ * configuration recorded by this version, and configurations read before, are skipped.
+ */
+class ShaderDiskCacheReader final : public LinearDiskCacheReader<u64, u8> {
+public:
+    void Read(const u64& key, const u8* value, u32 value_size) override;
+
+    /// Configurations in the order they were first recorded
+    std::vector<PicaShaderConfig> configs;
+    /// Number of entries that were skipped
+    size_t num_skipped = 0;
+
+private:
+    std::unordered_set<PicaShaderConfig> seen;
+};
+
+/// Records a shader configuration in a shader disk cache
+void AppendShaderDiskCacheEntry(LinearDiskCache<u64, u8>& disk_cache,
+                                const PicaShaderConfig& config);
+
 class RasterizerOpenGL : public VideoCore::RasterizerInterface {
 public:
     RasterizerOpenGL();
@@ -233,7 +257,7 @@ public:
     void AddTriangle(const Pica::Shader::OutputVertex& v0, const Pica::Shader::OutputVertex& v1,
                      const Pica::Shader::OutputVertex& v2) override;
     void DrawTriangles() override;
-    void NotifyPicaRegisterChanged(u32 id) override;
+    void LoadDiskCache(u64 program_id) override;
     void FlushAll() override;
     void FlushRegion(PAddr addr, u32 size) override;
     void FlushAndInvalidateRegion(PAddr addr, u32 size) override;
@@ -351,6 +375,18 @@ private:
     /// Sets the OpenGL shader in accordance with the current PICA register state
     void SetShader();
 
+    /// Generates the shader for the given configuration, adds it to the cache and binds it
+    const PicaShader* CompileShader(const PicaShaderConfig& config);
+
+    /// Syncs all values in the uniform block with the PICA registers
+    void SyncUniforms();
+
+    /// Syncs the state depending on the PICA registers written since the last draw
+    void SyncDirtyRegisters();
+
+    /// Syncs the state depending on the specified PICA register
+    void SyncPicaRegister(u32 id);
+
     /// Syncs the cull mode to match the PICA register
     void SyncCullMode();
 
@@ -437,17 +473,24 @@ private:
     const PicaShader* current_shader = nullptr;
     bool shader_dirty;
 
+    /// Persistent record of the shader configurations used by the current title
+    LinearDiskCache<u64, u8> shader_disk_cache;
+    bool shader_disk_cache_open = false;
+
     struct {
         UniformData data;
         bool lut_dirty[6];
         bool fog_lut_dirty;
         bool dirty;
+        /// Whether the values have been taken from the registers since the rasterizer was created
+        bool values_synced;
     } uniform_block_data = {};
 
     std::array<SamplerInfo, 3> texture_samplers;
     OGLVertexArray vertex_array;
-    OGLBuffer vertex_buffer;
-    OGLBuffer uniform_buffer;
+    OGLStreamBuffer vertex_buffer;
+    OGLStreamBuffer uniform_buffer;
+    GLint uniform_buffer_alignment;
     OGLFramebuffer framebuffer;
 
     std::array<OGLTexture, 6> lighting_luts;
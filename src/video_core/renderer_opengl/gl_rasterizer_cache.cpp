@@ -18,6 +18,7 @@
 #include "common/vector_math.h"
 #include "core/memory.h"
 #include "video_core/debug_utils/debug_utils.h"
+#include "video_core/morton.h"
 #include "video_core/pica_state.h"
 #include "video_core/renderer_opengl/gl_rasterizer_cache.h"
 #include "video_core/renderer_opengl/gl_state.h"
@@ -66,7 +67,25 @@ static void MortonCopyPixels(CachedSurface::PixelFormat pixel_format, u32 width,
         std::swap(depth_stencil_shifts[0], depth_stencil_shifts[1]);
     }
 
-    if (pixel_format == PixelFormat::D24S8) {
+    if (bytes_per_pixel == gl_bytes_per_pixel && width % 8 == 0 && height % 8 == 0) {
+        // OpenGL stores rows bottom-up, so walk the linear image backwards
+        const s32 gl_stride = width * gl_bytes_per_pixel;
+        VideoCore::MortonCopySurface(morton_to_gl, bytes_per_pixel, width, height, morton_data,
+                                     width * bytes_per_pixel,
+                                     gl_data + (height - 1) * gl_stride, -gl_stride);
+
+        if (pixel_format == PixelFormat::D24S8) {
+            // Swap depth and stencil value ordering since 3DS does not match OpenGL
+            u8* dst_data = morton_to_gl ? gl_data : morton_data;
+            for (u32 i = 0; i < width * height; ++i) {
+                u32 depth_stencil;
+                memcpy(&depth_stencil, dst_data + i * sizeof(u32), sizeof(u32));
+                depth_stencil = (depth_stencil << depth_stencil_shifts[0]) |
+                                (depth_stencil >> depth_stencil_shifts[1]);
+                memcpy(dst_data + i * sizeof(u32), &depth_stencil, sizeof(u32));
+            }
+        }
+    } else if (pixel_format == PixelFormat::D24S8) {
         for (unsigned y = 0; y < height; ++y) {
             for (unsigned x = 0; x < width; ++x) {
                 const u32 coarse_y = y & ~7;
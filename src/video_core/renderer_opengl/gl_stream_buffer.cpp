@@ -0,0 +1,76 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <glad/glad.h>
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "video_core/renderer_opengl/gl_stream_buffer.h"
+
+MICROPROFILE_DEFINE(OpenGL_StreamBufferWait, "OpenGL", "Stream Buffer Wait", MP_RGB(200, 100, 50));
+
+static GLintptr AlignUp(GLintptr offset, GLintptr alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+OGLStreamBuffer::OGLStreamBuffer(GLenum target, GLsizeiptr size)
+    : target(target), buffer_size(size), segment_size(size / NUM_SEGMENTS) {
+    buffer.Create();
+}
+
+OGLStreamBuffer::~OGLStreamBuffer() {
+    for (GLsync fence : fences) {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    }
+}
+
+GLintptr OGLStreamBuffer::Upload(const void* data, GLsizeiptr size, GLintptr alignment) {
+    ASSERT(size <= GetMaxUploadSize(alignment));
+
+    if (!allocated) {
+        glBufferData(target, buffer_size, nullptr, GL_STREAM_DRAW);
+        allocated = true;
+    }
+
+    GLintptr offset = AlignUp(position, alignment);
+    const GLintptr segment_end = static_cast<GLintptr>(current_segment + 1) * segment_size;
+    if (offset + size > segment_end) {
+        // Data never straddles segments, so all commands reading a segment have been issued by
+        // the time writing moves on to the next one
+        fences[current_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        current_segment = (current_segment + 1) % NUM_SEGMENTS;
+
+        GLsync& fence = fences[current_segment];
+        if (fence != nullptr) {
+            MICROPROFILE_SCOPE(OpenGL_StreamBufferWait);
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        offset = AlignUp(static_cast<GLintptr>(current_segment) * segment_size, alignment);
+    }
+    position = offset + size;
+
+    if (!mapping_failed) {
+        void* pointer =
+            glMapBufferRange(target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                                       GL_MAP_UNSYNCHRONIZED_BIT);
+        if (pointer != nullptr) {
+            std::memcpy(pointer, data, size);
+            // The contents of the mapping may be lost on some rare occasions, like display mode
+            // changes, in which case they are uploaded again below
+            if (glUnmapBuffer(target) == GL_TRUE)
+                return offset;
+        } else {
+            LOG_WARNING(Render_OpenGL, "Failed to map stream buffer, using glBufferSubData");
+            mapping_failed = true;
+        }
+    }
+
+    glBufferSubData(target, offset, size, data);
+    return offset;
+}
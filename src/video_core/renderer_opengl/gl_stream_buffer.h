@@ -0,0 +1,60 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <glad/glad.h>
+#include "common/common_types.h"
+#include "video_core/renderer_opengl/gl_resource_manager.h"
+
+/**
+ * Buffer for data that is written by the CPU once and read by the GPU shortly after, such as
+ * vertex batches and uniform blocks.
+ *
+ * Uploads are appended to the buffer like to a ring buffer, instead of respecifying its storage
+ * every time. The buffer is split into segments, and a fence is placed whenever writing moves on
+ * to the next segment. A segment is only written again once the GPU has passed its fence, which
+ * allows mapping it without synchronization.
+ */
+class OGLStreamBuffer : private NonCopyable {
+public:
+    OGLStreamBuffer(GLenum target, GLsizeiptr size);
+    ~OGLStreamBuffer();
+
+    GLuint GetHandle() const {
+        return buffer.handle;
+    }
+
+    /// Returns the largest amount of data that can be uploaded at once with the given alignment
+    GLsizeiptr GetMaxUploadSize(GLintptr alignment) const {
+        return segment_size - alignment;
+    }
+
+    /**
+     * Copies data into the buffer, which must currently be bound to the target it was created
+     * for. Returns the offset of the data in the buffer, which is a multiple of `alignment`.
+     */
+    GLintptr Upload(const void* data, GLsizeiptr size, GLintptr alignment);
+
+private:
+    static constexpr size_t NUM_SEGMENTS = 4;
+
+    OGLBuffer buffer;
+    GLenum target;
+    GLsizeiptr buffer_size;
+    GLsizeiptr segment_size;
+
+    /// Whether storage for the buffer has been allocated yet
+    bool allocated = false;
+    /// Whether the driver failed to map the buffer, in which case glBufferSubData is used instead
+    bool mapping_failed = false;
+
+    /// Segment currently written to, and the offset right after the data written last
+    size_t current_segment = 0;
+    GLintptr position = 0;
+
+    /// Fences placed after the last commands reading each segment
+    std::array<GLsync, NUM_SEGMENTS> fences{};
+};
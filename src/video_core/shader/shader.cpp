@@ -2,16 +2,25 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <cstring>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 #include <boost/range/algorithm/fill.hpp>
 #include "common/bit_field.h"
+#include "common/file_util.h"
 #include "common/hash.h"
+#include "common/linear_disk_cache.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/string_util.h"
+#include "common/thread.h"
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
 #include "video_core/shader/shader.h"
@@ -25,7 +34,7 @@ namespace Pica {
 
 namespace Shader {
 
-OutputVertex OutputRegisters::ToVertex(const Regs::ShaderConfig& config) {
+OutputVertex OutputRegisters::ToVertex(const Regs::ShaderConfig& config) const {
     // Setup output data
     OutputVertex ret;
     // TODO(neobrain): Under some circumstances, up to 16 attributes may be output. We need to
@@ -76,22 +85,128 @@ OutputVertex OutputRegisters::ToVertex(const Regs::ShaderConfig& config) {
     return ret;
 }
 
+/// Programs decoded for the interpreter, which runs shaders when the JIT is disabled or unavailable
+static std::unordered_map<u64, std::shared_ptr<InterpreterProgram>> interpreter_map;
+
+static u64 GetCacheKey(const ShaderSetup& setup) {
+    return Common::ComputeHash64(&setup.program_code, sizeof(setup.program_code)) ^
+           Common::ComputeHash64(&setup.swizzle_data, sizeof(setup.swizzle_data));
+}
+
 #ifdef ARCHITECTURE_x86_64
 static std::unordered_map<u64, std::shared_ptr<JitShader>> shader_map;
+/// Guards shader_map, which is also filled by the precompilation thread
+static std::mutex shader_map_mutex;
+
+/// Shader programs are stored on disk as their program code followed by their swizzle data
+static const u32 DISK_CACHE_ENTRY_SIZE = 2 * 1024;
+
+/// Persistent record of the shader programs used by the current title, keyed by their hash
+static LinearDiskCache<u64, u32> disk_cache;
+static bool disk_cache_open = false;
+
+static std::thread precompile_thread;
+static std::atomic<bool> stop_precompiling;
+
+namespace {
+
+/// Collects the shader programs read from the disk cache
+class DiskCacheReader final : public LinearDiskCacheReader<u64, u32> {
+public:
+    void Read(const u64& key, const u32* value, u32 value_size) override {
+        if (value_size == DISK_CACHE_ENTRY_SIZE)
+            programs.emplace_back(value, value + value_size);
+    }
+
+    std::vector<std::vector<u32>> programs;
+};
+
+} // anonymous namespace
+
+/// Compiles the given programs unless they were compiled in the meantime or compilation is stopped
+static void PrecompileShaders(std::vector<std::vector<u32>> programs) {
+    Common::SetCurrentThreadName("ShaderPrecompile");
+
+    auto setup = std::make_unique<ShaderSetup>();
+    for (const auto& program : programs) {
+        if (stop_precompiling)
+            return;
+
+        std::copy_n(program.begin(), setup->program_code.size(), setup->program_code.begin());
+        std::copy_n(program.begin() + setup->program_code.size(), setup->swizzle_data.size(),
+                    setup->swizzle_data.begin());
+        u64 cache_key = GetCacheKey(*setup);
+
+        {
+            std::lock_guard<std::mutex> lock(shader_map_mutex);
+            if (shader_map.count(cache_key) != 0)
+                continue;
+        }
+
+        auto shader = std::make_shared<JitShader>();
+        shader->Compile(*setup);
+
+        std::lock_guard<std::mutex> lock(shader_map_mutex);
+        shader_map.emplace(cache_key, std::move(shader));
+    }
+
+    LOG_INFO(HW_GPU, "Precompiled %zu shaders from the disk cache", programs.size());
+}
+
+static void StopPrecompiling() {
+    if (precompile_thread.joinable()) {
+        stop_precompiling = true;
+        precompile_thread.join();
+    }
+}
 #endif // ARCHITECTURE_x86_64
 
 void ClearCache() {
+    interpreter_map.clear();
 #ifdef ARCHITECTURE_x86_64
+    StopPrecompiling();
     shader_map.clear();
+    disk_cache.Close();
+    disk_cache_open = false;
+#endif // ARCHITECTURE_x86_64
+}
+
+void LoadDiskCache(u64 program_id) {
+#ifdef ARCHITECTURE_x86_64
+    StopPrecompiling();
+    disk_cache.Close();
+    disk_cache_open = false;
+
+    if (!VideoCore::g_shader_jit_enabled || program_id == 0)
+        return;
+
+    const std::string dir = FileUtil::GetUserPath(D_SHADERCACHE_IDX);
+    if (!FileUtil::CreateFullPath(dir)) {
+        LOG_ERROR(HW_GPU, "Failed to create shader cache directory %s", dir.c_str());
+        return;
+    }
+    const std::string filename = dir + Common::StringFromFormat("%016llX.bin", program_id);
+
+    DiskCacheReader reader;
+    disk_cache.OpenAndRead(filename.c_str(), reader);
+    disk_cache_open = true;
+    LOG_INFO(HW_GPU, "Loaded %zu shaders from %s", reader.programs.size(), filename.c_str());
+
+    if (!reader.programs.empty()) {
+        stop_precompiling = false;
+        precompile_thread = std::thread(PrecompileShaders, std::move(reader.programs));
+    }
 #endif // ARCHITECTURE_x86_64
 }
 
 void ShaderSetup::Setup() {
+    u64 cache_key = GetCacheKey(*this);
+
 #ifdef ARCHITECTURE_x86_64
     if (VideoCore::g_shader_jit_enabled) {
-        u64 cache_key = (Common::ComputeHash64(&program_code, sizeof(program_code)) ^
-                         Common::ComputeHash64(&swizzle_data, sizeof(swizzle_data)));
+        interpreter_program.reset();
 
+        std::lock_guard<std::mutex> lock(shader_map_mutex);
         auto iter = shader_map.find(cache_key);
         if (iter != shader_map.end()) {
             jit_shader = iter->second;
@@ -100,11 +215,29 @@ void ShaderSetup::Setup() {
             shader->Compile(*this);
             jit_shader = shader;
             shader_map[cache_key] = std::move(shader);
+
+            if (disk_cache_open) {
+                std::array<u32, DISK_CACHE_ENTRY_SIZE> program;
+                auto swizzle_begin =
+                    std::copy(program_code.begin(), program_code.end(), program.begin());
+                std::copy(swizzle_data.begin(), swizzle_data.end(), swizzle_begin);
+                disk_cache.Append(cache_key, program.data(), DISK_CACHE_ENTRY_SIZE);
+                disk_cache.Sync();
+            }
         }
-    } else {
-        jit_shader.reset();
+        return;
     }
+    jit_shader.reset();
 #endif // ARCHITECTURE_x86_64
+
+    auto iter = interpreter_map.find(cache_key);
+    if (iter != interpreter_map.end()) {
+        interpreter_program = iter->second;
+    } else {
+        auto program = CompileInterpreterProgram(*this);
+        interpreter_program = program;
+        interpreter_map[cache_key] = std::move(program);
+    }
 }
 
 MICROPROFILE_DEFINE(GPU_Shader, "GPU", "Shader", MP_RGB(50, 50, 240));
@@ -127,13 +260,71 @@ void ShaderSetup::Run(UnitState<false>& state, const InputVertex& input, int num
     state.conditional_code[1] = false;
 
 #ifdef ARCHITECTURE_x86_64
-    if (auto shader = jit_shader.lock())
+    if (auto shader = jit_shader.lock()) {
         shader.get()->Run(*this, state, config.main_offset);
+        return;
+    }
+#endif // ARCHITECTURE_x86_64
+
+    if (auto program = interpreter_program.lock())
+        RunInterpreter(*this, *program, state, config.main_offset);
     else
         RunInterpreter(*this, state, config.main_offset);
-#else
-    RunInterpreter(*this, state, config.main_offset);
+}
+
+void ShaderSetup::RunBatch(UnitState<false>& state, const InputVertex* inputs,
+                           OutputRegisters* outputs, unsigned count, int num_attributes,
+                           const Regs::ShaderConfig& config) {
+
+    MICROPROFILE_SCOPE(GPU_Shader);
+
+    state.debug.max_offset = 0;
+    state.debug.max_opdesc_id = 0;
+
+    std::array<int, 16> input_registers;
+    for (int i = 0; i < num_attributes; i++)
+        input_registers[i] = config.input_register_map.GetRegisterForAttribute(i);
+
+#ifdef ARCHITECTURE_x86_64
+    if (auto shader = jit_shader.lock()) {
+        // Lay out the input registers of each vertex as the unit state would hold them, including
+        // registers not written by the attributes, which keep the value of the previous vertex
+        constexpr unsigned BATCH_SIZE = 32;
+        std::array<InputVertex, BATCH_SIZE> batch_registers;
+        const InputVertex* previous_registers =
+            reinterpret_cast<const InputVertex*>(state.registers.input);
+
+        for (unsigned first = 0; first < count; first += BATCH_SIZE) {
+            const unsigned batch_count = std::min(BATCH_SIZE, count - first);
+            for (unsigned v = 0; v < batch_count; ++v) {
+                InputVertex& registers = batch_registers[v];
+                registers = *previous_registers;
+                for (int i = 0; i < num_attributes; i++)
+                    registers.attr[input_registers[i]] = inputs[first + v].attr[i];
+                previous_registers = &registers;
+            }
+
+            shader->RunBatch(*this, state, config.main_offset, batch_registers.data(),
+                             outputs + first, batch_count);
+        }
+        return;
+    }
 #endif // ARCHITECTURE_x86_64
+
+    const auto program = interpreter_program.lock();
+    for (unsigned v = 0; v < count; ++v) {
+        for (int i = 0; i < num_attributes; i++)
+            state.registers.input[input_registers[i]] = inputs[v].attr[i];
+
+        state.conditional_code[0] = false;
+        state.conditional_code[1] = false;
+
+        if (program)
+            RunInterpreter(*this, *program, state, config.main_offset);
+        else
+            RunInterpreter(*this, state, config.main_offset);
+        outputs[v] = state.output_registers;
+    }
 }
 
 DebugData<true> ShaderSetup::ProduceDebugInfo(const InputVertex& input, int num_attributes,
@@ -33,6 +33,8 @@ namespace Shader {
 class JitShader;
 #endif // ARCHITECTURE_x86_64
 
+struct InterpreterProgram;
+
 struct InputVertex {
     alignas(16) Math::Vec4<float24> attr[16];
 };
@@ -92,7 +94,7 @@ struct OutputRegisters {
 
     alignas(16) Math::Vec4<float24> value[16];
 
-    OutputVertex ToVertex(const Regs::ShaderConfig& config);
+    OutputVertex ToVertex(const Regs::ShaderConfig& config) const;
 };
 static_assert(std::is_pod<OutputRegisters>::value, "Structure is not POD");
 
@@ -344,6 +346,13 @@ struct UnitState {
 /// Clears the shader cache
 void ClearCache();
 
+/**
+ * Opens the on-disk shader cache of the given title, which records every shader compiled from now
+ * on, and starts compiling the shaders recorded in previous runs in the background.
+ * @param program_id Program ID of the title. No cache is used for 0 (e.g. homebrew).
+ */
+void LoadDiskCache(u64 program_id);
+
 struct ShaderSetup {
 
     struct {
@@ -381,6 +390,7 @@ struct ShaderSetup {
 #ifdef ARCHITECTURE_x86_64
     std::weak_ptr<const JitShader> jit_shader;
 #endif
+    std::weak_ptr<const InterpreterProgram> interpreter_program;
 
     /**
      * Performs any shader unit setup that only needs to happen once per shader (as opposed to once
@@ -398,6 +408,20 @@ struct ShaderSetup {
     void Run(UnitState<false>& state, const InputVertex& input, int num_attributes,
              const Regs::ShaderConfig& config);
 
+    /**
+     * Runs the currently setup shader on several vertices, with the same results as calling `Run`
+     * for each of them in order. With the JIT, each batch of vertices is shaded by a single call
+     * into the compiled code.
+     * @param state Shader unit state, must be setup per shader and per shader unit
+     * @param inputs Input vertices into the shader
+     * @param outputs Receives the output registers for each input vertex
+     * @param count Number of vertices
+     * @param num_attributes The number of vertex shader attributes
+     * @param config Configuration object for the shader pipeline
+     */
+    void RunBatch(UnitState<false>& state, const InputVertex* inputs, OutputRegisters* outputs,
+                  unsigned count, int num_attributes, const Regs::ShaderConfig& config);
+
     /**
      * Produce debug information based on the given shader and input vertex
      * @param input Input vertex into the shader
@@ -5,7 +5,10 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <functional>
+#include <memory>
 #include <numeric>
+#include <vector>
 #include <nihstro/shader_bytecode.h>
 #include "common/assert.h"
 #include "common/common_types.h"
@@ -670,6 +673,708 @@ void RunInterpreter(const ShaderSetup& setup, UnitState<Debug>& state, unsigned
 template void RunInterpreter(const ShaderSetup& setup, UnitState<false>& state, unsigned offset);
 template void RunInterpreter(const ShaderSetup& setup, UnitState<true>& state, unsigned offset);
 
+// Programs can also be decoded ahead of time into one MicroOp per instruction, holding the resolved
+// operands and a pointer to the function executing it. The interpreter above is still used to
+// produce debug information, which is recorded while decoding each instruction.
+
+/// Register files read by pre-decoded source operands
+enum class SourceFile : u8 { Input, Temporary, FloatUniform, Invalid };
+
+/// Register files written by pre-decoded destination operands
+enum class DestFile : u8 { Output, Temporary, Invalid };
+
+/// How the two conditional code comparisons of a flow control instruction are combined
+enum class Condition : u8 { Or, And, JustX, JustY };
+
+struct MicroOp;
+struct ExecutionContext;
+
+using MicroOpHandler = void (*)(const MicroOp& op, ExecutionContext& context);
+using CompareFunc = bool (*)(float24 src1, float24 src2);
+
+/// Value of MicroOp::relative_src for instructions that don't use an address register
+constexpr u8 NO_RELATIVE_SRC = 3;
+
+struct SourceOperand {
+    SourceFile file;
+    u8 index;
+    bool negate;
+    std::array<u8, 4> selector; // Component of the register read into each operand component
+};
+
+/// A single shader instruction with its operands decoded, executed by calling its handler
+struct MicroOp {
+    MicroOpHandler handler;
+
+    std::array<SourceOperand, 3> src;
+    DestFile dest_file;
+    u8 dest_index;
+    u8 dest_mask; // Bit i is set if component i of the destination is written
+
+    u8 relative_src;                    // Source operand offset by an address register
+    u8 address_register;                // Index of that address register
+    SourceRegister relative_register;   // Register of that operand, before the offset is applied
+    std::array<CompareFunc, 2> compare; // Comparisons of CMP, or nullptr for invalid modes
+
+    u16 dest_offset;
+    u16 num_instructions;
+    u8 uniform_id; // Bool or int uniform used by the flow control instruction
+    bool refx;
+    bool refy;
+    Condition condition;
+
+    u32 raw; // The encoded instruction
+};
+
+struct InterpreterProgram {
+    /// Decoded instructions, indexed by their offset in the program code
+    std::vector<MicroOp> ops;
+};
+
+struct ExecutionContext {
+    const ShaderSetup& setup;
+    UnitState<false>& state;
+
+    /// Base pointers of the register files, indexed by SourceFile and DestFile
+    std::array<const Math::Vec4<float24>*, 4> source_files;
+    std::array<Math::Vec4<float24>*, 3> dest_files;
+
+    // TODO: Is there a maximal size for this?
+    boost::container::static_vector<CallStackElement, 16> call_stack;
+    u32 program_counter;
+    bool exit_loop;
+};
+
+// Placeholder for invalid registers
+static Math::Vec4<float24> dummy_register;
+
+static const float24* LookupSourceRegister(const ExecutionContext& context,
+                                           const SourceRegister& source_reg) {
+    switch (source_reg.GetRegisterType()) {
+    case RegisterType::Input:
+        return &context.state.registers.input[source_reg.GetIndex()].x;
+
+    case RegisterType::Temporary:
+        return &context.state.registers.temporary[source_reg.GetIndex()].x;
+
+    case RegisterType::FloatUniform:
+        return &context.setup.uniforms.f[source_reg.GetIndex()].x;
+
+    default:
+        return &dummy_register.x;
+    }
+}
+
+/// Returns the register read by the given source operand
+static const float24* GetSource(const MicroOp& op, unsigned n, const ExecutionContext& context) {
+    if (n == op.relative_src) {
+        const int address_offset = context.state.address_registers[op.address_register];
+        return LookupSourceRegister(context, op.relative_register + address_offset);
+    }
+
+    const SourceOperand& operand = op.src[n];
+    return &context.source_files[static_cast<size_t>(operand.file)][operand.index].x;
+}
+
+/// Returns the given component of a source operand, after swizzling and negation
+static float24 Fetch(const SourceOperand& operand, const float24* reg, int component) {
+    const float24 value = reg[operand.selector[component]];
+    return operand.negate ? -value : value;
+}
+
+static void StoreDest(const MicroOp& op, ExecutionContext& context, const float24 (&value)[4]) {
+    float24* dest = &context.dest_files[static_cast<size_t>(op.dest_file)][op.dest_index].x;
+    if (op.dest_mask & 1)
+        dest[0] = value[0];
+    if (op.dest_mask & 2)
+        dest[1] = value[1];
+    if (op.dest_mask & 4)
+        dest[2] = value[2];
+    if (op.dest_mask & 8)
+        dest[3] = value[3];
+}
+
+struct Add {
+    static float24 Apply(float24 a, float24 b) {
+        return a + b;
+    }
+};
+
+struct Mul {
+    static float24 Apply(float24 a, float24 b) {
+        return a * b;
+    }
+};
+
+struct Max {
+    static float24 Apply(float24 a, float24 b) {
+        // NOTE: Exact form required to match NaN semantics to hardware:
+        //   max(0, NaN) -> NaN
+        //   max(NaN, 0) -> 0
+        return (a > b) ? a : b;
+    }
+};
+
+struct Min {
+    static float24 Apply(float24 a, float24 b) {
+        // NOTE: Exact form required to match NaN semantics to hardware:
+        //   min(0, NaN) -> NaN
+        //   min(NaN, 0) -> 0
+        return (a < b) ? a : b;
+    }
+};
+
+struct SetGreaterEqual {
+    static float24 Apply(float24 a, float24 b) {
+        return (a >= b) ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+    }
+};
+
+struct SetLessThan {
+    static float24 Apply(float24 a, float24 b) {
+        return (a < b) ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+    }
+};
+
+struct Floor {
+    static float24 Apply(float24 a) {
+        return float24::FromFloat32(std::floor(a.ToFloat32()));
+    }
+};
+
+struct Move {
+    static float24 Apply(float24 a) {
+        return a;
+    }
+};
+
+struct Reciprocal {
+    static float24 Apply(float24 a) {
+        return float24::FromFloat32(1.0f / a.ToFloat32());
+    }
+};
+
+struct ReciprocalSqrt {
+    static float24 Apply(float24 a) {
+        return float24::FromFloat32(1.0f / std::sqrt(a.ToFloat32()));
+    }
+};
+
+struct Exp2 {
+    static float24 Apply(float24 a) {
+        return float24::FromFloat32(std::exp2(a.ToFloat32()));
+    }
+};
+
+struct Log2 {
+    static float24 Apply(float24 a) {
+        return float24::FromFloat32(std::log2(a.ToFloat32()));
+    }
+};
+
+/// Applies the operation to each pair of components of the two sources
+template <typename Operation>
+static void Execute_Binary(const MicroOp& op, ExecutionContext& context) {
+    const float24* src1 = GetSource(op, 0, context);
+    const float24* src2 = GetSource(op, 1, context);
+    float24 result[4];
+    for (int i = 0; i < 4; ++i)
+        result[i] = Operation::Apply(Fetch(op.src[0], src1, i), Fetch(op.src[1], src2, i));
+    StoreDest(op, context, result);
+}
+
+/// Applies the operation to each component of the source
+template <typename Operation>
+static void Execute_Unary(const MicroOp& op, ExecutionContext& context) {
+    const float24* src1 = GetSource(op, 0, context);
+    float24 result[4];
+    for (int i = 0; i < 4; ++i)
+        result[i] = Operation::Apply(Fetch(op.src[0], src1, i));
+    StoreDest(op, context, result);
+}
+
+/// Applies the operation to the first component of the source and writes it to all components
+template <typename Operation>
+static void Execute_Scalar(const MicroOp& op, ExecutionContext& context) {
+    const float24 value = Operation::Apply(Fetch(op.src[0], GetSource(op, 0, context), 0));
+    const float24 result[4] = {value, value, value, value};
+    StoreDest(op, context, result);
+}
+
+template <int num_components, bool homogeneous>
+static void Execute_DP(const MicroOp& op, ExecutionContext& context) {
+    const float24* src1_ = GetSource(op, 0, context);
+    const float24* src2_ = GetSource(op, 1, context);
+    float24 src1[4], src2[4];
+    for (int i = 0; i < 4; ++i) {
+        src1[i] = Fetch(op.src[0], src1_, i);
+        src2[i] = Fetch(op.src[1], src2_, i);
+    }
+    if (homogeneous)
+        src1[3] = float24::FromFloat32(1.0f);
+
+    const float24 dot =
+        std::inner_product(src1, src1 + num_components, src2, float24::FromFloat32(0.f));
+    const float24 result[4] = {dot, dot, dot, dot};
+    StoreDest(op, context, result);
+}
+
+static void Execute_MAD(const MicroOp& op, ExecutionContext& context) {
+    const float24* src1 = GetSource(op, 0, context);
+    const float24* src2 = GetSource(op, 1, context);
+    const float24* src3 = GetSource(op, 2, context);
+    float24 result[4];
+    for (int i = 0; i < 4; ++i) {
+        result[i] = Fetch(op.src[0], src1, i) * Fetch(op.src[1], src2, i) +
+                    Fetch(op.src[2], src3, i);
+    }
+    StoreDest(op, context, result);
+}
+
+static void Execute_MOVA(const MicroOp& op, ExecutionContext& context) {
+    const float24* src1 = GetSource(op, 0, context);
+    for (int i = 0; i < 2; ++i) {
+        if (!(op.dest_mask & (1 << i)))
+            continue;
+
+        // TODO: Figure out how the rounding is done on hardware
+        context.state.address_registers[i] =
+            static_cast<s32>(Fetch(op.src[0], src1, i).ToFloat32());
+    }
+}
+
+static void Execute_CMP(const MicroOp& op, ExecutionContext& context) {
+    const float24* src1 = GetSource(op, 0, context);
+    const float24* src2 = GetSource(op, 1, context);
+    for (int i = 0; i < 2; ++i) {
+        // TODO: Can you restrict to one compare via dest masking?
+
+        if (op.compare[i] != nullptr) {
+            context.state.conditional_code[i] =
+                op.compare[i](Fetch(op.src[0], src1, i), Fetch(op.src[1], src2, i));
+        } else {
+            const Instruction instr = {op.raw};
+            const auto compare_op = instr.common.compare_op;
+            LOG_ERROR(HW_GPU, "Unknown compare mode %x",
+                      static_cast<int>((i == 0) ? compare_op.x.Value() : compare_op.y.Value()));
+        }
+    }
+}
+
+template <typename Compare>
+static bool CompareWith(float24 src1, float24 src2) {
+    return Compare()(src1, src2);
+}
+
+static void Execute_UnknownArithmetic(const MicroOp& op, ExecutionContext& context) {
+    const Instruction instr = {op.raw};
+    LOG_ERROR(HW_GPU, "Unhandled arithmetic instruction: 0x%02x (%s): 0x%08x",
+              (int)instr.opcode.Value().EffectiveOpCode(), instr.opcode.Value().GetInfo().name,
+              instr.hex);
+    DEBUG_ASSERT(false);
+}
+
+static void Execute_UnknownMultiplyAdd(const MicroOp& op, ExecutionContext& context) {
+    const Instruction instr = {op.raw};
+    LOG_ERROR(HW_GPU, "Unhandled multiply-add instruction: 0x%02x (%s): 0x%08x",
+              (int)instr.opcode.Value().EffectiveOpCode(), instr.opcode.Value().GetInfo().name,
+              instr.hex);
+}
+
+static void Execute_UnknownFlowControl(const MicroOp& op, ExecutionContext& context) {
+    const Instruction instr = {op.raw};
+    LOG_ERROR(HW_GPU, "Unhandled instruction: 0x%02x (%s): 0x%08x",
+              (int)instr.opcode.Value().EffectiveOpCode(), instr.opcode.Value().GetInfo().name,
+              instr.hex);
+}
+
+static bool EvaluateCondition(const MicroOp& op, const UnitState<false>& state) {
+    const bool results[2] = {op.refx == state.conditional_code[0],
+                             op.refy == state.conditional_code[1]};
+
+    switch (op.condition) {
+    case Condition::Or:
+        return results[0] || results[1];
+
+    case Condition::And:
+        return results[0] && results[1];
+
+    case Condition::JustX:
+        return results[0];
+
+    case Condition::JustY:
+        return results[1];
+    }
+
+    UNREACHABLE();
+    return false;
+}
+
+static void Call(ExecutionContext& context, u32 offset, u32 num_instructions, u32 return_offset,
+                 u8 repeat_count, u8 loop_increment) {
+    // -1 to make sure when incrementing the PC we end up at the correct offset
+    context.program_counter = offset - 1;
+    ASSERT(context.call_stack.size() < context.call_stack.capacity());
+    context.call_stack.push_back(
+        {offset + num_instructions, return_offset, repeat_count, loop_increment, offset});
+}
+
+static void Execute_NOP(const MicroOp& op, ExecutionContext& context) {}
+
+static void Execute_END(const MicroOp& op, ExecutionContext& context) {
+    context.exit_loop = true;
+}
+
+static void Execute_JMPC(const MicroOp& op, ExecutionContext& context) {
+    if (EvaluateCondition(op, context.state))
+        context.program_counter = op.dest_offset - 1;
+}
+
+static void Execute_JMPU(const MicroOp& op, ExecutionContext& context) {
+    if (context.setup.uniforms.b[op.uniform_id] == !(op.num_instructions & 1))
+        context.program_counter = op.dest_offset - 1;
+}
+
+static void Execute_CALL(const MicroOp& op, ExecutionContext& context) {
+    Call(context, op.dest_offset, op.num_instructions, context.program_counter + 1, 0, 0);
+}
+
+static void Execute_CALLU(const MicroOp& op, ExecutionContext& context) {
+    if (context.setup.uniforms.b[op.uniform_id])
+        Call(context, op.dest_offset, op.num_instructions, context.program_counter + 1, 0, 0);
+}
+
+static void Execute_CALLC(const MicroOp& op, ExecutionContext& context) {
+    if (EvaluateCondition(op, context.state))
+        Call(context, op.dest_offset, op.num_instructions, context.program_counter + 1, 0, 0);
+}
+
+static void ConditionalCall(const MicroOp& op, ExecutionContext& context, bool condition) {
+    if (condition) {
+        Call(context, context.program_counter + 1, op.dest_offset - context.program_counter - 1,
+             op.dest_offset + op.num_instructions, 0, 0);
+    } else {
+        Call(context, op.dest_offset, op.num_instructions, op.dest_offset + op.num_instructions, 0,
+             0);
+    }
+}
+
+static void Execute_IFU(const MicroOp& op, ExecutionContext& context) {
+    ConditionalCall(op, context, context.setup.uniforms.b[op.uniform_id]);
+}
+
+static void Execute_IFC(const MicroOp& op, ExecutionContext& context) {
+    // TODO: Do we need to consider swizzlers here?
+    ConditionalCall(op, context, EvaluateCondition(op, context.state));
+}
+
+static void Execute_LOOP(const MicroOp& op, ExecutionContext& context) {
+    const Math::Vec4<u8>& loop_param = context.setup.uniforms.i[op.uniform_id];
+    context.state.address_registers[2] = loop_param.y;
+
+    Call(context, context.program_counter + 1, op.dest_offset - context.program_counter + 1,
+         op.dest_offset + 1, loop_param.x, loop_param.z);
+}
+
+static void Execute_EMIT(const MicroOp& op, ExecutionContext& context) {
+    Shader::HandleEMIT(context.state);
+}
+
+static void Execute_SETEMIT(const MicroOp& op, ExecutionContext& context) {
+    context.state.emit_params.raw = op.raw;
+}
+
+static void DecodeSource(MicroOp& op, unsigned n, const SourceRegister& source_reg,
+                         const SwizzlePattern& swizzle) {
+    SourceOperand& operand = op.src[n];
+    switch (source_reg.GetRegisterType()) {
+    case RegisterType::Input:
+        operand.file = SourceFile::Input;
+        operand.index = source_reg.GetIndex();
+        break;
+
+    case RegisterType::Temporary:
+        operand.file = SourceFile::Temporary;
+        operand.index = source_reg.GetIndex();
+        break;
+
+    case RegisterType::FloatUniform:
+        operand.file = SourceFile::FloatUniform;
+        operand.index = source_reg.GetIndex();
+        break;
+
+    default:
+        operand.file = SourceFile::Invalid;
+        operand.index = 0;
+        break;
+    }
+
+    const bool negate[] = {swizzle.negate_src1 != 0, swizzle.negate_src2 != 0,
+                           swizzle.negate_src3 != 0};
+    operand.negate = negate[n];
+
+    // The selector of the first component is stored in the highest bits
+    const u8 selector = swizzle.GetRawSelector(n + 1);
+    for (int i = 0; i < 4; ++i)
+        operand.selector[i] = (selector >> (6 - 2 * i)) & 3;
+}
+
+static void DecodeDest(MicroOp& op, DestRegister dest, const SwizzlePattern& swizzle) {
+    if (dest < 0x10) {
+        op.dest_file = DestFile::Output;
+        op.dest_index = dest.GetIndex();
+    } else if (dest < 0x20) {
+        op.dest_file = DestFile::Temporary;
+        op.dest_index = dest.GetIndex();
+    } else {
+        op.dest_file = DestFile::Invalid;
+        op.dest_index = 0;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        if (swizzle.DestComponentEnabled(i))
+            op.dest_mask |= 1 << i;
+    }
+}
+
+template <typename CompareOp>
+static CompareFunc DecodeCompare(CompareOp op) {
+    switch (op) {
+    case Instruction::Common::CompareOpType::Equal:
+        return CompareWith<std::equal_to<float24>>;
+
+    case Instruction::Common::CompareOpType::NotEqual:
+        return CompareWith<std::not_equal_to<float24>>;
+
+    case Instruction::Common::CompareOpType::LessThan:
+        return CompareWith<std::less<float24>>;
+
+    case Instruction::Common::CompareOpType::LessEqual:
+        return CompareWith<std::less_equal<float24>>;
+
+    case Instruction::Common::CompareOpType::GreaterThan:
+        return CompareWith<std::greater<float24>>;
+
+    case Instruction::Common::CompareOpType::GreaterEqual:
+        return CompareWith<std::greater_equal<float24>>;
+
+    default:
+        return nullptr;
+    }
+}
+
+static MicroOpHandler DecodeArithmeticHandler(OpCode::Id opcode) {
+    switch (opcode) {
+    case OpCode::Id::ADD:
+        return Execute_Binary<Add>;
+    case OpCode::Id::MUL:
+        return Execute_Binary<Mul>;
+    case OpCode::Id::FLR:
+        return Execute_Unary<Floor>;
+    case OpCode::Id::MAX:
+        return Execute_Binary<Max>;
+    case OpCode::Id::MIN:
+        return Execute_Binary<Min>;
+    case OpCode::Id::DP3:
+        return Execute_DP<3, false>;
+    case OpCode::Id::DP4:
+        return Execute_DP<4, false>;
+    case OpCode::Id::DPH:
+    case OpCode::Id::DPHI:
+        return Execute_DP<4, true>;
+    case OpCode::Id::RCP:
+        return Execute_Scalar<Reciprocal>;
+    case OpCode::Id::RSQ:
+        return Execute_Scalar<ReciprocalSqrt>;
+    case OpCode::Id::MOVA:
+        return Execute_MOVA;
+    case OpCode::Id::MOV:
+        return Execute_Unary<Move>;
+    case OpCode::Id::SGE:
+    case OpCode::Id::SGEI:
+        return Execute_Binary<SetGreaterEqual>;
+    case OpCode::Id::SLT:
+    case OpCode::Id::SLTI:
+        return Execute_Binary<SetLessThan>;
+    case OpCode::Id::CMP:
+        return Execute_CMP;
+    case OpCode::Id::EX2:
+        return Execute_Scalar<Exp2>;
+    case OpCode::Id::LG2:
+        return Execute_Scalar<Log2>;
+    default:
+        return Execute_UnknownArithmetic;
+    }
+}
+
+static MicroOpHandler DecodeFlowControlHandler(OpCode::Id opcode) {
+    switch (opcode) {
+    case OpCode::Id::END:
+        return Execute_END;
+    case OpCode::Id::JMPC:
+        return Execute_JMPC;
+    case OpCode::Id::JMPU:
+        return Execute_JMPU;
+    case OpCode::Id::CALL:
+        return Execute_CALL;
+    case OpCode::Id::CALLU:
+        return Execute_CALLU;
+    case OpCode::Id::CALLC:
+        return Execute_CALLC;
+    case OpCode::Id::NOP:
+        return Execute_NOP;
+    case OpCode::Id::IFU:
+        return Execute_IFU;
+    case OpCode::Id::IFC:
+        return Execute_IFC;
+    case OpCode::Id::LOOP:
+        return Execute_LOOP;
+    case OpCode::Id::EMIT:
+        return Execute_EMIT;
+    case OpCode::Id::SETEMIT:
+        return Execute_SETEMIT;
+    default:
+        return Execute_UnknownFlowControl;
+    }
+}
+
+static MicroOp DecodeInstruction(const ShaderSetup& setup, u32 raw) {
+    const Instruction instr = {raw};
+
+    MicroOp op{};
+    op.raw = raw;
+    op.relative_src = NO_RELATIVE_SRC;
+
+    switch (instr.opcode.Value().GetInfo().type) {
+    case OpCode::Type::Arithmetic: {
+        const SwizzlePattern swizzle = {setup.swizzle_data[instr.common.operand_desc_id]};
+        const bool is_inverted =
+            (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+        DecodeSource(op, 0, instr.common.GetSrc1(is_inverted), swizzle);
+        DecodeSource(op, 1, instr.common.GetSrc2(is_inverted), swizzle);
+        DecodeDest(op, instr.common.dest.Value(), swizzle);
+
+        if (instr.common.address_register_index != 0) {
+            op.relative_src = is_inverted ? 1 : 0;
+            op.address_register = instr.common.address_register_index - 1;
+            op.relative_register = is_inverted ? instr.common.GetSrc2(is_inverted)
+                                               : instr.common.GetSrc1(is_inverted);
+        }
+
+        op.compare[0] = DecodeCompare(instr.common.compare_op.x.Value());
+        op.compare[1] = DecodeCompare(instr.common.compare_op.y.Value());
+        op.handler = DecodeArithmeticHandler(instr.opcode.Value().EffectiveOpCode());
+        break;
+    }
+
+    case OpCode::Type::MultiplyAdd: {
+        if ((instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD) ||
+            (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI)) {
+            const SwizzlePattern swizzle = {setup.swizzle_data[instr.mad.operand_desc_id]};
+            const bool is_inverted = (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI);
+
+            DecodeSource(op, 0, instr.mad.GetSrc1(is_inverted), swizzle);
+            DecodeSource(op, 1, instr.mad.GetSrc2(is_inverted), swizzle);
+            DecodeSource(op, 2, instr.mad.GetSrc3(is_inverted), swizzle);
+            DecodeDest(op, instr.mad.dest.Value(), swizzle);
+
+            if (instr.mad.address_register_index != 0) {
+                op.relative_src = is_inverted ? 2 : 1;
+                op.address_register = instr.mad.address_register_index - 1;
+                op.relative_register = is_inverted ? instr.mad.GetSrc3(is_inverted)
+                                                   : instr.mad.GetSrc2(is_inverted);
+            }
+
+            op.handler = Execute_MAD;
+        } else {
+            op.handler = Execute_UnknownMultiplyAdd;
+        }
+        break;
+    }
+
+    default:
+        op.dest_offset = instr.flow_control.dest_offset;
+        op.num_instructions = instr.flow_control.num_instructions;
+        op.refx = instr.flow_control.refx;
+        op.refy = instr.flow_control.refy;
+
+        switch (instr.flow_control.op) {
+        case Instruction::FlowControlType::Or:
+            op.condition = Condition::Or;
+            break;
+
+        case Instruction::FlowControlType::And:
+            op.condition = Condition::And;
+            break;
+
+        case Instruction::FlowControlType::JustX:
+            op.condition = Condition::JustX;
+            break;
+
+        case Instruction::FlowControlType::JustY:
+            op.condition = Condition::JustY;
+            break;
+        }
+
+        if (instr.opcode.Value() == OpCode::Id::LOOP) {
+            op.uniform_id = instr.flow_control.int_uniform_id;
+        } else {
+            op.uniform_id = instr.flow_control.bool_uniform_id;
+        }
+
+        op.handler = DecodeFlowControlHandler(instr.opcode.Value());
+        break;
+    }
+
+    return op;
+}
+
+std::shared_ptr<InterpreterProgram> CompileInterpreterProgram(const ShaderSetup& setup) {
+    auto program = std::make_shared<InterpreterProgram>();
+    program->ops.reserve(setup.program_code.size());
+    for (u32 raw : setup.program_code)
+        program->ops.push_back(DecodeInstruction(setup, raw));
+    return program;
+}
+
+void RunInterpreter(const ShaderSetup& setup, const InterpreterProgram& program,
+                    UnitState<false>& state, unsigned offset) {
+    ExecutionContext context{setup,
+                             state,
+                             {{&state.registers.input[0], &state.registers.temporary[0],
+                               &setup.uniforms.f[0], &dummy_register}},
+                             {{&state.output_registers.value[0], &state.registers.temporary[0],
+                               &dummy_register}},
+                             {},
+                             offset,
+                             false};
+
+    const MicroOp* ops = program.ops.data();
+    while (!context.exit_loop) {
+        if (!context.call_stack.empty()) {
+            auto& top = context.call_stack.back();
+            if (context.program_counter == top.final_address) {
+                state.address_registers[2] += top.loop_increment;
+
+                if (top.repeat_counter-- == 0) {
+                    context.program_counter = top.return_address;
+                    context.call_stack.pop_back();
+                } else {
+                    context.program_counter = top.loop_address;
+                }
+
+                // TODO: Is "trying again" accurate to hardware?
+                continue;
+            }
+        }
+
+        const MicroOp& op = ops[context.program_counter];
+        op.handler(op, context);
+        ++context.program_counter;
+    }
+}
+
 } // namespace
 
 } // namespace
@@ -4,16 +4,37 @@
 
 #pragma once
 
+#include <memory>
+
 namespace Pica {
 
 namespace Shader {
 
+struct ShaderSetup;
+
 template <bool Debug>
 struct UnitState;
 
+/// Shader program decoded into the micro-op stream executed by the interpreter
+struct InterpreterProgram;
+
+/**
+ * Decodes the program code and swizzle data of the given setup into micro-ops, so that operand
+ * registers, swizzles and handlers don't need to be looked up on every execution of the program.
+ * The result doesn't depend on the uniforms, and can be shared by setups with the same program.
+ */
+std::shared_ptr<InterpreterProgram> CompileInterpreterProgram(const ShaderSetup& setup);
+
 template <bool Debug>
 void RunInterpreter(const ShaderSetup& setup, UnitState<Debug>& state, unsigned offset);
 
+/**
+ * Runs a program compiled by `CompileInterpreterProgram`, with the same results as running the
+ * shader code of the setup it was compiled from.
+ */
+void RunInterpreter(const ShaderSetup& setup, const InterpreterProgram& program,
+                    UnitState<false>& state, unsigned offset);
+
 } // namespace
 
 } // namespace
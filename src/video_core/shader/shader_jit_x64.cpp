@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <nihstro/shader_bytecode.h>
 #include <xmmintrin.h>
@@ -114,6 +115,8 @@ static const X64Reg COND0 = R13;
 static const X64Reg COND1 = R14;
 /// Pointer to the UnitState instance for the current VS unit
 static const X64Reg STATE = R15;
+/// Stack pointer at the start of the shader program, restored by END to leave any subroutines
+static const X64Reg PROGRAM_STACK = RBP;
 /// SIMD scratch register
 static const X64Reg SCRATCH = XMM0;
 /// Loaded with the first swizzled source register, otherwise can be used as a scratch register
@@ -128,6 +131,11 @@ static const X64Reg SCRATCH2 = XMM4;
 static const X64Reg ONE = XMM14;
 /// Constant vector of [-0.f, -0.f, -0.f, -0.f], used to efficiently negate a vector with XOR
 static const X64Reg NEGBIT = XMM15;
+/// Hold the components of the result of an instruction in the SoA program until they are stored
+static const X64Reg SOA_RESULT[4] = {XMM5, XMM6, XMM7, XMM8};
+/// Registers holding the rows and the columns of the matrix transposed by Compile_Transpose
+static const X64Reg TRANSPOSE_ROWS[4] = {XMM1, XMM2, XMM3, XMM4};
+static const X64Reg TRANSPOSED_COLUMNS[4] = {XMM2, XMM5, XMM4, XMM3};
 
 // State registers that must not be modified by external functions calls
 // Scratch registers, e.g., SRC1 and SCRATCH, have to be saved on the side if needed
@@ -233,6 +241,148 @@ void JitShader::Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRe
     }
 }
 
+size_t JitShader::SoARegisters::InputOffset(const SourceRegister& reg, unsigned component) {
+    const size_t vector_offset = (reg.GetIndex() * 4 + component) * SOA_WIDTH * sizeof(float24);
+    switch (reg.GetRegisterType()) {
+    case RegisterType::Input:
+        return offsetof(SoARegisters, input) + vector_offset;
+
+    case RegisterType::Temporary:
+        return offsetof(SoARegisters, temporary) + vector_offset;
+
+    default:
+        UNREACHABLE();
+        return 0;
+    }
+}
+
+size_t JitShader::SoARegisters::OutputOffset(const DestRegister& reg, unsigned component) {
+    const size_t vector_offset = (reg.GetIndex() * 4 + component) * SOA_WIDTH * sizeof(float24);
+    switch (reg.GetRegisterType()) {
+    case RegisterType::Output:
+        return offsetof(SoARegisters, output) + vector_offset;
+
+    case RegisterType::Temporary:
+        return offsetof(SoARegisters, temporary) + vector_offset;
+
+    default:
+        UNREACHABLE();
+        return 0;
+    }
+}
+
+/// Operands of an instruction supported by the SoA program
+struct SoAOperands {
+    unsigned operand_desc_id = 0;
+    unsigned num_srcs = 0;
+    std::array<SourceRegister, 3> src;
+    /// Components of each swizzled source register read by the instruction, bit i for component i
+    std::array<u8, 3> src_mask;
+    DestRegister dest;
+    /// Components of the destination register written by the instruction, bit i for component i
+    u8 dest_mask = 0;
+};
+
+/**
+ * Decodes the operands of an instruction for the SoA program.
+ * @return false if the instruction isn't supported by the SoA program. This is the case for flow
+ *         control and for the instructions setting the registers it uses (MOVA and CMP), as well as
+ *         for EX2 and LG2, which are computed by library calls.
+ */
+static bool GetSoAOperands(const ShaderSetup& setup, Instruction instr, SoAOperands& operands) {
+    const OpCode::Id opcode = instr.opcode.Value().EffectiveOpCode();
+    if (opcode == OpCode::Id::NOP || opcode == OpCode::Id::END)
+        return true;
+
+    const bool is_mad = opcode == OpCode::Id::MAD || opcode == OpCode::Id::MADI;
+    operands.operand_desc_id = is_mad ? instr.mad.operand_desc_id : instr.common.operand_desc_id;
+    SwizzlePattern swiz = {setup.swizzle_data[operands.operand_desc_id]};
+    operands.dest = is_mad ? instr.mad.dest.Value() : instr.common.dest.Value();
+    for (unsigned i = 0; i < 4; ++i) {
+        if (swiz.DestComponentEnabled(i))
+            operands.dest_mask |= 1 << i;
+    }
+
+    switch (opcode) {
+    case OpCode::Id::ADD:
+    case OpCode::Id::MUL:
+    case OpCode::Id::MAX:
+    case OpCode::Id::MIN:
+    case OpCode::Id::SGE:
+    case OpCode::Id::SLT:
+        operands.num_srcs = 2;
+        operands.src = {instr.common.src1, instr.common.src2};
+        operands.src_mask = {operands.dest_mask, operands.dest_mask};
+        break;
+
+    case OpCode::Id::SGEI:
+    case OpCode::Id::SLTI:
+        operands.num_srcs = 2;
+        operands.src = {instr.common.src1i, instr.common.src2i};
+        operands.src_mask = {operands.dest_mask, operands.dest_mask};
+        break;
+
+    case OpCode::Id::DP3:
+        operands.num_srcs = 2;
+        operands.src = {instr.common.src1, instr.common.src2};
+        operands.src_mask = {0x7, 0x7};
+        break;
+
+    case OpCode::Id::DP4:
+        operands.num_srcs = 2;
+        operands.src = {instr.common.src1, instr.common.src2};
+        operands.src_mask = {0xF, 0xF};
+        break;
+
+    case OpCode::Id::DPH:
+        operands.num_srcs = 2;
+        operands.src = {instr.common.src1, instr.common.src2};
+        operands.src_mask = {0x7, 0xF};
+        break;
+
+    case OpCode::Id::DPHI:
+        operands.num_srcs = 2;
+        operands.src = {instr.common.src1i, instr.common.src2i};
+        operands.src_mask = {0x7, 0xF};
+        break;
+
+    case OpCode::Id::FLR:
+    case OpCode::Id::MOV:
+        operands.num_srcs = 1;
+        operands.src = {instr.common.src1};
+        operands.src_mask = {operands.dest_mask};
+        break;
+
+    case OpCode::Id::RCP:
+    case OpCode::Id::RSQ:
+        operands.num_srcs = 1;
+        operands.src = {instr.common.src1};
+        operands.src_mask = {0x1};
+        break;
+
+    case OpCode::Id::MAD:
+        operands.num_srcs = 3;
+        operands.src = {instr.mad.src1, instr.mad.src2, instr.mad.src3};
+        operands.src_mask = {operands.dest_mask, operands.dest_mask, operands.dest_mask};
+        break;
+
+    case OpCode::Id::MADI:
+        operands.num_srcs = 3;
+        operands.src = {instr.mad.src1, instr.mad.src2i, instr.mad.src3i};
+        operands.src_mask = {operands.dest_mask, operands.dest_mask, operands.dest_mask};
+        break;
+
+    default:
+        return false;
+    }
+
+    if (operands.dest.GetRegisterType() != RegisterType::Output &&
+        operands.dest.GetRegisterType() != RegisterType::Temporary)
+        return false;
+
+    return true;
+}
+
 void JitShader::Compile_DestEnable(Instruction instr, X64Reg src) {
     DestRegister dest;
     unsigned operand_desc_id;
@@ -580,7 +730,8 @@ void JitShader::Compile_RSQ(Instruction instr) {
 void JitShader::Compile_NOP(Instruction instr) {}
 
 void JitShader::Compile_END(Instruction instr) {
-    ABI_PopRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
+    // Return to Compile_RunProgram
+    MOV(64, R(RSP), R(PROGRAM_STACK));
     RET();
 }
 
@@ -826,44 +977,415 @@ void JitShader::FindReturnOffsets() {
     std::sort(return_offsets.begin(), return_offsets.end());
 }
 
+void JitShader::Compile_SoALoadSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                                   unsigned component, X64Reg dest) {
+    const bool is_mad = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+                        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI;
+    SwizzlePattern swiz = {
+        setup->swizzle_data[is_mad ? instr.mad.operand_desc_id : instr.common.operand_desc_id]};
+
+    // The selector of the first component is in the highest bits
+    const unsigned selector = (swiz.GetRawSelector(src_num) >> (6 - 2 * component)) & 3;
+
+    // The address registers are always zero in the SoA program, as it doesn't contain any MOVA or
+    // LOOP instruction, so relative addressing never changes the source register
+    if (src_reg.GetRegisterType() == RegisterType::FloatUniform) {
+        int src_offset_disp = (int)(ShaderSetup::UniformOffset(RegisterType::FloatUniform,
+                                                               src_reg.GetIndex()) +
+                                    selector * sizeof(float24));
+        MOVSS(dest, MDisp(SETUP, src_offset_disp));
+        SHUFPS(dest, R(dest), _MM_SHUFFLE(0, 0, 0, 0));
+    } else {
+        MOVAPS(dest, MDisp(STATE, (int)SoARegisters::InputOffset(src_reg, selector)));
+    }
+
+    const bool negate[] = {swiz.negate_src1, swiz.negate_src2, swiz.negate_src3};
+    if (negate[src_num - 1]) {
+        XORPS(dest, R(NEGBIT));
+    }
+}
+
+void JitShader::Compile_SoAInstr(Instruction instr) {
+    SoAOperands operands;
+    bool supported = GetSoAOperands(*setup, instr, operands);
+    ASSERT(supported);
+
+    const OpCode::Id opcode = instr.opcode.Value().EffectiveOpCode();
+    const auto load_src = [&](unsigned src_num, unsigned component, X64Reg dest) {
+        Compile_SoALoadSrc(instr, src_num, operands.src[src_num - 1], component, dest);
+    };
+
+    // Instructions whose result is the same for every component compute it into SOA_RESULT[0],
+    // the others compute each enabled component into its own register
+    bool same_for_all_components = true;
+
+    switch (opcode) {
+    case OpCode::Id::NOP:
+        return;
+
+    case OpCode::Id::END:
+        Compile_END(instr);
+        return;
+
+    // The products are summed in the same order as in the scalar program
+    case OpCode::Id::DP3:
+        for (unsigned i = 0; i < 3; ++i) {
+            load_src(1, i, SOA_RESULT[i]);
+            load_src(2, i, SRC2);
+            Compile_SanitizedMul(SOA_RESULT[i], SRC2, SCRATCH);
+        }
+        ADDPS(SOA_RESULT[0], R(SOA_RESULT[1]));
+        ADDPS(SOA_RESULT[0], R(SOA_RESULT[2]));
+        break;
+
+    case OpCode::Id::DP4:
+    case OpCode::Id::DPH:
+    case OpCode::Id::DPHI:
+        for (unsigned i = 0; i < 4; ++i) {
+            if (i == 3 && opcode != OpCode::Id::DP4) {
+                MOVAPS(SOA_RESULT[i], R(ONE));
+            } else {
+                load_src(1, i, SOA_RESULT[i]);
+            }
+            load_src(2, i, SRC2);
+            Compile_SanitizedMul(SOA_RESULT[i], SRC2, SCRATCH);
+        }
+        ADDPS(SOA_RESULT[0], R(SOA_RESULT[1]));
+        ADDPS(SOA_RESULT[2], R(SOA_RESULT[3]));
+        ADDPS(SOA_RESULT[0], R(SOA_RESULT[2]));
+        break;
+
+    case OpCode::Id::RCP:
+        load_src(1, 0, SOA_RESULT[0]);
+        RCPPS(SOA_RESULT[0], R(SOA_RESULT[0]));
+        break;
+
+    case OpCode::Id::RSQ:
+        load_src(1, 0, SOA_RESULT[0]);
+        RSQRTPS(SOA_RESULT[0], R(SOA_RESULT[0]));
+        break;
+
+    default:
+        same_for_all_components = false;
+        for (unsigned i = 0; i < 4; ++i) {
+            if (!(operands.dest_mask & (1 << i)))
+                continue;
+
+            const X64Reg result = SOA_RESULT[i];
+            switch (opcode) {
+            case OpCode::Id::ADD:
+                load_src(1, i, result);
+                load_src(2, i, SRC2);
+                ADDPS(result, R(SRC2));
+                break;
+
+            case OpCode::Id::MUL:
+                load_src(1, i, result);
+                load_src(2, i, SRC2);
+                Compile_SanitizedMul(result, SRC2, SCRATCH);
+                break;
+
+            case OpCode::Id::MAD:
+            case OpCode::Id::MADI:
+                load_src(1, i, result);
+                load_src(2, i, SRC2);
+                load_src(3, i, SRC3);
+                Compile_SanitizedMul(result, SRC2, SCRATCH);
+                ADDPS(result, R(SRC3));
+                break;
+
+            case OpCode::Id::MAX:
+                load_src(1, i, result);
+                load_src(2, i, SRC2);
+                MAXPS(result, R(SRC2));
+                break;
+
+            case OpCode::Id::MIN:
+                load_src(1, i, result);
+                load_src(2, i, SRC2);
+                MINPS(result, R(SRC2));
+                break;
+
+            case OpCode::Id::SGE:
+            case OpCode::Id::SGEI:
+                load_src(2, i, result);
+                load_src(1, i, SRC1);
+                CMPPS(result, R(SRC1), CMP_LE);
+                ANDPS(result, R(ONE));
+                break;
+
+            case OpCode::Id::SLT:
+            case OpCode::Id::SLTI:
+                load_src(1, i, result);
+                load_src(2, i, SRC2);
+                CMPPS(result, R(SRC2), CMP_LT);
+                ANDPS(result, R(ONE));
+                break;
+
+            case OpCode::Id::FLR:
+                load_src(1, i, result);
+                if (Common::GetCPUCaps().sse4_1) {
+                    ROUNDFLOORPS(result, R(result));
+                } else {
+                    CVTPS2DQ(result, R(result));
+                    CVTDQ2PS(result, R(result));
+                }
+                break;
+
+            case OpCode::Id::MOV:
+                load_src(1, i, result);
+                break;
+
+            default:
+                UNREACHABLE();
+                break;
+            }
+        }
+        break;
+    }
+
+    // Only store the results once all components are computed, as the destination register may
+    // also be a source register
+    for (unsigned i = 0; i < 4; ++i) {
+        if (operands.dest_mask & (1 << i)) {
+            MOVAPS(MDisp(STATE, (int)SoARegisters::OutputOffset(operands.dest, i)),
+                   same_for_all_components ? SOA_RESULT[0] : SOA_RESULT[i]);
+        }
+    }
+}
+
+void JitShader::Compile_SoAProgram() {
+    const size_t program_size = setup->program_code.size();
+
+    // Walk the program backwards to find the offsets from which it runs straight to an END, along
+    // with the components of the temporary registers read before being written from there on,
+    // which would have to be carried over from the previous vertex
+    std::vector<bool> straight(program_size + 1, false);
+    std::vector<u64> temporaries_read(program_size + 1, 0);
+    for (size_t offset = program_size; offset-- > 0;) {
+        Instruction instr = GetShaderInstruction(offset);
+        SoAOperands operands;
+        if (!GetSoAOperands(*setup, instr, operands))
+            continue;
+
+        if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::END) {
+            straight[offset] = true;
+            continue;
+        }
+        if (!straight[offset + 1])
+            continue;
+
+        // Bit 4 * i + j is set for component j of temporary register i
+        SwizzlePattern swiz = {setup->swizzle_data[operands.operand_desc_id]};
+        u64 read = 0;
+        for (unsigned src = 0; src < operands.num_srcs; ++src) {
+            if (operands.src[src].GetRegisterType() != RegisterType::Temporary)
+                continue;
+
+            for (unsigned i = 0; i < 4; ++i) {
+                if (operands.src_mask[src] & (1 << i)) {
+                    const unsigned selector = (swiz.GetRawSelector(src + 1) >> (6 - 2 * i)) & 3;
+                    read |= u64(1) << (4 * operands.src[src].GetIndex() + selector);
+                }
+            }
+        }
+
+        u64 written = 0;
+        if (operands.dest.GetRegisterType() == RegisterType::Temporary)
+            written = u64(operands.dest_mask) << (4 * operands.dest.GetIndex());
+
+        straight[offset] = true;
+        temporaries_read[offset] = read | (temporaries_read[offset + 1] & ~written);
+    }
+
+    // Emit each straight part of the program, as long as it fits in the remaining code space
+    static const size_t MAX_SOA_INSTRUCTION_SIZE = 512;
+    program_counter = 0;
+    while (program_counter < program_size) {
+        if (!straight[program_counter]) {
+            ++program_counter;
+            continue;
+        }
+
+        size_t end = program_counter;
+        while (GetShaderInstruction(end).opcode.Value().EffectiveOpCode() != OpCode::Id::END)
+            ++end;
+        if (GetSpaceLeft() < (end + 1 - program_counter) * MAX_SOA_INSTRUCTION_SIZE) {
+            LOG_WARNING(HW_GPU, "Shader too large for the SoA program");
+            break;
+        }
+
+        while (program_counter <= end) {
+            if (temporaries_read[program_counter] == 0)
+                soa_code_ptr[program_counter] = GetCodePtr();
+            Compile_SoAInstr(GetShaderInstruction(program_counter++));
+        }
+    }
+}
+
+void JitShader::Compile_LoadConstants() {
+    // Used to set a register to one
+    static const __m128 one = {1.f, 1.f, 1.f, 1.f};
+    MOV(PTRBITS, R(RAX), ImmPtr(&one));
+    MOVAPS(ONE, MatR(RAX));
+
+    // Used to negate registers
+    static const __m128 neg = {-0.f, -0.f, -0.f, -0.f};
+    MOV(PTRBITS, R(RAX), ImmPtr(&neg));
+    MOVAPS(NEGBIT, MatR(RAX));
+}
+
+void JitShader::Compile_RunProgram(OpArg start_addr) {
+    // Zero address/loop registers and condition codes
+    XOR(64, R(ADDROFFS_REG_0), R(ADDROFFS_REG_0));
+    XOR(64, R(ADDROFFS_REG_1), R(ADDROFFS_REG_1));
+    XOR(64, R(LOOPCOUNT_REG), R(LOOPCOUNT_REG));
+    XOR(64, R(COND0), R(COND0));
+    XOR(64, R(COND1), R(COND1));
+
+    // Call the shader program so that END can return here. The program runs with the stack
+    // aligned to 16 bytes, like it does between the prologue and epilogue.
+    SUB(64, R(RSP), Imm8(8));
+    LEA(64, PROGRAM_STACK, MDisp(RSP, -8));
+    CALLptr(start_addr);
+    ADD(64, R(RSP), Imm8(8));
+}
+
+void JitShader::Compile_Transpose() {
+    MOVAPS(XMM0, R(XMM1));
+    UNPCKLPS(XMM0, R(XMM2)); // a0 b0 a1 b1
+    UNPCKHPS(XMM1, R(XMM2)); // a2 b2 a3 b3
+    MOVAPS(XMM5, R(XMM3));
+    UNPCKLPS(XMM5, R(XMM4)); // c0 d0 c1 d1
+    UNPCKHPS(XMM3, R(XMM4)); // c2 d2 c3 d3
+
+    MOVAPS(XMM2, R(XMM0));
+    MOVLHPS(XMM2, XMM5); // a0 b0 c0 d0
+    MOVHLPS(XMM5, XMM0); // a1 b1 c1 d1
+    MOVAPS(XMM4, R(XMM1));
+    MOVLHPS(XMM4, XMM3); // a2 b2 c2 d2
+    MOVHLPS(XMM3, XMM1); // a3 b3 c3 d3
+}
+
+void JitShader::Compile_BatchEntry(bool soa) {
+    ABI_PushRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
+
+    // Keep the batch parameters and the start address on the stack for the duration of the batch.
+    // On Windows the fourth parameter is in SETUP, so it is moved out first.
+    const int params_slot = 0;
+    const int start_addr_slot = 8;
+    SUB(64, R(RSP), Imm8(16));
+    MOV(64, MDisp(RSP, params_slot), R(ABI_PARAM4));
+    MOV(64, MDisp(RSP, start_addr_slot), R(ABI_PARAM3));
+
+    MOV(PTRBITS, R(SETUP), R(ABI_PARAM1));
+    MOV(PTRBITS, R(STATE), R(ABI_PARAM2));
+    Compile_LoadConstants();
+
+    const u8* batch_loop = GetCodePtr();
+    const int vertices_per_run = soa ? SOA_WIDTH : 1;
+
+    MOV(64, R(RAX), MDisp(RSP, params_slot));
+    CMP(64, MDisp(RAX, offsetof(BatchParams, count)), Imm8(0));
+    FixupBranch batch_done = J_CC(CC_E, true);
+
+    // Copy the input registers of the vertices into the unit state, or transpose them into the
+    // SoA registers, one register of SOA_WIDTH vertices at a time
+    MOV(64, R(RCX), MDisp(RAX, offsetof(BatchParams, input)));
+    for (int i = 0; i < 16; ++i) {
+        if (soa) {
+            for (unsigned v = 0; v < SOA_WIDTH; ++v) {
+                MOVUPS(TRANSPOSE_ROWS[v], MDisp(RCX, v * sizeof(InputVertex) + i * 16));
+            }
+            Compile_Transpose();
+            for (int c = 0; c < 4; ++c) {
+                const int offset = static_cast<int>(offsetof(SoARegisters, input) +
+                                                    (i * 4 + c) * SOA_WIDTH * sizeof(float24));
+                MOVAPS(MDisp(STATE, offset), TRANSPOSED_COLUMNS[c]);
+            }
+        } else {
+            const int offset =
+                static_cast<int>(offsetof(UnitState<false>, registers.input)) + i * 16;
+            MOVUPS(SCRATCH, MDisp(RCX, i * 16));
+            MOVAPS(MDisp(STATE, offset), SCRATCH);
+        }
+    }
+
+    // Compile_RunProgram's stack adjustment moves the start address slot up by 8 bytes
+    Compile_RunProgram(MDisp(RSP, start_addr_slot + 8));
+
+    // Copy the output registers of the vertices out of the unit state or the SoA registers
+    MOV(64, R(RAX), MDisp(RSP, params_slot));
+    MOV(64, R(RCX), MDisp(RAX, offsetof(BatchParams, output)));
+    for (int i = 0; i < 16; ++i) {
+        if (soa) {
+            for (int c = 0; c < 4; ++c) {
+                const int offset = static_cast<int>(offsetof(SoARegisters, output) +
+                                                    (i * 4 + c) * SOA_WIDTH * sizeof(float24));
+                MOVAPS(TRANSPOSE_ROWS[c], MDisp(STATE, offset));
+            }
+            Compile_Transpose();
+            for (unsigned v = 0; v < SOA_WIDTH; ++v) {
+                MOVUPS(MDisp(RCX, v * sizeof(OutputRegisters) + i * 16), TRANSPOSED_COLUMNS[v]);
+            }
+        } else {
+            const int offset =
+                static_cast<int>(offsetof(UnitState<false>, output_registers)) + i * 16;
+            MOVAPS(SCRATCH, MDisp(STATE, offset));
+            MOVUPS(MDisp(RCX, i * 16), SCRATCH);
+        }
+    }
+
+    ADD(64, MDisp(RAX, offsetof(BatchParams, input)),
+        Imm32(vertices_per_run * sizeof(InputVertex)));
+    ADD(64, MDisp(RAX, offsetof(BatchParams, output)),
+        Imm32(vertices_per_run * sizeof(OutputRegisters)));
+    SUB(64, MDisp(RAX, offsetof(BatchParams, count)), Imm8(vertices_per_run));
+    JMP(batch_loop, true);
+
+    SetJumpTarget(batch_done);
+    ADD(64, R(RSP), Imm8(16));
+    ABI_PopRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
+    RET();
+}
+
 void JitShader::Compile(const ShaderSetup& setup) {
 
     // Get a pointer to the setup to access program_code and swizzle_data
     this->setup = &setup;
 
     // Reset flow control state
-    program = (CompiledShader*)GetCodePtr();
     program_counter = 0;
     looping = false;
     code_ptr.fill(nullptr);
+    soa_code_ptr.fill(nullptr);
     fixup_branches.clear();
 
     // Find all `CALL` instructions and identify return locations
     FindReturnOffsets();
 
+    // Entry point for a single vertex, whose inputs are already in the unit state
+
+    program = (CompiledShader*)GetCodePtr();
+
     // The stack pointer is 8 modulo 16 at the entry of a procedure
     ABI_PushRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
 
     MOV(PTRBITS, R(SETUP), R(ABI_PARAM1));
     MOV(PTRBITS, R(STATE), R(ABI_PARAM2));
+    Compile_LoadConstants();
+    Compile_RunProgram(R(ABI_PARAM3));
 
-    // Zero address/loop  registers
-    XOR(64, R(ADDROFFS_REG_0), R(ADDROFFS_REG_0));
-    XOR(64, R(ADDROFFS_REG_1), R(ADDROFFS_REG_1));
-    XOR(64, R(LOOPCOUNT_REG), R(LOOPCOUNT_REG));
+    ABI_PopRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
+    RET();
 
-    // Used to set a register to one
-    static const __m128 one = {1.f, 1.f, 1.f, 1.f};
-    MOV(PTRBITS, R(RAX), ImmPtr(&one));
-    MOVAPS(ONE, MatR(RAX));
+    // Entry points for a batch of vertices, see BatchParams
 
-    // Used to negate registers
-    static const __m128 neg = {-0.f, -0.f, -0.f, -0.f};
-    MOV(PTRBITS, R(RAX), ImmPtr(&neg));
-    MOVAPS(NEGBIT, MatR(RAX));
+    batch_program = (CompiledBatchShader*)GetCodePtr();
+    Compile_BatchEntry(false);
 
-    // Jump to start of the shader program
-    JMPptr(R(ABI_PARAM3));
+    soa_program = (CompiledBatchShader*)GetCodePtr();
+    Compile_BatchEntry(true);
 
     // Compile entire program
     Compile_Block(static_cast<unsigned>(this->setup->program_code.size()));
@@ -874,6 +1396,8 @@ void JitShader::Compile(const ShaderSetup& setup) {
         SetJumpTarget(branch.first, code_ptr[branch.second]);
     }
 
+    Compile_SoAProgram();
+
     // Free memory that's no longer needed
     return_offsets.clear();
     return_offsets.shrink_to_fit();
@@ -894,6 +1418,40 @@ JitShader::JitShader() {
     AllocCodeSpace(MAX_SHADER_SIZE);
 }
 
+void JitShader::RunBatch(const ShaderSetup& setup, UnitState<false>& state, unsigned offset,
+                         const InputVertex* inputs, OutputRegisters* outputs,
+                         unsigned count) const {
+    const unsigned soa_count = HasSoAProgram(offset) ? count - count % SOA_WIDTH : 0;
+
+    if (soa_count != 0) {
+        // Registers not written by the program keep the value they have in the unit state
+        SoARegisters registers;
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                std::fill_n(registers.temporary[i][c], SOA_WIDTH, state.registers.temporary[i][c]);
+                std::fill_n(registers.output[i][c], SOA_WIDTH, state.output_registers.value[i][c]);
+            }
+        }
+
+        BatchParams params{inputs, outputs, soa_count};
+        soa_program(&setup, &registers, soa_code_ptr[offset], &params);
+
+        // Leave the unit state as the scalar program would have after the last of these vertices
+        std::copy_n(inputs[soa_count - 1].attr, 16, state.registers.input);
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                state.registers.temporary[i][c] = registers.temporary[i][c][SOA_WIDTH - 1];
+            }
+        }
+        state.output_registers = outputs[soa_count - 1];
+    }
+
+    if (soa_count != count) {
+        BatchParams params{inputs + soa_count, outputs + soa_count, count - soa_count};
+        batch_program(&setup, &state, code_ptr[offset], &params);
+    }
+}
+
 } // namespace Shader
 
 } // namespace Pica
@@ -22,8 +22,11 @@ namespace Pica {
 
 namespace Shader {
 
-/// Memory allocated for each compiled shader (64Kb)
-constexpr size_t MAX_SHADER_SIZE = 1024 * 64;
+/// Memory allocated for each compiled shader (256Kb)
+constexpr size_t MAX_SHADER_SIZE = 1024 * 256;
+
+/// Number of vertices shaded together by the structure-of-arrays version of a shader program
+constexpr unsigned SOA_WIDTH = 4;
 
 /**
  * This class implements the shader JIT compiler. It recompiles a Pica shader program into x86_64
@@ -37,6 +40,22 @@ public:
         program(&setup, &state, code_ptr[offset]);
     }
 
+    /**
+     * Runs the shader on several vertices in a single call, as if Run was called for each of them
+     * in order. If the program runs straight from the offset to an END, vertices are shaded
+     * SOA_WIDTH at a time by the structure-of-arrays version of the program.
+     * @param inputs Input registers of each vertex, copied into the unit state before running it
+     * @param outputs Receives the output registers of each vertex
+     * @param count Number of vertices
+     */
+    void RunBatch(const ShaderSetup& setup, UnitState<false>& state, unsigned offset,
+                  const InputVertex* inputs, OutputRegisters* outputs, unsigned count) const;
+
+    /// Returns true if RunBatch shades vertices with the SoA program when starting at the offset
+    bool HasSoAProgram(unsigned offset) const {
+        return soa_code_ptr[offset] != nullptr;
+    }
+
     void Compile(const ShaderSetup& setup);
 
     void Compile_ADD(Instruction instr);
@@ -69,9 +88,46 @@ public:
     void Compile_MAD(Instruction instr);
 
 private:
+    /// Loads the constant registers used by the compiled instructions
+    void Compile_LoadConstants();
+
+    /**
+     * Emits a call to the shader program at the given address, which returns once it reaches an
+     * END instruction. Resets the per-invocation registers beforehand.
+     */
+    void Compile_RunProgram(Gen::OpArg start_addr);
+
+    /**
+     * Emits an entry point running the program on each vertex of a batch, see BatchParams.
+     * @param soa If true, SOA_WIDTH vertices are run at a time by the structure-of-arrays program
+     */
+    void Compile_BatchEntry(bool soa);
+
+    /**
+     * Transposes the 4x4 matrix whose rows are held in the TRANSPOSE_ROWS registers into the
+     * TRANSPOSED_COLUMNS registers.
+     */
+    void Compile_Transpose();
+
     void Compile_Block(unsigned end);
     void Compile_NextInstr();
 
+    /**
+     * Emits the structure-of-arrays version of every part of the program that runs straight to an
+     * END, for the offsets from which it doesn't depend on registers left by a previous vertex.
+     */
+    void Compile_SoAProgram();
+    void Compile_SoAInstr(Instruction instr);
+
+    /**
+     * Loads one component of a swizzled source register of the SoA program into the specified XMM
+     * register, holding that component for each vertex.
+     * @param src_num Number indicating which source register to load (1 = src1, 2 = src2, 3 = src3)
+     * @param component Component of the swizzled source register
+     */
+    void Compile_SoALoadSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
+                            unsigned component, Gen::X64Reg dest);
+
     void Compile_SwizzleSrc(Instruction instr, unsigned src_num, SourceRegister src_reg,
                             Gen::X64Reg dest);
     void Compile_DestEnable(Instruction instr, Gen::X64Reg dest);
@@ -130,6 +186,36 @@ private:
     using CompiledShader = void(const void* setup, void* state, const u8* start_addr);
     CompiledShader* program = nullptr;
 
+    /// Vertices shaded by a call to batch_program, updated by it while it runs
+    struct BatchParams {
+        const InputVertex* input;
+        OutputRegisters* output;
+        u64 count;
+    };
+
+    using CompiledBatchShader = void(const void* setup, void* state, const u8* start_addr,
+                                     BatchParams* params);
+    CompiledBatchShader* batch_program = nullptr;
+
+    /**
+     * Registers of the vertices shaded together by soa_program. Each component of a register is a
+     * vector holding that component for every vertex.
+     */
+    struct SoARegisters {
+        alignas(16) float24 input[16][4][SOA_WIDTH];
+        alignas(16) float24 temporary[16][4][SOA_WIDTH];
+        alignas(16) float24 output[16][4][SOA_WIDTH];
+
+        static size_t InputOffset(const SourceRegister& reg, unsigned component);
+        static size_t OutputOffset(const DestRegister& reg, unsigned component);
+    };
+
+    /// Mapping of Pica VS instructions to pointers in the SoA program, if it can start there
+    std::array<const u8*, 1024> soa_code_ptr;
+
+    /// Same as batch_program, but runs the SoA program on SOA_WIDTH vertices at a time
+    CompiledBatchShader* soa_program = nullptr;
+
     const ShaderSetup* setup = nullptr;
 };
 
@@ -2,14 +2,46 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include "video_core/clipper.h"
+#include "video_core/rasterizer.h"
 #include "video_core/swrasterizer.h"
+#include "video_core/video_core.h"
 
 namespace VideoCore {
 
+SWRasterizer::SWRasterizer() = default;
+
+SWRasterizer::~SWRasterizer() {
+    DrawTriangles();
+}
+
 void SWRasterizer::AddTriangle(const Pica::Shader::OutputVertex& v0,
                                const Pica::Shader::OutputVertex& v1,
                                const Pica::Shader::OutputVertex& v2) {
     Pica::Clipper::ProcessTriangle(v0, v1, v2);
 }
+
+void SWRasterizer::DrawTriangles() {
+    const size_t max_threads = std::max(g_sw_rasterizer_threads.load(), 0);
+    Pica::Rasterizer::DrawQueuedTriangles(GetThreadPool(), max_threads);
+}
+
+void SWRasterizer::NotifyPicaRegistersChanging() {
+    // Queued triangles are shaded using the register state they were submitted with
+    DrawTriangles();
+}
+
+void SWRasterizer::FlushAll() {
+    DrawTriangles();
+}
+
+void SWRasterizer::FlushRegion(PAddr addr, u32 size) {
+    DrawTriangles();
+}
+
+void SWRasterizer::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    DrawTriangles();
+    Pica::Rasterizer::InvalidateTextureRegion(addr, size);
+}
 }
@@ -0,0 +1,108 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "core/memory.h"
+#include "video_core/debug_utils/debug_utils.h"
+#include "video_core/texture_cache.h"
+
+namespace Pica {
+
+/// Textures are dropped all at once when their decoded texels would take up more than this
+static constexpr size_t MAX_CACHED_BYTES = 64 * 1024 * 1024;
+
+MICROPROFILE_DEFINE(GPU_TextureDecode, "GPU", "Texture Decode", MP_RGB(200, 100, 50));
+
+/// Returns the size in bytes of the encoded texture data
+static u32 GetEncodedSize(const DebugUtils::TextureInfo& info) {
+    switch (info.format) {
+    case Regs::TextureFormat::ETC1:
+        return info.width * info.height / 2;
+    case Regs::TextureFormat::ETC1A4:
+        return info.width * info.height;
+    default:
+        return info.stride * info.height;
+    }
+}
+
+/// Returns the end of the physical memory region containing addr, or 0 if it isn't in one
+static PAddr GetRegionEnd(PAddr addr) {
+    if (addr >= Memory::VRAM_PADDR && addr < Memory::VRAM_PADDR_END)
+        return Memory::VRAM_PADDR_END;
+    if (addr >= Memory::FCRAM_PADDR && addr < Memory::FCRAM_PADDR_END)
+        return Memory::FCRAM_PADDR_END;
+    return 0;
+}
+
+std::shared_ptr<const DecodedTexture> TextureCache::GetTexture(const Regs::TextureConfig& config,
+                                                               Regs::TextureFormat format) {
+    const auto info = DebugUtils::TextureInfo::FromPicaRegister(config, format);
+    if (info.width <= 0 || info.height <= 0)
+        return nullptr;
+
+    const Key key{info.physical_address, format, static_cast<u32>(info.width),
+                  static_cast<u32>(info.height)};
+    auto it = textures.find(key);
+    if (it != textures.end())
+        return it->second;
+
+    // Don't decode past the end of the memory the texture starts in
+    const u32 encoded_size = GetEncodedSize(info);
+    const PAddr region_end = GetRegionEnd(info.physical_address);
+    if (region_end == 0 || encoded_size > region_end - info.physical_address) {
+        LOG_ERROR(HW_GPU, "Texture at 0x%08X with size 0x%X is outside of VRAM and FCRAM",
+                  info.physical_address, encoded_size);
+        return nullptr;
+    }
+
+    const u8* data = Memory::GetPhysicalPointer(info.physical_address);
+    if (data == nullptr)
+        return nullptr;
+
+    MICROPROFILE_SCOPE(GPU_TextureDecode);
+
+    const size_t decoded_size = info.width * info.height * sizeof(Math::Vec4<u8>);
+    if (cached_bytes + decoded_size > MAX_CACHED_BYTES) {
+        Clear();
+    }
+
+    auto texture = std::make_shared<DecodedTexture>();
+    texture->address = info.physical_address;
+    texture->format = format;
+    texture->width = info.width;
+    texture->height = info.height;
+    texture->encoded_size = encoded_size;
+    texture->texels.resize(info.width * info.height);
+    for (int t = 0; t < info.height; ++t) {
+        for (int s = 0; s < info.width; ++s) {
+            texture->texels[t * info.width + s] = DebugUtils::LookupTexture(data, s, t, info);
+        }
+    }
+
+    textures[key] = texture;
+    cached_bytes += decoded_size;
+    return texture;
+}
+
+void TextureCache::InvalidateRegion(PAddr addr, u32 size) {
+    for (auto it = textures.begin(); it != textures.end();) {
+        const DecodedTexture& texture = *it->second;
+        if (texture.address < addr + size && addr < texture.address + texture.encoded_size) {
+            cached_bytes -= texture.texels.size() * sizeof(Math::Vec4<u8>);
+            it = textures.erase(it);
+            ++generation;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TextureCache::Clear() {
+    textures.clear();
+    cached_bytes = 0;
+    ++generation;
+}
+
+} // namespace Pica
@@ -0,0 +1,72 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include "common/common_types.h"
+#include "common/vector_math.h"
+#include "video_core/pica.h"
+
+namespace Pica {
+
+/// A texture decoded to RGBA8 texels, stored row by row in memory order (bottom to top)
+struct DecodedTexture {
+    PAddr address;
+    Regs::TextureFormat format;
+    u32 width;
+    u32 height;
+    /// Size in bytes of the encoded data the texels were decoded from
+    u32 encoded_size;
+    std::vector<Math::Vec4<u8>> texels;
+
+    /// Returns the texel at the given coordinates, which must be within the texture
+    const Math::Vec4<u8>& Lookup(int s, int t) const {
+        return texels[t * width + s];
+    }
+};
+
+/**
+ * Keeps textures decoded for the software rasterizer, so that sampling doesn't need to decode
+ * the PICA texture format for every fragment. Entries are keyed by address, format and
+ * dimensions, and are decoded again whenever the hash of the texture data changes, which also
+ * catches writes from the emulated CPU that don't go through the rasterizer invalidation hooks.
+ */
+class TextureCache {
+public:
+    /**
+     * Returns the decoded texture described by the given registers, decoding it if it isn't
+     * cached yet.
+     * @returns nullptr if the texture doesn't lie within valid memory
+     */
+    std::shared_ptr<const DecodedTexture> GetTexture(const Regs::TextureConfig& config,
+                                                     Regs::TextureFormat format);
+
+    /// Drops all textures overlapping the given region of physical memory
+    void InvalidateRegion(PAddr addr, u32 size);
+
+    /// Drops all textures
+    void Clear();
+
+    /**
+     * Returns a counter that is increased whenever textures are dropped. Callers holding on to
+     * textures returned by GetTexture can skip looking them up again while it is unchanged.
+     */
+    u64 GetGeneration() const {
+        return generation;
+    }
+
+private:
+    using Key = std::tuple<PAddr, Regs::TextureFormat, u32, u32>;
+
+    std::map<Key, std::shared_ptr<DecodedTexture>> textures;
+    /// Total size in bytes of the texels of all cached textures
+    size_t cached_bytes = 0;
+    u64 generation = 0;
+};
+
+} // namespace Pica
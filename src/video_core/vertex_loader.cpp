@@ -1,9 +1,12 @@
+#include <cstring>
 #include <memory>
+#include <unordered_map>
 #include <boost/range/algorithm/fill.hpp>
 #include "common/alignment.h"
 #include "common/assert.h"
 #include "common/bit_field.h"
 #include "common/common_types.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/vector_math.h"
 #include "core/memory.h"
@@ -16,17 +19,51 @@
 
 namespace Pica {
 
+/**
+ * Loads an attribute with a fixed source type and element count. Elements that are not present in
+ * the array are filled with (0, 0, 0, 1). This is *not* carried over from the default attribute
+ * settings even if they're enabled for this attribute.
+ */
+template <typename T, unsigned elements>
+static void LoadAttribute(const u8* source, Math::Vec4<float24>& attribute) {
+    const T* srcdata = reinterpret_cast<const T*>(source);
+    for (unsigned comp = 0; comp < elements; ++comp) {
+        attribute[comp] = float24::FromFloat32(srcdata[comp]);
+    }
+    for (unsigned comp = elements; comp < 4; ++comp) {
+        attribute[comp] = comp == 3 ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
+    }
+}
+
+template <typename T>
+static constexpr std::array<void (*)(const u8*, Math::Vec4<float24>&), 4> MakeLoadFuncs() {
+    return {{LoadAttribute<T, 1>, LoadAttribute<T, 2>, LoadAttribute<T, 3>, LoadAttribute<T, 4>}};
+}
+
+/// Specialized attribute loaders, indexed by [VertexAttributeFormat][number of elements - 1]
+static const std::array<void (*)(const u8*, Math::Vec4<float24>&), 4> load_funcs[4] = {
+    MakeLoadFuncs<s8>(), MakeLoadFuncs<u8>(), MakeLoadFuncs<s16>(), MakeLoadFuncs<float>(),
+};
+
+static const u8* GetAttributeConfig(const Pica::Regs& regs) {
+    // Skip the base address, which does not affect how vertices are loaded
+    return reinterpret_cast<const u8*>(&regs.vertex_attributes) + sizeof(u32);
+}
+
 void VertexLoader::Setup(const Pica::Regs& regs) {
     ASSERT_MSG(!is_setup, "VertexLoader is not intended to be setup more than once.");
 
     const auto& attribute_config = regs.vertex_attributes;
     num_total_attributes = attribute_config.GetNumTotalAttributes();
 
-    boost::fill(vertex_attribute_sources, 0xdeadbeef);
+    std::memcpy(config.data(), GetAttributeConfig(regs), sizeof(config));
 
-    for (int i = 0; i < 16; i++) {
-        vertex_attribute_is_default[i] = attribute_config.IsDefaultAttribute(i);
-    }
+    std::array<u32, 16> vertex_attribute_sources;
+    std::array<u32, 16> vertex_attribute_strides{};
+    std::array<Regs::VertexAttributeFormat, 16> vertex_attribute_formats;
+    std::array<u32, 16> vertex_attribute_elements{};
+
+    boost::fill(vertex_attribute_sources, 0xdeadbeef);
 
     // Setup attribute data from loaders
     for (int loader = 0; loader < 12; ++loader) {
@@ -67,92 +104,91 @@ void VertexLoader::Setup(const Pica::Regs& regs) {
         }
     }
 
+    // Flatten the configuration into straight lists of array and default attributes, so that
+    // LoadVertex does not need to branch on formats or flags
+    for (int i = 0; i < num_total_attributes; ++i) {
+        if (vertex_attribute_elements[i] != 0) {
+            auto format = static_cast<size_t>(vertex_attribute_formats[i]);
+            ArrayAttribute& attribute = array_attributes[num_array_attributes++];
+            attribute.load = load_funcs[format][vertex_attribute_elements[i] - 1];
+            attribute.source_offset = vertex_attribute_sources[i];
+            attribute.stride = vertex_attribute_strides[i];
+            attribute.size =
+                vertex_attribute_elements[i] * attribute_config.GetElementSizeInBytes(i);
+            attribute.attribute_index = i;
+        } else if (attribute_config.IsDefaultAttribute(i)) {
+            default_attributes[num_default_attributes++] = i;
+        } else {
+            // TODO(yuriks): In this case, no data gets loaded and the vertex
+            // remains with the last value it had. This isn't currently maintained
+            // as global state, however, and so won't work in Citra yet.
+        }
+    }
+
     is_setup = true;
 }
 
 void VertexLoader::LoadVertex(u32 base_address, int index, int vertex, Shader::InputVertex& input,
-                              DebugUtils::MemoryAccessTracker& memory_accesses) {
+                              DebugUtils::MemoryAccessTracker& memory_accesses) const {
     ASSERT_MSG(is_setup, "A VertexLoader needs to be setup before loading vertices.");
 
-    for (int i = 0; i < num_total_attributes; ++i) {
-        if (vertex_attribute_elements[i] != 0) {
-            // Load per-vertex data from the loader arrays
-            u32 source_addr =
-                base_address + vertex_attribute_sources[i] + vertex_attribute_strides[i] * vertex;
-
-            if (g_debug_context && Pica::g_debug_context->recorder) {
-                memory_accesses.AddAccess(
-                    source_addr,
-                    vertex_attribute_elements[i] *
-                        ((vertex_attribute_formats[i] == Regs::VertexAttributeFormat::FLOAT)
-                             ? 4
-                             : (vertex_attribute_formats[i] == Regs::VertexAttributeFormat::SHORT)
-                                   ? 2
-                                   : 1));
-            }
+    const bool record_accesses = g_debug_context && Pica::g_debug_context->recorder;
 
-            switch (vertex_attribute_formats[i]) {
-            case Regs::VertexAttributeFormat::BYTE: {
-                const s8* srcdata =
-                    reinterpret_cast<const s8*>(Memory::GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case Regs::VertexAttributeFormat::UBYTE: {
-                const u8* srcdata =
-                    reinterpret_cast<const u8*>(Memory::GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case Regs::VertexAttributeFormat::SHORT: {
-                const s16* srcdata =
-                    reinterpret_cast<const s16*>(Memory::GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            case Regs::VertexAttributeFormat::FLOAT: {
-                const float* srcdata =
-                    reinterpret_cast<const float*>(Memory::GetPhysicalPointer(source_addr));
-                for (unsigned int comp = 0; comp < vertex_attribute_elements[i]; ++comp) {
-                    input.attr[i][comp] = float24::FromFloat32(srcdata[comp]);
-                }
-                break;
-            }
-            }
+    for (unsigned n = 0; n < num_array_attributes; ++n) {
+        const ArrayAttribute& attribute = array_attributes[n];
 
-            // Default attribute values set if array elements have < 4 components. This
-            // is *not* carried over from the default attribute settings even if they're
-            // enabled for this attribute.
-            for (unsigned int comp = vertex_attribute_elements[i]; comp < 4; ++comp) {
-                input.attr[i][comp] =
-                    comp == 3 ? float24::FromFloat32(1.0f) : float24::FromFloat32(0.0f);
-            }
+        // Load per-vertex data from the loader arrays
+        u32 source_addr = base_address + attribute.source_offset + attribute.stride * vertex;
 
-            LOG_TRACE(HW_GPU, "Loaded %d components of attribute %x for vertex %x (index %x) from "
-                              "0x%08x + 0x%08x + 0x%04x: %f %f %f %f",
-                      vertex_attribute_elements[i], i, vertex, index, base_address,
-                      vertex_attribute_sources[i], vertex_attribute_strides[i] * vertex,
-                      input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
-                      input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
-        } else if (vertex_attribute_is_default[i]) {
-            // Load the default attribute if we're configured to do so
-            input.attr[i] = g_state.vs_default_attributes[i];
-            LOG_TRACE(HW_GPU,
-                      "Loaded default attribute %x for vertex %x (index %x): (%f, %f, %f, %f)", i,
-                      vertex, index, input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
-                      input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
-        } else {
-            // TODO(yuriks): In this case, no data gets loaded and the vertex
-            // remains with the last value it had. This isn't currently maintained
-            // as global state, however, and so won't work in Citra yet.
-        }
+        if (record_accesses)
+            memory_accesses.AddAccess(source_addr, attribute.size);
+
+        auto& dest = input.attr[attribute.attribute_index];
+        attribute.load(Memory::GetPhysicalPointer(source_addr), dest);
+
+        LOG_TRACE(HW_GPU, "Loaded attribute %x for vertex %x (index %x) from "
+                          "0x%08x + 0x%08x + 0x%04x: %f %f %f %f",
+                  attribute.attribute_index, vertex, index, base_address,
+                  attribute.source_offset, attribute.stride * vertex, dest[0].ToFloat32(),
+                  dest[1].ToFloat32(), dest[2].ToFloat32(), dest[3].ToFloat32());
     }
+
+    for (unsigned n = 0; n < num_default_attributes; ++n) {
+        // Load the default attribute if we're configured to do so
+        u32 i = default_attributes[n];
+        input.attr[i] = g_state.vs_default_attributes[i];
+        LOG_TRACE(HW_GPU, "Loaded default attribute %x for vertex %x (index %x): (%f, %f, %f, %f)",
+                  i, vertex, index, input.attr[i][0].ToFloat32(), input.attr[i][1].ToFloat32(),
+                  input.attr[i][2].ToFloat32(), input.attr[i][3].ToFloat32());
+    }
+}
+
+static std::unordered_map<u64, std::unique_ptr<VertexLoader>> loader_cache;
+
+const VertexLoader& VertexLoader::GetCached(const Pica::Regs& regs) {
+    // Upper bound on the number of cached layouts; titles only use a handful in practice
+    constexpr size_t max_cached_loaders = 1024;
+
+    const u8* attribute_config = GetAttributeConfig(regs);
+    const int config_size = static_cast<int>(sizeof(config));
+    u64 cache_key = Common::ComputeHash64(attribute_config, config_size);
+
+    auto iter = loader_cache.find(cache_key);
+    if (iter != loader_cache.end() &&
+        std::memcmp(iter->second->config.data(), attribute_config, config_size) == 0) {
+        return *iter->second;
+    }
+
+    if (loader_cache.size() >= max_cached_loaders)
+        loader_cache.clear();
+
+    auto& loader = loader_cache[cache_key];
+    loader = std::make_unique<VertexLoader>(regs);
+    return *loader;
+}
+
+void VertexLoader::ClearCache() {
+    loader_cache.clear();
 }
 
 } // namespace Pica
@@ -2,7 +2,9 @@
 
 #include <array>
 #include "common/common_types.h"
+#include "common/vector_math.h"
 #include "video_core/pica.h"
+#include "video_core/pica_types.h"
 
 namespace Pica {
 
@@ -23,20 +25,48 @@ public:
 
     void Setup(const Pica::Regs& regs);
     void LoadVertex(u32 base_address, int index, int vertex, Shader::InputVertex& input,
-                    DebugUtils::MemoryAccessTracker& memory_accesses);
+                    DebugUtils::MemoryAccessTracker& memory_accesses) const;
 
     int GetNumTotalAttributes() const {
         return num_total_attributes;
     }
 
+    /**
+     * Returns a loader for the vertex attribute configuration currently set in the given
+     * registers. Loaders are built once per distinct configuration and cached, keyed by a hash of
+     * the attribute registers (excluding the base address, which is passed to LoadVertex).
+     */
+    static const VertexLoader& GetCached(const Pica::Regs& regs);
+
+    /// Clears the cache of loaders built by GetCached
+    static void ClearCache();
+
 private:
-    std::array<u32, 16> vertex_attribute_sources;
-    std::array<u32, 16> vertex_attribute_strides{};
-    std::array<Regs::VertexAttributeFormat, 16> vertex_attribute_formats;
-    std::array<u32, 16> vertex_attribute_elements{};
-    std::array<bool, 16> vertex_attribute_is_default;
+    /// Converts one attribute from its source format into a float24 vector
+    using AttributeLoadFunc = void (*)(const u8* source, Math::Vec4<float24>& attribute);
+
+    /// Precomputed description of how a single array attribute is fetched
+    struct ArrayAttribute {
+        AttributeLoadFunc load;
+        u32 source_offset;
+        u32 stride;
+        u32 size;
+        u32 attribute_index;
+    };
+
+    // Attributes that are loaded from vertex arrays, in attribute order
+    std::array<ArrayAttribute, 16> array_attributes;
+    unsigned num_array_attributes = 0;
+
+    // Attributes that take their value from the default attributes
+    std::array<u32, 16> default_attributes;
+    unsigned num_default_attributes = 0;
+
     int num_total_attributes = 0;
     bool is_setup = false;
+
+    // Copy of the attribute configuration registers this loader was built from
+    std::array<u32, sizeof(Regs::vertex_attributes) / sizeof(u32) - 1> config;
 };
 
 } // namespace Pica
@@ -2,10 +2,15 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include "common/assert.h"
 #include "common/logging/log.h"
+#include "common/thread_pool.h"
 #include "video_core/pica.h"
 #include "video_core/renderer_base.h"
+#include "video_core/renderer_headless/renderer_headless.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 #include "video_core/video_core.h"
 
@@ -20,14 +25,32 @@ std::unique_ptr<RendererBase> g_renderer; ///< Renderer plugin
 std::atomic<bool> g_hw_renderer_enabled;
 std::atomic<bool> g_shader_jit_enabled;
 std::atomic<bool> g_scaled_resolution_enabled;
+std::atomic<int> g_sw_rasterizer_threads;
+std::atomic<int> g_vertex_shader_threads;
+std::atomic<bool> g_headless_renderer_enabled;
+std::atomic<int> g_headless_frame_dump_interval;
 std::atomic<bool> g_vsync_enabled;
 
+static std::unique_ptr<Common::ThreadPool> thread_pool;
+
+Common::ThreadPool& GetThreadPool() {
+    ASSERT_MSG(thread_pool != nullptr, "Video core thread pool used outside of Init/Shutdown");
+    return *thread_pool;
+}
+
 /// Initialize the video core
 bool Init(EmuWindow* emu_window) {
     Pica::Init();
 
+    thread_pool = std::make_unique<Common::ThreadPool>(
+        std::max(std::thread::hardware_concurrency(), 1u), "VideoCore");
+
     g_emu_window = emu_window;
-    g_renderer = std::make_unique<RendererOpenGL>();
+    if (g_headless_renderer_enabled) {
+        g_renderer = std::make_unique<RendererHeadless>();
+    } else {
+        g_renderer = std::make_unique<RendererOpenGL>();
+    }
     g_renderer->SetWindow(g_emu_window);
     if (g_renderer->Init()) {
         LOG_DEBUG(Render, "initialized OK");
@@ -43,6 +66,7 @@ void Shutdown() {
     Pica::Shutdown();
 
     g_renderer.reset();
+    thread_pool.reset();
 
     LOG_DEBUG(Render, "shutdown OK");
 }
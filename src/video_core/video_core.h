@@ -10,6 +10,10 @@
 class EmuWindow;
 class RendererBase;
 
+namespace Common {
+class ThreadPool;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // Video Core namespace
 
@@ -38,6 +42,18 @@ extern EmuWindow* g_emu_window;                  ///< Emu window
 extern std::atomic<bool> g_hw_renderer_enabled;
 extern std::atomic<bool> g_shader_jit_enabled;
 extern std::atomic<bool> g_scaled_resolution_enabled;
+extern std::atomic<int> g_sw_rasterizer_threads; ///< 0 picks one thread per host core
+extern std::atomic<int> g_vertex_shader_threads; ///< 0 picks one thread per host core
+extern std::atomic<bool> g_headless_renderer_enabled;
+extern std::atomic<int> g_headless_frame_dump_interval; ///< 0 disables dumping frames
+
+/**
+ * Returns the worker pool shared by the parallel loops of the video core and the GPU, which has up
+ * to one thread per host core. The pool exists between Init and Shutdown, and its workers are only
+ * started once a loop runs in parallel. It may be used from the emulation and GPU threads at the
+ * same time, in which case their loops take turns.
+ */
+Common::ThreadPool& GetThreadPool();
 
 /// Start the video core
 void Start();